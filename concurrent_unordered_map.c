@@ -0,0 +1,668 @@
+#include "concurrent_unordered_map.h"
+#include "unordered_map.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <threads.h>
+
+/*******************************************************************************
+* A stripe is a plain 'unordered_map' guarded by its own lock. Each stripe is  *
+* aligned to a cache line of its own, so that threads taking neighbouring      *
+* locks do not bounce the same line between cores.                             *
+*******************************************************************************/
+typedef struct concurrent_unordered_map_stripe {
+    _Alignas(64) mtx_t lock;
+    unordered_map*     map;
+} concurrent_unordered_map_stripe;
+
+struct concurrent_unordered_map {
+    concurrent_unordered_map_stripe* stripes;
+    size_t                         (*hash_function)(void*);
+    size_t                           stripe_count;
+    unsigned                         stripe_shift;
+};
+
+static const size_t DEFAULT_STRIPE_COUNT = 64;
+static const size_t MAXIMUM_STRIPE_COUNT = 1 << 16;
+
+/*******************************************************************************
+* Returns the index of the stripe of the keys with hash value 'hash_value'.    *
+* The stripes of 'unordered_map' index their buckets by the lowest bits of     *
+* the hash, so the stripe is chosen by the top bits of the hash after the      *
+* finalizer of SplitMix64, in which every bit of the hash affects every top    *
+* bit. Taking the top bits of a plain multiplication by the golden ratio       *
+* would be cheaper, but the keys it puts in one stripe differ by Fibonacci     *
+* numbers, and under an identity hash their lowest bits crowd into a part of   *
+* the buckets.                                                                 *
+*******************************************************************************/
+static size_t get_stripe_index(concurrent_unordered_map* map,
+                               size_t hash_value)
+{
+    uint64_t mixed = (uint64_t) hash_value;
+
+    if (map->stripe_count == 1)
+    {
+        /* A shift by all 64 bits would be undefined. */
+        return 0;
+    }
+
+    mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+    mixed = mixed ^ (mixed >> 31);
+    return (size_t)(mixed >> map->stripe_shift);
+}
+
+static concurrent_unordered_map_stripe*
+get_stripe(concurrent_unordered_map* map, size_t hash_value)
+{
+    return &map->stripes[get_stripe_index(map, hash_value)];
+}
+
+/*******************************************************************************
+* Hashes the 'n' keys into 'hash_values' and lists their indices stripe by     *
+* stripe in 'order', the keys of stripe 's' being listed from 'starts[s]' up   *
+* to, but excluding, 'starts[s + 1]', in the order of 'keys'. The caller       *
+* frees the three arrays. Returns false if out of memory.                      *
+*******************************************************************************/
+static bool group_by_stripe(concurrent_unordered_map* map,
+                            void** keys,
+                            size_t n,
+                            size_t** hash_values,
+                            size_t** order,
+                            size_t** starts)
+{
+    size_t i;
+    size_t s;
+    size_t* filled = calloc(map->stripe_count, sizeof(size_t));
+
+    *hash_values = malloc(sizeof(size_t) * n);
+    *order       = malloc(sizeof(size_t) * n);
+    *starts      = calloc(map->stripe_count + 1, sizeof(size_t));
+
+    if (!filled || !*hash_values || !*order || !*starts)
+    {
+        free(filled);
+        free(*hash_values);
+        free(*order);
+        free(*starts);
+        return false;
+    }
+
+    /* Count the keys of each stripe 's' in 'starts[s + 1]'... */
+    for (i = 0; i < n; ++i)
+    {
+        (*hash_values)[i] = map->hash_function(keys[i]);
+        (*starts)[get_stripe_index(map, (*hash_values)[i]) + 1]++;
+    }
+
+    /* ...turn the counts into the starts of the ranges... */
+    for (s = 0; s < map->stripe_count; ++s)
+    {
+        (*starts)[s + 1] += (*starts)[s];
+    }
+
+    /* ...and fill the ranges. */
+    for (i = 0; i < n; ++i)
+    {
+        s = get_stripe_index(map, (*hash_values)[i]);
+        (*order)[(*starts)[s] + filled[s]++] = i;
+    }
+
+    free(filled);
+    return true;
+}
+
+static size_t to_power_of_two(size_t n)
+{
+    size_t ret = 1;
+
+    while (ret < n)
+    {
+        ret <<= 1;
+    }
+
+    return ret;
+}
+
+concurrent_unordered_map*
+concurrent_unordered_map_alloc(size_t initial_capacity,
+                               float load_factor,
+                               size_t stripes,
+                               size_t (*hash_function)(void*),
+                               bool (*equals_function)(void*, void*))
+{
+    concurrent_unordered_map* map;
+    size_t i;
+
+    if (!hash_function || !equals_function)
+    {
+        return NULL;
+    }
+
+    map = malloc(sizeof(*map));
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    if (stripes == 0)
+    {
+        stripes = DEFAULT_STRIPE_COUNT;
+    }
+    else if (stripes > MAXIMUM_STRIPE_COUNT)
+    {
+        stripes = MAXIMUM_STRIPE_COUNT;
+    }
+
+    stripes = to_power_of_two(stripes);
+
+    map->hash_function = hash_function;
+    map->stripe_count  = stripes;
+    map->stripe_shift  = 64;
+
+    for (i = stripes; i > 1; i >>= 1)
+    {
+        map->stripe_shift--;
+    }
+
+    map->stripes = aligned_alloc(
+                       _Alignof(concurrent_unordered_map_stripe),
+                       stripes * sizeof(concurrent_unordered_map_stripe));
+
+    if (!map->stripes)
+    {
+        free(map);
+        return NULL;
+    }
+
+    for (i = 0; i < stripes; ++i)
+    {
+        map->stripes[i].map = unordered_map_alloc(initial_capacity / stripes,
+                                                  load_factor,
+                                                  hash_function,
+                                                  equals_function);
+
+        if (!map->stripes[i].map)
+        {
+            break;
+        }
+
+        if (mtx_init(&map->stripes[i].lock, mtx_plain) != thrd_success)
+        {
+            unordered_map_free(map->stripes[i].map);
+            break;
+        }
+    }
+
+    if (i < stripes)
+    {
+        /* Roll back the stripes initialized so far. */
+        while (i > 0)
+        {
+            --i;
+            mtx_destroy(&map->stripes[i].lock);
+            unordered_map_free(map->stripes[i].map);
+        }
+
+        free(map->stripes);
+        free(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+void* concurrent_unordered_map_put(concurrent_unordered_map* map,
+                                   void* key,
+                                   void* value)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t hash_value;
+    void* old_value;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    hash_value = map->hash_function(key);
+    stripe     = get_stripe(map, hash_value);
+    mtx_lock(&stripe->lock);
+    old_value = unordered_map_put_hashed(stripe->map, key, hash_value, value);
+    mtx_unlock(&stripe->lock);
+    return old_value;
+}
+
+bool concurrent_unordered_map_compute(concurrent_unordered_map* map,
+                                      void* key,
+                                      void* (*function)(void*, void*, void*),
+                                      void* context)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t hash_value;
+    bool ret;
+
+    if (!map || !function)
+    {
+        return false;
+    }
+
+    hash_value = map->hash_function(key);
+    stripe     = get_stripe(map, hash_value);
+    mtx_lock(&stripe->lock);
+    ret = unordered_map_compute_hashed(stripe->map,
+                                       key,
+                                       hash_value,
+                                       function,
+                                       context);
+    mtx_unlock(&stripe->lock);
+    return ret;
+}
+
+bool concurrent_unordered_map_reserve(concurrent_unordered_map* map, size_t n)
+{
+    size_t per_stripe;
+    size_t i;
+    bool ret = true;
+
+    if (!map)
+    {
+        return false;
+    }
+
+    per_stripe = n / map->stripe_count + (n % map->stripe_count != 0);
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        ret &= unordered_map_reserve(map->stripes[i].map, per_stripe);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+
+    return ret;
+}
+
+bool concurrent_unordered_map_put_all(concurrent_unordered_map* map,
+                                      void** keys,
+                                      void** values,
+                                      size_t n)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t* hash_values;
+    size_t* order;
+    size_t* starts;
+    size_t s;
+    size_t i;
+    bool ret = true;
+
+    if (!map || (n > 0 && (!keys || !values)))
+    {
+        return false;
+    }
+
+    if (n == 0)
+    {
+        return true;
+    }
+
+    if (n > SIZE_MAX / sizeof(size_t)
+            || !group_by_stripe(map, keys, n, &hash_values, &order, &starts))
+    {
+        return false;
+    }
+
+    for (s = 0; s < map->stripe_count && ret; ++s)
+    {
+        if (starts[s] == starts[s + 1])
+        {
+            continue;
+        }
+
+        stripe = &map->stripes[s];
+        mtx_lock(&stripe->lock);
+
+        /* With the room reserved up front, none of the puts can fail. */
+        ret = unordered_map_reserve(stripe->map,
+                                    unordered_map_size(stripe->map)
+                                    + starts[s + 1] - starts[s]);
+
+        for (i = starts[s]; ret && i < starts[s + 1]; ++i)
+        {
+            unordered_map_put_hashed(stripe->map,
+                                     keys[order[i]],
+                                     hash_values[order[i]],
+                                     values[order[i]]);
+        }
+
+        mtx_unlock(&stripe->lock);
+    }
+
+    free(hash_values);
+    free(order);
+    free(starts);
+    return ret;
+}
+
+bool concurrent_unordered_map_contains_key(concurrent_unordered_map* map,
+                                           void* key)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t hash_value;
+    bool ret;
+
+    if (!map)
+    {
+        return false;
+    }
+
+    hash_value = map->hash_function(key);
+    stripe     = get_stripe(map, hash_value);
+    mtx_lock(&stripe->lock);
+    ret = unordered_map_contains_key_hashed(stripe->map, key, hash_value);
+    mtx_unlock(&stripe->lock);
+    return ret;
+}
+
+void* concurrent_unordered_map_get(concurrent_unordered_map* map, void* key)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t hash_value;
+    void* value;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    hash_value = map->hash_function(key);
+    stripe     = get_stripe(map, hash_value);
+    mtx_lock(&stripe->lock);
+    value = unordered_map_get_hashed(stripe->map, key, hash_value);
+    mtx_unlock(&stripe->lock);
+    return value;
+}
+
+void concurrent_unordered_map_get_batch(concurrent_unordered_map* map,
+                                        void** keys,
+                                        size_t n,
+                                        void** out_values)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t* hash_values;
+    size_t* order;
+    size_t* starts;
+    size_t s;
+    size_t i;
+
+    if (!map || !keys || !out_values || n == 0)
+    {
+        return;
+    }
+
+    if (n > SIZE_MAX / sizeof(size_t)
+            || !group_by_stripe(map, keys, n, &hash_values, &order, &starts))
+    {
+        /* Out of memory for the grouping: take a lock per key instead. */
+        for (i = 0; i < n; ++i)
+        {
+            out_values[i] = concurrent_unordered_map_get(map, keys[i]);
+        }
+
+        return;
+    }
+
+    for (s = 0; s < map->stripe_count; ++s)
+    {
+        if (starts[s] == starts[s + 1])
+        {
+            continue;
+        }
+
+        stripe = &map->stripes[s];
+        mtx_lock(&stripe->lock);
+
+        for (i = starts[s]; i < starts[s + 1]; ++i)
+        {
+            out_values[order[i]] = unordered_map_get_hashed(
+                                       stripe->map,
+                                       keys[order[i]],
+                                       hash_values[order[i]]);
+        }
+
+        mtx_unlock(&stripe->lock);
+    }
+
+    free(hash_values);
+    free(order);
+    free(starts);
+}
+
+void* concurrent_unordered_map_remove(concurrent_unordered_map* map,
+                                      void* key)
+{
+    concurrent_unordered_map_stripe* stripe;
+    size_t hash_value;
+    void* value;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    hash_value = map->hash_function(key);
+    stripe     = get_stripe(map, hash_value);
+    mtx_lock(&stripe->lock);
+    value = unordered_map_remove_hashed(stripe->map, key, hash_value);
+    mtx_unlock(&stripe->lock);
+    return value;
+}
+
+void concurrent_unordered_map_clear(concurrent_unordered_map* map)
+{
+    size_t i;
+
+    if (!map)
+    {
+        return;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        unordered_map_clear(map->stripes[i].map);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+}
+
+size_t concurrent_unordered_map_size(concurrent_unordered_map* map)
+{
+    size_t size = 0;
+    size_t i;
+
+    if (!map)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        size += unordered_map_size(map->stripes[i].map);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+
+    return size;
+}
+
+size_t concurrent_unordered_map_bucket_count(concurrent_unordered_map* map)
+{
+    size_t bucket_count = 0;
+    size_t i;
+
+    if (!map)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        bucket_count += unordered_map_bucket_count(map->stripes[i].map);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+
+    return bucket_count;
+}
+
+void concurrent_unordered_map_set_incremental_rehash
+    (concurrent_unordered_map* map, size_t buckets_per_operation)
+{
+    size_t i;
+
+    if (!map)
+    {
+        return;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        unordered_map_set_incremental_rehash(map->stripes[i].map,
+                                             buckets_per_operation);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+}
+
+void concurrent_unordered_map_set_low_water_mark
+    (concurrent_unordered_map* map, float low_water_mark)
+{
+    size_t i;
+
+    if (!map)
+    {
+        return;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        unordered_map_set_low_water_mark(map->stripes[i].map, low_water_mark);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+}
+
+bool concurrent_unordered_map_shrink_to_fit(concurrent_unordered_map* map)
+{
+    size_t i;
+    bool ret = true;
+
+    if (!map)
+    {
+        return false;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        ret &= unordered_map_shrink_to_fit(map->stripes[i].map);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+
+    return ret;
+}
+
+bool concurrent_unordered_map_for_each(concurrent_unordered_map* map,
+                                       void (*function)(void*, void*, void*),
+                                       void* context)
+{
+    unordered_map_iterator* iterator;
+    void* key;
+    void* value;
+    size_t i;
+
+    if (!map || !function)
+    {
+        return false;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        iterator = unordered_map_iterator_alloc(map->stripes[i].map);
+
+        if (!iterator)
+        {
+            mtx_unlock(&map->stripes[i].lock);
+            return false;
+        }
+
+        while (unordered_map_iterator_has_next(iterator))
+        {
+            unordered_map_iterator_next(iterator, &key, &value);
+            function(key, value, context);
+        }
+
+        unordered_map_iterator_free(iterator);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+
+    return true;
+}
+
+bool concurrent_unordered_map_is_healthy(concurrent_unordered_map* map)
+{
+    unordered_map_iterator* iterator;
+    void* key;
+    void* value;
+    bool healthy = true;
+    size_t i;
+
+    if (!map)
+    {
+        return false;
+    }
+
+    for (i = 0; i < map->stripe_count && healthy; ++i)
+    {
+        mtx_lock(&map->stripes[i].lock);
+        healthy = unordered_map_is_healthy(map->stripes[i].map);
+        iterator = unordered_map_iterator_alloc(map->stripes[i].map);
+
+        if (!iterator)
+        {
+            healthy = false;
+        }
+
+        /* Each key must live in the stripe it is routed to. */
+        while (healthy && unordered_map_iterator_has_next(iterator))
+        {
+            unordered_map_iterator_next(iterator, &key, &value);
+            healthy = get_stripe_index(map, map->hash_function(key)) == i;
+        }
+
+        unordered_map_iterator_free(iterator);
+        mtx_unlock(&map->stripes[i].lock);
+    }
+
+    return healthy;
+}
+
+void concurrent_unordered_map_free(concurrent_unordered_map* map)
+{
+    size_t i;
+
+    if (!map)
+    {
+        return;
+    }
+
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        mtx_destroy(&map->stripes[i].lock);
+        unordered_map_free(map->stripes[i].map);
+    }
+
+    free(map->stripes);
+    free(map);
+}
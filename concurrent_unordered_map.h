@@ -0,0 +1,175 @@
+#ifndef CONCURRENT_UNORDERED_MAP_H
+#define	CONCURRENT_UNORDERED_MAP_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef struct concurrent_unordered_map concurrent_unordered_map;
+
+    /***************************************************************************
+    * Allocates a new, empty map with given hash function and given equality   *
+    * testing function, that may be used by several threads at a time. The     *
+    * keys are spread over 'stripes' stripes, rounded up to a power of two, or *
+    * 64 if 'stripes' is 0, and at most 65536. Each stripe is an               *
+    * 'unordered_map' of its own with its own lock, and grows on its own, so   *
+    * threads working on different stripes never wait for each other.          *
+    * 'initial_capacity' is split evenly over the stripes. Returns NULL if out *
+    * of memory.                                                               *
+    ***************************************************************************/
+    concurrent_unordered_map* concurrent_unordered_map_alloc
+           (size_t   initial_capacity,
+            float    load_factor,
+            size_t   stripes,
+            size_t (*hash_function)(void*),
+            bool   (*equals_function)(void*, void*));
+
+    /***************************************************************************
+    * If the map does not contain the key, inserts it in the map, associates   *
+    * the value with it and returns NULL. Otherwise updates the value and      *
+    * returns the old value. Aborts if out of memory, like                     *
+    * 'unordered_map_put'.                                                     *
+    ***************************************************************************/
+    void* concurrent_unordered_map_put(concurrent_unordered_map* map,
+                                       void* key,
+                                       void* value);
+
+    /***************************************************************************
+    * Maps the key to 'function(key, value, context)', where 'value' is the    *
+    * value currently associated with the key, or NULL if the key is not       *
+    * mapped, while holding the lock of the stripe of the key. This is the way *
+    * to update a value atomically. 'function' must not call back into the     *
+    * map. Returns false if out of memory. There is no counterpart of          *
+    * 'unordered_map_get_or_insert', since its slot would be used after the    *
+    * lock is released.                                                        *
+    ***************************************************************************/
+    bool concurrent_unordered_map_compute(concurrent_unordered_map* map,
+                                          void* key,
+                                          void* (*function)(void*,
+                                                            void*,
+                                                            void*),
+                                          void* context);
+
+    /***************************************************************************
+    * Reserves room for 'n / stripes' mappings, rounded up, in each stripe,    *
+    * which is the share of each stripe when the keys spread evenly. A stripe  *
+    * that gets more keys grows on its own. Returns false if out of memory.    *
+    ***************************************************************************/
+    bool concurrent_unordered_map_reserve(concurrent_unordered_map* map,
+                                          size_t n);
+
+    /***************************************************************************
+    * Maps each 'keys[i]' to 'values[i]' for 'i' from 0 to 'n - 1'. The keys   *
+    * are hashed and grouped by stripe first, and then each stripe is locked   *
+    * once, sized once and filled. The mappings become visible stripe by       *
+    * stripe, not all at once. Returns false if out of memory, in which case   *
+    * only some of the stripes may have received their mappings.               *
+    ***************************************************************************/
+    bool concurrent_unordered_map_put_all(concurrent_unordered_map* map,
+                                          void** keys,
+                                          void** values,
+                                          size_t n);
+
+    /***************************************************************************
+    * Returns true if the key is mapped to some value in this map.             *
+    ***************************************************************************/
+    bool concurrent_unordered_map_contains_key(concurrent_unordered_map* map,
+                                               void* key);
+
+    /***************************************************************************
+    * Returns the value associated with the key, or NULL if the key is not     *
+    * mapped in the map.                                                       *
+    ***************************************************************************/
+    void* concurrent_unordered_map_get(concurrent_unordered_map* map,
+                                       void* key);
+
+    /***************************************************************************
+    * Stores in 'out_values[i]' the value associated with 'keys[i]', or NULL   *
+    * if that key is not mapped, for 'i' from 0 to 'n - 1'. The keys are       *
+    * grouped by stripe, so that each stripe is locked once per batch. If the  *
+    * grouping runs out of memory, each key takes its own lock instead.        *
+    ***************************************************************************/
+    void concurrent_unordered_map_get_batch(concurrent_unordered_map* map,
+                                            void** keys,
+                                            size_t n,
+                                            void** out_values);
+
+    /***************************************************************************
+    * If the key is mapped in the map, removes the mapping and returns the     *
+    * value of that mapping. If the map did not contain the mapping, returns   *
+    * NULL.                                                                    *
+    ***************************************************************************/
+    void* concurrent_unordered_map_remove(concurrent_unordered_map* map,
+                                          void* key);
+
+    /***************************************************************************
+    * Removes all the contents of the map, one stripe at a time.               *
+    ***************************************************************************/
+    void concurrent_unordered_map_clear(concurrent_unordered_map* map);
+
+    /***************************************************************************
+    * Returns the size of the map, summed over the stripes one stripe at a     *
+    * time. While other threads modify the map, the result is only a snapshot  *
+    * of each stripe, not of the whole map.                                    *
+    ***************************************************************************/
+    size_t concurrent_unordered_map_size(concurrent_unordered_map* map);
+
+    /***************************************************************************
+    * Returns the number of buckets in the tables of all the stripes.          *
+    ***************************************************************************/
+    size_t concurrent_unordered_map_bucket_count
+        (concurrent_unordered_map* map);
+
+    /***************************************************************************
+    * Calls 'unordered_map_set_incremental_rehash' on each stripe.             *
+    ***************************************************************************/
+    void concurrent_unordered_map_set_incremental_rehash
+        (concurrent_unordered_map* map, size_t buckets_per_operation);
+
+    /***************************************************************************
+    * Calls 'unordered_map_set_low_water_mark' on each stripe.                 *
+    ***************************************************************************/
+    void concurrent_unordered_map_set_low_water_mark
+        (concurrent_unordered_map* map, float low_water_mark);
+
+    /***************************************************************************
+    * Calls 'unordered_map_shrink_to_fit' on each stripe. Returns false if out *
+    * of memory.                                                               *
+    ***************************************************************************/
+    bool concurrent_unordered_map_shrink_to_fit
+        (concurrent_unordered_map* map);
+
+    /***************************************************************************
+    * Calls 'function(key, value, context)' for each mapping, visiting the     *
+    * stripes one at a time while holding the lock of the visited stripe.      *
+    * 'function' must not call back into the map. This takes the place of the  *
+    * iterator of 'unordered_map', which could not hold a lock between calls.  *
+    * Returns false, having visited only some of the stripes, if out of        *
+    * memory.                                                                  *
+    ***************************************************************************/
+    bool concurrent_unordered_map_for_each(concurrent_unordered_map* map,
+                                           void (*function)(void*,
+                                                            void*,
+                                                            void*),
+                                           void* context);
+
+    /***************************************************************************
+    * Checks that the map is in valid state.                                   *
+    ***************************************************************************/
+    bool concurrent_unordered_map_is_healthy(concurrent_unordered_map* map);
+
+    /***************************************************************************
+    * Deallocates the entire map. Only the map and its stripes are             *
+    * deallocated. The user is responsible for deallocating the actual data    *
+    * stored in the map. No other thread may use the map at this point.        *
+    ***************************************************************************/
+    void concurrent_unordered_map_free(concurrent_unordered_map* map);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CONCURRENT_UNORDERED_MAP_H */
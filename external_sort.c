@@ -0,0 +1,581 @@
+#include "external_sort.h"
+#include "stable_sort.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Merging more runs at a time would leave each run a buffer too small to
+// amortize the seek that precedes every refill:
+static const size_t MAXIMUM_FAN_IN = 64;
+
+// The number of temporary output names tried before giving up:
+static const unsigned MAXIMUM_TEMPORARY_NAMES = 100;
+
+typedef struct run
+{
+    fpos_t position;
+    size_t length;
+}
+run;
+
+/*******************************************************************************
+* A temporary file holding sorted runs one after another. The run positions    *
+* are kept as 'fpos_t', since 'long' offsets may not address large files.      *
+*******************************************************************************/
+typedef struct run_file
+{
+    FILE* file;
+    run* runs;
+    size_t count;
+    size_t capacity;
+}
+run_file;
+
+typedef struct run_reader
+{
+    fpos_t position;
+    size_t remaining;
+    char* buffer;
+    char* head;
+    char* upper_bound;
+    size_t capacity;
+}
+run_reader;
+
+typedef struct run_merger
+{
+    FILE* file;
+    run_reader* readers;
+    size_t* heap;
+    size_t heap_size;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+}
+run_merger;
+
+static size_t min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+static bool run_file_add(run_file *const runs,
+                         const fpos_t* position,
+                         const size_t length)
+{
+    if (runs->count == runs->capacity)
+    {
+        const size_t capacity = runs->capacity ? 2 * runs->capacity : 16;
+        run* new_runs = realloc(runs->runs, sizeof(run) * capacity);
+
+        if (!new_runs)
+        {
+            return false;
+        }
+
+        runs->runs = new_runs;
+        runs->capacity = capacity;
+    }
+
+    runs->runs[runs->count].position = *position;
+    runs->runs[runs->count].length = length;
+    runs->count++;
+    return true;
+}
+
+static void run_file_free(run_file *const runs)
+{
+    if (runs->file)
+    {
+        fclose(runs->file);
+    }
+
+    free(runs->runs);
+    runs->file = NULL;
+    runs->runs = NULL;
+    runs->count = 0;
+    runs->capacity = 0;
+}
+
+/*******************************************************************************
+* Returns the largest number of records that fit in 'memory_budget' bytes      *
+* together with the scratch memory 'stable_sort_with_buffer' needs for them.   *
+*******************************************************************************/
+static size_t get_chunk_length(const size_t record_size,
+                               const size_t memory_budget)
+{
+    size_t chunk_length = memory_budget / record_size;
+
+    while (chunk_length > 0
+            && chunk_length * record_size
+               + stable_sort_scratch_size(chunk_length, record_size)
+               > memory_budget)
+    {
+        chunk_length -= chunk_length / 16 + 1;
+    }
+
+    return chunk_length;
+}
+
+/*******************************************************************************
+* Reads the input file chunk by chunk, sorts each chunk in 'memory' and        *
+* appends it to a temporary run file. If the whole input fits in one chunk, no *
+* file is written and the sorted records are left in 'memory' instead; their   *
+* count is stored in 'in_memory_length'.                                       *
+*******************************************************************************/
+static external_sort_status build_runs(
+                                FILE* input,
+                                const size_t size,
+                                const int (*cmp)(const void*, const void*),
+                                char* memory,
+                                const size_t memory_budget,
+                                run_file *const runs,
+                                size_t* in_memory_length)
+{
+    const size_t chunk_length = get_chunk_length(size, memory_budget);
+    char* scratch = memory + chunk_length * size;
+    const size_t scratch_size = memory_budget - chunk_length * size;
+
+    *in_memory_length = 0;
+
+    for (;;)
+    {
+        const size_t bytes = fread(memory, 1, chunk_length * size, input);
+
+        if (ferror(input))
+        {
+            return EXTERNAL_SORT_IO_ERROR;
+        }
+
+        if (bytes % size != 0)
+        {
+            return EXTERNAL_SORT_INVALID_ARGUMENT;
+        }
+
+        if (bytes == 0)
+        {
+            return EXTERNAL_SORT_SUCCESS;
+        }
+
+        const size_t num = bytes / size;
+
+        // The scratch follows whole records, so it is aligned for the record
+        // type just like 'memory' itself:
+        stable_sort_with_buffer(memory, num, size, cmp, scratch, scratch_size);
+
+        if (!runs->file)
+        {
+            if (num < chunk_length)
+            {
+                *in_memory_length = num;
+                return EXTERNAL_SORT_SUCCESS;
+            }
+
+            if (!(runs->file = tmpfile()))
+            {
+                return EXTERNAL_SORT_IO_ERROR;
+            }
+        }
+
+        fpos_t position;
+
+        if (fgetpos(runs->file, &position) != 0
+                || fwrite(memory, size, num, runs->file) != num)
+        {
+            return EXTERNAL_SORT_IO_ERROR;
+        }
+
+        if (!run_file_add(runs, &position, num))
+        {
+            return EXTERNAL_SORT_OUT_OF_MEMORY;
+        }
+    }
+}
+
+/*******************************************************************************
+* Refills the buffer of the reader from where it left off in 'file'. Returns   *
+* false if the records cannot be read.                                         *
+*******************************************************************************/
+static bool run_reader_fill(run_reader *const reader,
+                            FILE* file,
+                            const size_t size)
+{
+    const size_t num = min(reader->capacity, reader->remaining);
+
+    if (fsetpos(file, &reader->position) != 0
+            || fread(reader->buffer, size, num, file) != num
+            || fgetpos(file, &reader->position) != 0)
+    {
+        return false;
+    }
+
+    reader->remaining  -= num;
+    reader->head        = reader->buffer;
+    reader->upper_bound = reader->buffer + num * size;
+    return true;
+}
+
+/*******************************************************************************
+* Returns true if the current record of run 'a' goes before the current record *
+* of run 'b'. Ties go to the run that comes first in the input.                *
+*******************************************************************************/
+static bool run_precedes(const run_merger *const merger,
+                         const size_t a,
+                         const size_t b)
+{
+    const int c = merger->cmp(merger->readers[a].head,
+                              merger->readers[b].head);
+    return c < 0 || (c == 0 && a < b);
+}
+
+static void sift_down(run_merger *const merger, size_t index)
+{
+    size_t* heap = merger->heap;
+    const size_t run = heap[index];
+
+    for (;;)
+    {
+        size_t child = 2 * index + 1;
+
+        if (child >= merger->heap_size)
+        {
+            break;
+        }
+
+        if (child + 1 < merger->heap_size
+                && run_precedes(merger, heap[child + 1], heap[child]))
+        {
+            child++;
+        }
+
+        if (!run_precedes(merger, heap[child], run))
+        {
+            break;
+        }
+
+        heap[index] = heap[child];
+        index = child;
+    }
+
+    heap[index] = run;
+}
+
+/*******************************************************************************
+* Merges the 'count' runs starting from 'runs' stored in 'file' and appends    *
+* the result to 'output'. The 'memory_budget' bytes at 'memory' are split      *
+* evenly into the input buffers and the output buffer.                         *
+*******************************************************************************/
+static external_sort_status merge_runs(FILE* file,
+                                       const run* runs,
+                                       const size_t count,
+                                       FILE* output,
+                                       const size_t size,
+                                       const int (*cmp)(const void*,
+                                                        const void*),
+                                       char* memory,
+                                       const size_t memory_budget)
+{
+    run_merger merger;
+    merger.file    = file;
+    merger.readers = malloc(sizeof(run_reader) * count);
+    merger.heap    = malloc(sizeof(size_t) * count);
+    merger.heap_size = 0;
+    merger.size = size;
+    merger.cmp  = cmp;
+
+    if (!merger.readers || !merger.heap)
+    {
+        free(merger.readers);
+        free(merger.heap);
+        return EXTERNAL_SORT_OUT_OF_MEMORY;
+    }
+
+    const size_t buffer_length = memory_budget / (size * (count + 1));
+    char* output_buffer = memory + count * buffer_length * size;
+    char* output_head = output_buffer;
+    char* output_upper_bound = output_buffer + buffer_length * size;
+    external_sort_status status = EXTERNAL_SORT_SUCCESS;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        run_reader *const reader = &merger.readers[i];
+        reader->position  = runs[i].position;
+        reader->remaining = runs[i].length;
+        reader->buffer    = memory + i * buffer_length * size;
+        reader->capacity  = buffer_length;
+
+        if (!run_reader_fill(reader, file, size))
+        {
+            status = EXTERNAL_SORT_IO_ERROR;
+        }
+        else if (reader->head != reader->upper_bound)
+        {
+            merger.heap[merger.heap_size++] = i;
+        }
+    }
+
+    for (size_t i = merger.heap_size; i > 0; --i)
+    {
+        sift_down(&merger, i - 1);
+    }
+
+    while (status == EXTERNAL_SORT_SUCCESS && merger.heap_size > 0)
+    {
+        run_reader *const reader = &merger.readers[merger.heap[0]];
+
+        memcpy(output_head, reader->head, size);
+        output_head += size;
+        reader->head += size;
+
+        if (output_head == output_upper_bound)
+        {
+            if (fwrite(output_buffer, size, buffer_length, output)
+                    != buffer_length)
+            {
+                status = EXTERNAL_SORT_IO_ERROR;
+            }
+
+            output_head = output_buffer;
+        }
+
+        if (reader->head == reader->upper_bound)
+        {
+            if (reader->remaining == 0)
+            {
+                merger.heap[0] = merger.heap[--merger.heap_size];
+            }
+            else if (!run_reader_fill(reader, file, size))
+            {
+                status = EXTERNAL_SORT_IO_ERROR;
+            }
+        }
+
+        if (merger.heap_size > 0)
+        {
+            sift_down(&merger, 0);
+        }
+    }
+
+    const size_t remaining = (output_head - output_buffer) / size;
+
+    if (status == EXTERNAL_SORT_SUCCESS
+            && fwrite(output_buffer, size, remaining, output) != remaining)
+    {
+        status = EXTERNAL_SORT_IO_ERROR;
+    }
+
+    free(merger.heap);
+    free(merger.readers);
+    return status;
+}
+
+/*******************************************************************************
+* Merges groups of 'fan_in' adjacent runs into a new run file until at most    *
+* 'fan_in' runs remain.                                                        *
+*******************************************************************************/
+static external_sort_status reduce_runs(
+                                run_file *const runs,
+                                const size_t fan_in,
+                                const size_t size,
+                                const int (*cmp)(const void*, const void*),
+                                char* memory,
+                                const size_t memory_budget)
+{
+    while (runs->count > fan_in)
+    {
+        run_file merged = { tmpfile(), NULL, 0, 0 };
+
+        if (!merged.file)
+        {
+            return EXTERNAL_SORT_IO_ERROR;
+        }
+
+        for (size_t i = 0; i < runs->count; i += fan_in)
+        {
+            const size_t count = min(fan_in, runs->count - i);
+            size_t length = 0;
+            fpos_t position;
+
+            for (size_t j = i; j < i + count; ++j)
+            {
+                length += runs->runs[j].length;
+            }
+
+            external_sort_status status = EXTERNAL_SORT_IO_ERROR;
+
+            if (fgetpos(merged.file, &position) == 0)
+            {
+                status = merge_runs(runs->file,
+                                    runs->runs + i,
+                                    count,
+                                    merged.file,
+                                    size,
+                                    cmp,
+                                    memory,
+                                    memory_budget);
+            }
+
+            if (status == EXTERNAL_SORT_SUCCESS
+                    && !run_file_add(&merged, &position, length))
+            {
+                status = EXTERNAL_SORT_OUT_OF_MEMORY;
+            }
+
+            if (status != EXTERNAL_SORT_SUCCESS)
+            {
+                run_file_free(&merged);
+                return status;
+            }
+        }
+
+        run_file_free(runs);
+        *runs = merged;
+    }
+
+    return EXTERNAL_SORT_SUCCESS;
+}
+
+/*******************************************************************************
+* Creates a new file named 'output_path' followed by ".tmp" and a number, and  *
+* stores its name in 'temporary_path', which must hold 'path_capacity' bytes.  *
+* The file is in the directory of the output, so that it can be renamed over   *
+* the output. Returns NULL if no such file can be created.                     *
+*******************************************************************************/
+static FILE* open_temporary_output(const char* output_path,
+                                   char* temporary_path,
+                                   const size_t path_capacity)
+{
+    for (unsigned i = 0; i < MAXIMUM_TEMPORARY_NAMES; ++i)
+    {
+        snprintf(temporary_path, path_capacity, "%s.tmp%u", output_path, i);
+
+        // The 'x' mode fails instead of truncating an existing file:
+        FILE* file = fopen(temporary_path, "wbx");
+
+        if (file)
+        {
+            return file;
+        }
+    }
+
+    return NULL;
+}
+
+external_sort_status external_sort(
+                        const char* input_path,
+                        const char* output_path,
+                        const size_t record_size,
+                        const int (*cmp)(const void*, const void*),
+                        const size_t memory_budget)
+{
+    if (!input_path || !output_path || !cmp || record_size == 0)
+    {
+        return EXTERNAL_SORT_INVALID_ARGUMENT;
+    }
+
+    if (memory_budget / record_size < 3)
+    {
+        return EXTERNAL_SORT_BUDGET_TOO_SMALL;
+    }
+
+    const size_t fan_in = min(MAXIMUM_FAN_IN,
+                              memory_budget / record_size - 1);
+    char* memory = malloc(memory_budget);
+
+    if (!memory)
+    {
+        return EXTERNAL_SORT_OUT_OF_MEMORY;
+    }
+
+    FILE* input = fopen(input_path, "rb");
+
+    if (!input)
+    {
+        free(memory);
+        return EXTERNAL_SORT_IO_ERROR;
+    }
+
+    run_file runs = { NULL, NULL, 0, 0 };
+    size_t in_memory_length;
+    external_sort_status status = build_runs(input,
+                                             record_size,
+                                             cmp,
+                                             memory,
+                                             memory_budget,
+                                             &runs,
+                                             &in_memory_length);
+    fclose(input);
+
+    if (status == EXTERNAL_SORT_SUCCESS)
+    {
+        status = reduce_runs(&runs,
+                             fan_in,
+                             record_size,
+                             cmp,
+                             memory,
+                             memory_budget);
+    }
+
+    // The result goes to a temporary file first, so that an error leaves the
+    // output file, and thus an input file of the same name, untouched:
+    const size_t path_capacity = strlen(output_path) + sizeof(".tmp") + 10;
+    char* temporary_path = NULL;
+
+    if (status == EXTERNAL_SORT_SUCCESS
+            && !(temporary_path = malloc(path_capacity)))
+    {
+        status = EXTERNAL_SORT_OUT_OF_MEMORY;
+    }
+
+    if (status == EXTERNAL_SORT_SUCCESS)
+    {
+        FILE* output = open_temporary_output(output_path,
+                                             temporary_path,
+                                             path_capacity);
+
+        if (!output)
+        {
+            status = EXTERNAL_SORT_IO_ERROR;
+        }
+        else
+        {
+            if (runs.count > 0)
+            {
+                status = merge_runs(runs.file,
+                                    runs.runs,
+                                    runs.count,
+                                    output,
+                                    record_size,
+                                    cmp,
+                                    memory,
+                                    memory_budget);
+            }
+            else if (fwrite(memory, record_size, in_memory_length, output)
+                     != in_memory_length)
+            {
+                status = EXTERNAL_SORT_IO_ERROR;
+            }
+
+            if (fclose(output) != 0 && status == EXTERNAL_SORT_SUCCESS)
+            {
+                status = EXTERNAL_SORT_IO_ERROR;
+            }
+
+            if (status == EXTERNAL_SORT_SUCCESS
+                    && rename(temporary_path, output_path) != 0)
+            {
+                status = EXTERNAL_SORT_IO_ERROR;
+            }
+
+            if (status != EXTERNAL_SORT_SUCCESS)
+            {
+                remove(temporary_path);
+            }
+        }
+    }
+
+    run_file_free(&runs);
+    free(temporary_path);
+    free(memory);
+    return status;
+}
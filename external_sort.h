@@ -0,0 +1,49 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef enum external_sort_status
+    {
+        EXTERNAL_SORT_SUCCESS = 0,
+        EXTERNAL_SORT_INVALID_ARGUMENT,
+        EXTERNAL_SORT_BUDGET_TOO_SMALL,
+        EXTERNAL_SORT_OUT_OF_MEMORY,
+        EXTERNAL_SORT_IO_ERROR
+    }
+    external_sort_status;
+
+    /***************************************************************************
+    * Sorts the file 'input_path' of fixed-size records each 'record_size'     *
+    * bytes long using comparator 'comparator' and writes the result to the    *
+    * file 'output_path', which may be the same as 'input_path'. At most       *
+    * 'memory_budget' bytes are used for the records: the input is read in     *
+    * chunks that fit in the budget, each chunk is sorted by 'stable_sort'     *
+    * and written to a temporary file as a sorted run, and finally the runs    *
+    * are merged with large buffered reads, at most 64 runs at a time. The     *
+    * result is written to a new file next to 'output_path', which is then     *
+    * renamed to 'output_path', so that an error leaves 'output_path' as it    *
+    * was. This sort is stable.                                                *
+    *                                                                          *
+    * Returns EXTERNAL_SORT_INVALID_ARGUMENT if an argument is NULL or zero,   *
+    * or if the size of the input file is not a multiple of 'record_size';     *
+    * EXTERNAL_SORT_BUDGET_TOO_SMALL if the budget does not hold at least      *
+    * three records; EXTERNAL_SORT_OUT_OF_MEMORY if the budget cannot be       *
+    * allocated; and EXTERNAL_SORT_IO_ERROR if a file cannot be opened, read   *
+    * or written.                                                              *
+    ***************************************************************************/
+    external_sort_status external_sort(
+                            const char* input_path,
+                            const char* output_path,
+                            const size_t record_size,
+                            const int (*comparator)(const void*, const void*),
+                            const size_t memory_budget);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* EXTERNAL_SORT_H */
@@ -0,0 +1,665 @@
+#include "flat_unordered_map.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+                      || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLAT_UNORDERED_MAP_SSE2
+#endif
+
+/* The number of control bytes probed at a time. */
+#define GROUP_WIDTH 16
+
+/*******************************************************************************
+* Each slot has a control byte. A full slot stores the 7 low bits of its hash  *
+* in its control byte, so the sign bit is set only for the empty and deleted   *
+* slots.                                                                       *
+*******************************************************************************/
+static const signed char CONTROL_EMPTY   = -128;
+static const signed char CONTROL_DELETED = -2;
+
+static const float  MINIMUM_LOAD_FACTOR      = 0.2f;
+static const float  MAXIMUM_LOAD_FACTOR      = 0.875f;
+static const size_t MINIMUM_INITIAL_CAPACITY = GROUP_WIDTH;
+
+/* Bit 'i' is set if the control byte 'i' of a group matches. */
+typedef unsigned int group_mask;
+
+typedef struct flat_unordered_map_slot {
+    void* key;
+    void* value;
+} flat_unordered_map_slot;
+
+struct flat_unordered_map {
+    signed char*             control;
+    flat_unordered_map_slot* slots;
+    size_t                 (*hash_function)(void*);
+    bool                   (*equals_function)(void*, void*);
+    size_t                   mod_count;
+    size_t                   table_capacity;
+    size_t                   size;
+    size_t                   deleted_count;
+    size_t                   max_allowed_size;
+    size_t                   mask;
+    float                    load_factor;
+};
+
+struct flat_unordered_map_iterator {
+    flat_unordered_map* map;
+    size_t              next_index;
+    size_t              iterated_count;
+    size_t              expected_mod_count;
+};
+
+#ifdef FLAT_UNORDERED_MAP_SSE2
+
+static group_mask match_byte(const signed char* group, signed char byte)
+{
+    __m128i control = _mm_loadu_si128((const __m128i*) group);
+    return (group_mask) _mm_movemask_epi8(
+                            _mm_cmpeq_epi8(_mm_set1_epi8(byte), control));
+}
+
+static group_mask match_empty_or_deleted(const signed char* group)
+{
+    return (group_mask) _mm_movemask_epi8(
+                            _mm_loadu_si128((const __m128i*) group));
+}
+
+#else
+
+static group_mask match_byte(const signed char* group, signed char byte)
+{
+    group_mask mask = 0;
+    int i;
+
+    for (i = 0; i < GROUP_WIDTH; ++i)
+    {
+        if (group[i] == byte)
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+}
+
+static group_mask match_empty_or_deleted(const signed char* group)
+{
+    group_mask mask = 0;
+    int i;
+
+    for (i = 0; i < GROUP_WIDTH; ++i)
+    {
+        if (group[i] < 0)
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+}
+
+#endif
+
+static group_mask match_empty(const signed char* group)
+{
+    return match_byte(group, CONTROL_EMPTY);
+}
+
+/*******************************************************************************
+* Returns the index of the lowest set bit in a nonzero 'mask'.                 *
+*******************************************************************************/
+static unsigned int trailing_zeros(group_mask mask)
+{
+#ifdef __GNUC__
+    return (unsigned int) __builtin_ctz(mask);
+#else
+    unsigned int count = 0;
+
+    while (!(mask & 1u))
+    {
+        mask >>= 1;
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+/*******************************************************************************
+* Returns the number of unset bits above the highest set bit in a nonzero      *
+* 'mask' of 'GROUP_WIDTH' bits.                                                *
+*******************************************************************************/
+static unsigned int leading_zeros(group_mask mask)
+{
+    unsigned int count = 0;
+
+    while (!(mask & (1u << (GROUP_WIDTH - 1))))
+    {
+        mask <<= 1;
+        count++;
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+* Spreads the bits of a user hash, which may well be the identity, over the    *
+* whole word so that both the slot index and the 7-bit tag are well mixed.     *
+*******************************************************************************/
+static size_t mix_hash(size_t hash)
+{
+    hash *= (size_t) 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> (sizeof(size_t) * 4));
+}
+
+static signed char hash_tag(size_t hash)
+{
+    return (signed char)(hash & 0x7f);
+}
+
+/*******************************************************************************
+* Sets the control byte of the slot at 'index'. The first 'GROUP_WIDTH - 1'    *
+* control bytes are mirrored past the end of the table so that a group load    *
+* starting near the end wraps around without any special case.                 *
+*******************************************************************************/
+static void set_control(flat_unordered_map* map,
+                        size_t index,
+                        signed char control)
+{
+    map->control[index] = control;
+
+    if (index < GROUP_WIDTH - 1)
+    {
+        map->control[map->table_capacity + index] = control;
+    }
+}
+
+/*******************************************************************************
+* Returns the index of the slot holding 'key', or the table capacity if there  *
+* is no such slot. The groups are probed in triangular steps, which visit      *
+* every group of a power-of-two table. Most keys sit in the first slot of      *
+* their probe sequence, so that slot is prefetched while the control bytes     *
+* are still loading.                                                           *
+*******************************************************************************/
+static inline size_t find_index(flat_unordered_map* map, void* key, size_t hash)
+{
+    size_t position = (hash >> 7) & map->mask;
+    size_t step = 0;
+    size_t index;
+    group_mask mask;
+
+#ifdef __GNUC__
+    __builtin_prefetch(map->slots + position);
+#endif
+
+    for (;;)
+    {
+        mask = match_byte(map->control + position, hash_tag(hash));
+
+        while (mask)
+        {
+            index = (position + trailing_zeros(mask)) & map->mask;
+
+            if (map->equals_function(key, map->slots[index].key))
+            {
+                return index;
+            }
+
+            mask &= mask - 1;
+        }
+
+        if (match_empty(map->control + position))
+        {
+            return map->table_capacity;
+        }
+
+        step += GROUP_WIDTH;
+        position = (position + step) & map->mask;
+    }
+}
+
+/*******************************************************************************
+* Returns the index of the first empty or deleted slot on the probe sequence   *
+* of 'hash'.                                                                   *
+*******************************************************************************/
+static size_t find_insert_index(flat_unordered_map* map, size_t hash)
+{
+    size_t position = (hash >> 7) & map->mask;
+    size_t step = 0;
+    group_mask mask;
+
+    for (;;)
+    {
+        mask = match_empty_or_deleted(map->control + position);
+
+        if (mask)
+        {
+            return (position + trailing_zeros(mask)) & map->mask;
+        }
+
+        step += GROUP_WIDTH;
+        position = (position + step) & map->mask;
+    }
+}
+
+static float fix_load_factor(float load_factor)
+{
+    if (load_factor < MINIMUM_LOAD_FACTOR)
+    {
+        return MINIMUM_LOAD_FACTOR;
+    }
+
+    if (load_factor > MAXIMUM_LOAD_FACTOR)
+    {
+        return MAXIMUM_LOAD_FACTOR;
+    }
+
+    return load_factor;
+}
+
+/*******************************************************************************
+* Makes sure that the initial capacity is no less than a minimum allowed and   *
+* is a power of two.                                                           *
+*******************************************************************************/
+static size_t fix_initial_capacity(size_t initial_capacity)
+{
+    size_t ret = MINIMUM_INITIAL_CAPACITY;
+
+    while (ret < initial_capacity)
+    {
+        ret <<= 1;
+    }
+
+    return ret;
+}
+
+/*******************************************************************************
+* Allocates the control bytes and the slots of a table of 'capacity' slots     *
+* and makes it the table of the map. Returns false and leaves the map intact   *
+* if out of memory.                                                            *
+*******************************************************************************/
+static bool allocate_table(flat_unordered_map* map, size_t capacity)
+{
+    signed char* control = malloc(capacity + GROUP_WIDTH);
+    flat_unordered_map_slot* slots = malloc(sizeof(*slots) * capacity);
+
+    if (!control || !slots)
+    {
+        free(control);
+        free(slots);
+        return false;
+    }
+
+    memset(control, CONTROL_EMPTY, capacity + GROUP_WIDTH);
+
+    map->control          = control;
+    map->slots            = slots;
+    map->table_capacity   = capacity;
+    map->mask             = capacity - 1;
+    map->deleted_count    = 0;
+    map->max_allowed_size = (size_t)(capacity * map->load_factor);
+
+    return true;
+}
+
+flat_unordered_map* flat_unordered_map_alloc(size_t initial_capacity,
+                                             float load_factor,
+                                             size_t (*hash_function)(void*),
+                                             bool (*equals_function)(void*,
+                                                                     void*))
+{
+    flat_unordered_map* map;
+
+    if (!hash_function || !equals_function)
+    {
+        return NULL;
+    }
+
+    map = malloc(sizeof(*map));
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    map->load_factor     = fix_load_factor(load_factor);
+    map->size            = 0;
+    map->mod_count       = 0;
+    map->hash_function   = hash_function;
+    map->equals_function = equals_function;
+
+    if (!allocate_table(map, fix_initial_capacity(initial_capacity)))
+    {
+        free(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+/*******************************************************************************
+* Moves all the entries to a fresh table of 'new_capacity' slots, dropping the *
+* deleted slots on the way. Returns false if out of memory.                    *
+*******************************************************************************/
+static bool rehash(flat_unordered_map* map, size_t new_capacity)
+{
+    signed char* old_control = map->control;
+    flat_unordered_map_slot* old_slots = map->slots;
+    size_t old_capacity = map->table_capacity;
+    size_t hash;
+    size_t index;
+    size_t i;
+
+    if (!allocate_table(map, new_capacity))
+    {
+        return false;
+    }
+
+    for (i = 0; i < old_capacity; ++i)
+    {
+        if (old_control[i] >= 0)
+        {
+            hash  = mix_hash(map->hash_function(old_slots[i].key));
+            index = find_insert_index(map, hash);
+            set_control(map, index, hash_tag(hash));
+            map->slots[index] = old_slots[i];
+        }
+    }
+
+    free(old_control);
+    free(old_slots);
+    return true;
+}
+
+void* flat_unordered_map_put(flat_unordered_map* map, void* key, void* value)
+{
+    size_t hash;
+    size_t index;
+    size_t new_capacity;
+    void* old_value;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    hash  = mix_hash(map->hash_function(key));
+    index = find_index(map, key, hash);
+
+    if (index != map->table_capacity)
+    {
+        old_value = map->slots[index].value;
+        map->slots[index].value = value;
+        return old_value;
+    }
+
+    index = find_insert_index(map, hash);
+
+    /* Only filling an empty slot uses up the load factor budget. */
+    if (map->control[index] == CONTROL_EMPTY
+            && map->size + map->deleted_count >= map->max_allowed_size)
+    {
+        /* Mostly deleted slots are cleaned up without growing the table. */
+        new_capacity = map->size >= map->max_allowed_size / 2 ?
+                       2 * map->table_capacity :
+                       map->table_capacity;
+
+        /* Keep at least one empty slot, or the probing would not stop. */
+        if (!rehash(map, new_capacity)
+                && map->size + map->deleted_count + 2 > map->table_capacity)
+        {
+            return NULL;
+        }
+
+        index = find_insert_index(map, hash);
+    }
+
+    if (map->control[index] == CONTROL_DELETED)
+    {
+        map->deleted_count--;
+    }
+
+    set_control(map, index, hash_tag(hash));
+    map->slots[index].key   = key;
+    map->slots[index].value = value;
+    map->size++;
+    map->mod_count++;
+
+    return NULL;
+}
+
+bool flat_unordered_map_contains_key(flat_unordered_map* map, void* key)
+{
+    if (!map)
+    {
+        return false;
+    }
+
+    return find_index(map, key, mix_hash(map->hash_function(key)))
+           != map->table_capacity;
+}
+
+void* flat_unordered_map_get(flat_unordered_map* map, void* key)
+{
+    size_t index;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    index = find_index(map, key, mix_hash(map->hash_function(key)));
+    return index != map->table_capacity ? map->slots[index].value : NULL;
+}
+
+void* flat_unordered_map_remove(flat_unordered_map* map, void* key)
+{
+    size_t index;
+    size_t index_before;
+    group_mask empty_before;
+    group_mask empty_after;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    index = find_index(map, key, mix_hash(map->hash_function(key)));
+
+    if (index == map->table_capacity)
+    {
+        return NULL;
+    }
+
+    /* If every group covering the slot has an empty slot, no probe has ever
+       passed this slot, and it may become empty instead of deleted. */
+    index_before = (index - GROUP_WIDTH) & map->mask;
+    empty_before = match_empty(map->control + index_before);
+    empty_after  = match_empty(map->control + index);
+
+    if (empty_before && empty_after
+            && leading_zeros(empty_before) + trailing_zeros(empty_after)
+               < GROUP_WIDTH)
+    {
+        set_control(map, index, CONTROL_EMPTY);
+    }
+    else
+    {
+        set_control(map, index, CONTROL_DELETED);
+        map->deleted_count++;
+    }
+
+    map->size--;
+    map->mod_count++;
+    return map->slots[index].value;
+}
+
+void flat_unordered_map_clear(flat_unordered_map* map)
+{
+    if (!map)
+    {
+        return;
+    }
+
+    memset(map->control, CONTROL_EMPTY, map->table_capacity + GROUP_WIDTH);
+
+    map->mod_count    += map->size;
+    map->size          = 0;
+    map->deleted_count = 0;
+}
+
+size_t flat_unordered_map_size(flat_unordered_map* map)
+{
+    return map ? map->size : 0;
+}
+
+bool flat_unordered_map_is_healthy(flat_unordered_map* map)
+{
+    size_t full_count;
+    size_t deleted_count;
+    size_t i;
+
+    if (!map)
+    {
+        return false;
+    }
+
+    full_count    = 0;
+    deleted_count = 0;
+
+    for (i = 0; i < map->table_capacity; ++i)
+    {
+        if (map->control[i] >= 0)
+        {
+            if (map->control[i]
+                    != hash_tag(mix_hash(map->hash_function(
+                                                 map->slots[i].key))))
+            {
+                return false;
+            }
+
+            full_count++;
+        }
+        else if (map->control[i] == CONTROL_DELETED)
+        {
+            deleted_count++;
+        }
+    }
+
+    for (i = 0; i < GROUP_WIDTH - 1; ++i)
+    {
+        if (map->control[map->table_capacity + i] != map->control[i])
+        {
+            return false;
+        }
+    }
+
+    return full_count == map->size
+        && deleted_count == map->deleted_count
+        && full_count + deleted_count < map->table_capacity;
+}
+
+void flat_unordered_map_free(flat_unordered_map* map)
+{
+    if (!map)
+    {
+        return;
+    }
+
+    free(map->control);
+    free(map->slots);
+    free(map);
+}
+
+flat_unordered_map_iterator*
+flat_unordered_map_iterator_alloc(flat_unordered_map* map)
+{
+    flat_unordered_map_iterator* iterator;
+
+    if (!map)
+    {
+        return NULL;
+    }
+
+    iterator = malloc(sizeof(*iterator));
+
+    if (!iterator)
+    {
+        return NULL;
+    }
+
+    iterator->map                = map;
+    iterator->next_index         = 0;
+    iterator->iterated_count     = 0;
+    iterator->expected_mod_count = map->mod_count;
+
+    return iterator;
+}
+
+size_t flat_unordered_map_iterator_has_next
+      (flat_unordered_map_iterator* iterator)
+{
+    if (!iterator)
+    {
+        return 0;
+    }
+
+    if (flat_unordered_map_iterator_is_disturbed(iterator))
+    {
+        return 0;
+    }
+
+    return iterator->map->size - iterator->iterated_count;
+}
+
+bool flat_unordered_map_iterator_next(flat_unordered_map_iterator* iterator,
+                                      void** key_pointer,
+                                      void** value_pointer)
+{
+    flat_unordered_map* map;
+
+    if (!flat_unordered_map_iterator_has_next(iterator))
+    {
+        return false;
+    }
+
+    map = iterator->map;
+
+    while (map->control[iterator->next_index] < 0)
+    {
+        iterator->next_index++;
+    }
+
+    *key_pointer   = map->slots[iterator->next_index].key;
+    *value_pointer = map->slots[iterator->next_index].value;
+    iterator->next_index++;
+    iterator->iterated_count++;
+
+    return true;
+}
+
+bool flat_unordered_map_iterator_is_disturbed
+    (flat_unordered_map_iterator* iterator)
+{
+    if (!iterator)
+    {
+        return false;
+    }
+
+    return iterator->expected_mod_count != iterator->map->mod_count;
+}
+
+void flat_unordered_map_iterator_free(flat_unordered_map_iterator* iterator)
+{
+    if (!iterator)
+    {
+        return;
+    }
+
+    iterator->map = NULL;
+    free(iterator);
+}
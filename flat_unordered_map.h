@@ -0,0 +1,115 @@
+#ifndef FLAT_UNORDERED_MAP_H
+#define	FLAT_UNORDERED_MAP_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef struct flat_unordered_map          flat_unordered_map;
+    typedef struct flat_unordered_map_iterator flat_unordered_map_iterator;
+
+    /***************************************************************************
+    * Allocates a new, empty map with given hash function and given equality   *
+    * testing function. Unlike 'unordered_map', this map keeps the key/value   *
+    * pointers inline in one open-addressed slot array and probes 16 slots at  *
+    * a time through a parallel array of one-byte control codes (with SSE2     *
+    * where available), so a lookup touches about two cache lines and the map  *
+    * makes no per-entry allocations. The load factor is capped at 0.875.      *
+    ***************************************************************************/
+    flat_unordered_map* flat_unordered_map_alloc
+           (size_t   initial_capacity,
+            float    load_factor,
+            size_t (*hash_function)(void*),
+            bool   (*equals_function)(void*, void*));
+
+    /***************************************************************************
+    * If the map does not contain the key, inserts it in the map, associates   *
+    * the value with it and returns NULL. Otherwise updates the value and      *
+    * returns the old value.                                                   *
+    ***************************************************************************/
+    void* flat_unordered_map_put(flat_unordered_map* map,
+                                 void* key,
+                                 void* value);
+
+    /***************************************************************************
+    * Returns true if the key is mapped to some value in this map.             *
+    ***************************************************************************/
+    bool flat_unordered_map_contains_key(flat_unordered_map* map, void* key);
+
+    /***************************************************************************
+    * Returns the value associated with the key, or NULL if the key is not     *
+    * mapped in the map.                                                       *
+    ***************************************************************************/
+    void* flat_unordered_map_get(flat_unordered_map* map, void* key);
+
+    /***************************************************************************
+    * If the key is mapped in the map, removes the mapping and returns the     *
+    * value of that mapping. If the map did not contain the mapping, returns   *
+    * NULL.                                                                    *
+    ***************************************************************************/
+    void* flat_unordered_map_remove(flat_unordered_map* map, void* key);
+
+    /***************************************************************************
+    * Removes all the contents of the map.                                     *
+    ***************************************************************************/
+    void flat_unordered_map_clear(flat_unordered_map* map);
+
+    /***************************************************************************
+    * Returns the size of the map, or namely, the amount of key/value mappings *
+    * in the map.                                                              *
+    ***************************************************************************/
+    size_t flat_unordered_map_size(flat_unordered_map* map);
+
+    /***************************************************************************
+    * Checks that the map is in valid state.                                   *
+    ***************************************************************************/
+    bool flat_unordered_map_is_healthy(flat_unordered_map* map);
+
+    /***************************************************************************
+    * Deallocates the entire map. Only the map and its slots are deallocated.  *
+    * The user is responsible for deallocating the actual data stored in the   *
+    * map.                                                                     *
+    ***************************************************************************/
+    void flat_unordered_map_free(flat_unordered_map* map);
+
+    /***************************************************************************
+    * Returns the iterator over the map. The entries are iterated in slot      *
+    * order, which is not the insertion order.                                 *
+    ***************************************************************************/
+    flat_unordered_map_iterator* flat_unordered_map_iterator_alloc
+                                (flat_unordered_map* map);
+
+    /***************************************************************************
+    * Returns the number of keys not yet iterated over.                        *
+    ***************************************************************************/
+    size_t flat_unordered_map_iterator_has_next
+          (flat_unordered_map_iterator* iterator);
+
+    /***************************************************************************
+    * Loads the next entry in the iteration order.                             *
+    ***************************************************************************/
+    bool flat_unordered_map_iterator_next
+        (flat_unordered_map_iterator* iterator,
+         void** key_pointer,
+         void** value_pointer);
+
+    /***************************************************************************
+    * Returns a true if the map was modified during the iteration.             *
+    ***************************************************************************/
+    bool flat_unordered_map_iterator_is_disturbed
+        (flat_unordered_map_iterator* iterator);
+
+    /***************************************************************************
+    * Deallocates the map iterator.                                            *
+    ***************************************************************************/
+    void flat_unordered_map_iterator_free
+        (flat_unordered_map_iterator* iterator);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FLAT_UNORDERED_MAP_H */
@@ -0,0 +1,144 @@
+#include "integer_sort.h"
+#include "sort_utils.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXIMUM_KEY_SIZE 8
+#define BUCKETS (UCHAR_MAX + 1)
+
+static void build_histograms(const char* base,
+                             const size_t num,
+                             const size_t size,
+                             const size_t key_offset,
+                             const size_t key_size,
+                             size_t histograms[][BUCKETS])
+{
+    const unsigned char* key = (const unsigned char*) base + key_offset;
+    const unsigned char* last = key + num * size;
+    
+    memset(histograms, 0, sizeof(size_t) * BUCKETS * key_size);
+    
+    for (; key != last; key += size)
+    {
+        for (size_t i = 0; i < key_size; ++i)
+        {
+            histograms[i][key[i]]++;
+        }
+    }
+}
+
+/*******************************************************************************
+* Turns the bucket counts into the starting indices of the buckets. When       *
+* 'flip_sign' is set, buckets with the most significant bit set (negative      *
+* numbers) are laid out first.                                                 *
+*******************************************************************************/
+static void compute_bucket_offsets(size_t histogram[BUCKETS],
+                                   const bool flip_sign)
+{
+    size_t sum = 0;
+    
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        const size_t bucket = flip_sign ? (i ^ (BUCKETS >> 1)) : i;
+        const size_t count = histogram[bucket];
+        histogram[bucket] = sum;
+        sum += count;
+    }
+}
+
+static void scatter(const char* source,
+                    char* target,
+                    const size_t num,
+                    const size_t size,
+                    const size_t digit_offset,
+                    size_t bucket_offsets[BUCKETS])
+{
+    const char* last = source + num * size;
+    
+    for (; source != last; source += size)
+    {
+        const unsigned char digit = (unsigned char) source[digit_offset];
+        memcpy(target + bucket_offsets[digit]++ * size, source, size);
+    }
+}
+
+void integer_sort(void* base,
+                  const size_t num,
+                  const size_t size,
+                  const size_t key_offset,
+                  const size_t key_size,
+                  const bool key_is_signed)
+{
+    if (!base || num < 2)
+    {
+        return;
+    }
+    
+    if (key_size == 0
+            || key_size > MAXIMUM_KEY_SIZE 
+            || key_offset + key_size > size)
+    {
+        return;
+    }
+    
+    const bool little_endian = is_little_endian();
+    size_t histograms[MAXIMUM_KEY_SIZE][BUCKETS];
+    
+    // Histograms are indexed by the byte position within the key, which is
+    // not necessarily the digit significance:
+    build_histograms(base, num, size, key_offset, key_size, histograms);
+    
+    char* buffer = NULL;
+    char* source = base;
+    char* target = NULL;
+    
+    for (size_t digit = 0; digit < key_size; ++digit)
+    {
+        const size_t digit_offset = get_digit_offset(key_offset,
+                                                     key_size,
+                                                     digit,
+                                                     little_endian);
+        size_t* histogram = histograms[digit_offset - key_offset];
+        const unsigned char first_digit = (unsigned char) source[digit_offset];
+        
+        if (histogram[first_digit] == num)
+        {
+            // All keys share this digit; the pass would not move anything:
+            continue;
+        }
+        
+        if (!buffer)
+        {
+            buffer = malloc(num * size);
+            
+            if (!buffer)
+            {
+                fputs("Could not allocate memory for the buffer array.\n", 
+                      stderr);
+                abort();
+            }
+            
+            target = buffer;
+        }
+        
+        compute_bucket_offsets(histogram,
+                               key_is_signed && digit == key_size - 1);
+        
+        scatter(source, target, num, size, digit_offset, histogram);
+        
+        // Swap the roles of the arrays:
+        char* tmp = source;
+        source = target;
+        target = tmp;
+    }
+    
+    if (source != base)
+    {
+        memcpy(base, source, num * size);
+    }
+    
+    free(buffer);
+}
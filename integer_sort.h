@@ -0,0 +1,29 @@
+#ifndef INTEGER_SORT_H
+#define INTEGER_SORT_H
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Sorts an array starting from 'base' of 'num' elements each 'size' bytes  *
+    * long by an integer key stored in native byte order at 'key_offset'       *
+    * bytes from the beginning of each element. The key is 'key_size' bytes    *
+    * long (1 to 8), and is treated as a two's complement number if            *
+    * 'key_is_signed' is true. This is a least significant digit radix sort;   *
+    * it is stable, i.e., does not rearrange elements with equal keys.         *
+    ***************************************************************************/
+    void integer_sort(void* base,
+                      const size_t num,
+                      const size_t size,
+                      const size_t key_offset,
+                      const size_t key_size,
+                      const bool key_is_signed);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* INTEGER_SORT_H */
@@ -1,15 +1,31 @@
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #include <time.h>
 #include "map.h"
 #include "set.h"
 #include "unordered_map.h"
+#include "flat_unordered_map.h"
+#include "concurrent_unordered_map.h"
 #include "unordered_set.h"
 #include "heap.h"
 #include "list.h"
 #include "fibonacci_heap.h"
 #include "stable_sort.h"
+#include "external_sort.h"
+#include "partial_sort.h"
+#include "string_sort.h"
+#include "segmented_sort.h"
+#include "parallel_stable_sort.h"
+#include "typed_stable_sort.h"
+#include "primitive_sort.h"
+#include "integer_sort.h"
+#include "parallel_integer_sort.h"
 
 #define ASSERT(CONDITION) assert(CONDITION, #CONDITION, __FILE__, __LINE__)
 
@@ -288,6 +304,171 @@ static void test_unordered_map_performance()
     printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);    
 }
 
+/*******************************************************************************
+* Times 'ROUNDS' passes of lookups of shuffled keys against both hash maps.    *
+*******************************************************************************/
+static void test_flat_unordered_map_performance()
+{
+    const int sz = 1000000;
+    const int ROUNDS = 5;
+    
+    unordered_map* p_map = unordered_map_alloc(7, 
+                                               0.75f, 
+                                               hash_function, 
+                                               equals_function);
+    flat_unordered_map* p_flat_map = flat_unordered_map_alloc(7, 
+                                                              0.75f, 
+                                                              hash_function, 
+                                                              equals_function);
+    clock_t t;
+    double duration;
+    int i;
+    int j;
+    int a;
+    int b;
+    int tmp;
+    bool ok = true;
+    int* array = malloc(sizeof(int) * sz);
+    
+    puts("--- PERFORMANCE OF flat_unordered_map VS. unordered_map ---");
+    
+    for (i = 0; i < sz; ++i) 
+        array[i] = i;
+    
+    for (i = 0; i < sz; ++i)
+    {
+        a = rand() % sz;
+        b = rand() % sz;
+        
+        tmp = array[a];
+        array[a] = array[b];
+        array[b] = tmp;
+    }
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i)
+    {
+        unordered_map_put(p_map, (void*) array[i], (void*)(3 * array[i]));
+    }
+    
+    duration = (double) clock() - t;
+    printf("unordered_map put:           %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i)
+    {
+        flat_unordered_map_put(p_flat_map, 
+                               (void*) array[i], 
+                               (void*)(3 * array[i]));
+    }
+    
+    duration = (double) clock() - t;
+    printf("flat_unordered_map put:      %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    ASSERT(flat_unordered_map_is_healthy(p_flat_map));
+    
+    /* Look the keys up in another order than they were inserted in, or the 
+       nodes of unordered_map would be visited in their allocation order. */
+    for (i = 0; i < sz; ++i)
+    {
+        a = rand() % sz;
+        b = rand() % sz;
+        
+        tmp = array[a];
+        array[a] = array[b];
+        array[b] = tmp;
+    }
+    
+    t = clock();
+    
+    for (i = 0; i < ROUNDS; ++i) 
+    {
+        for (j = 0; j < sz; ++j) 
+        {
+            ok &= unordered_map_get(p_map, (void*) array[j]) 
+                    == (void*)(3 * array[j]);
+        }
+    }
+    
+    duration = (double) clock() - t;
+    printf("unordered_map get:           %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    
+    for (i = 0; i < ROUNDS; ++i) 
+    {
+        for (j = 0; j < sz; ++j) 
+        {
+            ok &= flat_unordered_map_get(p_flat_map, (void*) array[j]) 
+                    == (void*)(3 * array[j]);
+        }
+    }
+    
+    duration = (double) clock() - t;
+    printf("flat_unordered_map get:      %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    /* Misses probe until an empty slot, so time them separately. */
+    t = clock();
+    
+    for (j = 0; j < sz; ++j) 
+    {
+        ok &= unordered_map_get(p_map, (void*)(sz + array[j])) == NULL;
+    }
+    
+    duration = (double) clock() - t;
+    printf("unordered_map get miss:      %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    
+    for (j = 0; j < sz; ++j) 
+    {
+        ok &= flat_unordered_map_get(p_flat_map, (void*)(sz + array[j])) 
+                == NULL;
+    }
+    
+    duration = (double) clock() - t;
+    printf("flat_unordered_map get miss: %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i) 
+    {
+        ok &= unordered_map_remove(p_map, (void*) array[i]) 
+                == (void*)(3 * array[i]);
+    }
+    
+    duration = (double) clock() - t;
+    printf("unordered_map remove:        %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i) 
+    {
+        ok &= flat_unordered_map_remove(p_flat_map, (void*) array[i]) 
+                == (void*)(3 * array[i]);
+    }
+    
+    duration = (double) clock() - t;
+    printf("flat_unordered_map remove:   %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    ASSERT(ok);
+    ASSERT(flat_unordered_map_size(p_flat_map) == 0);
+    ASSERT(flat_unordered_map_is_healthy(p_flat_map));
+    
+    unordered_map_free(p_map);
+    flat_unordered_map_free(p_flat_map);
+    free(array);
+}
+
 static void test_set_performance()
 {
     set* p_set = set_alloc(int_comparator);
@@ -514,412 +695,1305 @@ void test_unordered_map_correctness()
     unordered_map_free(p_map);
 }
 
-void test_set_correctness() 
+/*******************************************************************************
+* Returns the longest single 'unordered_map_put' while inserting 'sz' keys.    *
+*******************************************************************************/
+static double get_maximum_put_duration(unordered_map* p_map, int sz)
 {
     int i;
-    void* p_key;
-    int expected_size;
-    set* p_set = set_alloc(int_comparator);
-    set_iterator* p_iterator;
+    clock_t t;
+    double duration;
+    double maximum_duration = 0.0;
     
-    for (i = -10; i < 10; ++i) 
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT(set_contains(p_set, (void*) i) == false);
-        ASSERT(set_size(p_set) == (i + 10));
-        
-        ASSERT(set_add(p_set, (void*) i) == true);
+        t = clock();
+        unordered_map_put(p_map, (void*) i, (void*)(3 * i));
+        duration = (double) clock() - t;
         
-        ASSERT(set_contains(p_set, (void*) i) == true);
-        ASSERT(set_size(p_set) == (i + 10) + 1);
+        if (maximum_duration < duration)
+        {
+            maximum_duration = duration;
+        }
     }
     
-    expected_size = set_size(p_set);
-    p_iterator = set_iterator_alloc(p_set);
-    ASSERT(expected_size == 20);
+    return maximum_duration / CLOCKS_PER_SEC;
+}
+
+/*******************************************************************************
+* Checks the lookups, the health and the iteration order of a map into which   *
+* keys were put in increasing order, 'present[k]' telling whether key 'k' is   *
+* still mapped to '3 * k'.                                                     *
+*******************************************************************************/
+static bool check_increasing_map(unordered_map* p_map, bool* present, int sz)
+{
+    unordered_map_iterator* p_iterator;
+    void* p_key;
+    void* p_value;
+    size_t count = 0;
+    int previous_key = -1;
+    int i;
+    bool ok = unordered_map_is_healthy(p_map);
     
-    for (i = -10; i < 10; ++i) 
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT(set_iterator_has_next(p_iterator) == 10 - i);
-        ASSERT(set_iterator_next(p_iterator, &p_key) == true);
-        ASSERT((int) p_key == i);
+        ok &= unordered_map_get(p_map, (void*) i) 
+                == (present[i] ? (void*)(3 * i) : NULL);
     }
     
-    ASSERT(set_iterator_has_next(p_iterator) == 0);
-    ASSERT(set_size(p_set) == expected_size);
-    
-    set_clear(p_set);
-    
-    ASSERT(set_size(p_set) == 0);
-    
-    ASSERT(set_add      (p_set, (void*) 1));
-    ASSERT(set_size     (p_set) == 1);
-    ASSERT(set_add      (p_set, (void*) 1) == false);
-    ASSERT(set_size     (p_set) == 1);
-    ASSERT(set_contains (p_set, (void*) 1));
-    ASSERT(set_contains (p_set, (void*) 2) == false);
-  
-    ASSERT(set_contains (p_set, (void*) 10) == false);
-    ASSERT(set_add      (p_set, (void*) 10));
-    ASSERT(set_contains (p_set, (void*) 10));
-    ASSERT(set_remove   (p_set, (void*) 11) == false);
-    ASSERT(set_remove   (p_set, (void*) 10));
-    ASSERT(set_contains (p_set, (void*) 10) == false);
+    p_iterator = unordered_map_iterator_alloc(p_map);
     
-    set_clear(p_set);
+    while (unordered_map_iterator_has_next(p_iterator))
+    {
+        unordered_map_iterator_next(p_iterator, &p_key, &p_value);
+        ok &= (int) p_key > previous_key && present[(int) p_key];
+        ok &= p_value == (void*)(3 * (int) p_key);
+        previous_key = (int) p_key;
+        count++;
+    }
     
-    set_free(p_set);
+    unordered_map_iterator_free(p_iterator);
+    return ok && count == unordered_map_size(p_map);
 }
 
-void test_unordered_set_correctness() 
+static void test_unordered_map_incremental_rehash()
 {
+    const int sz = 4000000;
+    const size_t BUCKETS_PER_OPERATION = 4;
+    const int SMALL_SIZE = 200000;
+    
+    unordered_map* p_map1 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_map* p_map2 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    bool* present;
+    size_t capacity = 16;
+    int growth_index = -1;
     int i;
-    void* p_key;
-    int expected_size;
-    unordered_set* p_set = unordered_set_t_alloc(7, 0.8f, hash_function, equals_function);
-    unordered_set_iterator* p_iterator;
+    bool ok = true;
     
-    for (i = -10; i < 10; ++i) 
-    {
-        ASSERT(unordered_set_t_contains(p_set, (void*) i) == false);
-        ASSERT(unordered_set_t_size(p_set) == (i + 10));
-        
-        ASSERT(unordered_set_t_add(p_set, (void*) i) == true);
-        
-        ASSERT(unordered_set_t_contains(p_set, (void*) i) == true);
-        ASSERT(unordered_set_t_size(p_set) == (i + 10) + 1);
-    }
+    unordered_map_set_incremental_rehash(p_map2, BUCKETS_PER_OPERATION);
     
-    expected_size = unordered_set_t_size(p_set);
-    p_iterator = unordered_set_iterator_t_alloc(p_set);
-    ASSERT(expected_size == 20);
+    puts("--- unordered_map incremental rehash ---");
+    printf("Longest put, rehashing at once:      %f seconds.\n", 
+           get_maximum_put_duration(p_map1, sz));
+    printf("Longest put, rehashing incrementally: %f seconds.\n", 
+           get_maximum_put_duration(p_map2, sz));
     
-    for (i = -10; i < 10; ++i) 
+    /* Removals and lookups must find the keys in either table while the 
+       last growth is still being migrated. */
+    for (i = 0; i < sz; i += 2)
     {
-        ASSERT(unordered_set_iterator_t_has_next(p_iterator) == 10 - i);
-        ASSERT(unordered_set_iterator_t_next(p_iterator, &p_key) == true);
-        ASSERT((int) p_key == i);
+        ok &= unordered_map_remove(p_map2, (void*) i) == (void*)(3 * i);
     }
     
-    ASSERT(unordered_set_iterator_t_has_next(p_iterator) == 0);
-    ASSERT(unordered_set_t_size(p_set) == expected_size);
+    ASSERT(unordered_map_is_healthy(p_map2));
     
-    unordered_set_t_clear(p_set);
+    for (i = 0; i < sz; ++i)
+    {
+        ok &= unordered_map_get(p_map2, (void*) i) 
+                == (i % 2 ? (void*)(3 * i) : NULL);
+    }
     
-    ASSERT(unordered_set_t_size(p_set) == 0);
+    ASSERT(ok);
+    ASSERT(unordered_map_size(p_map2) == sz / 2);
+    
+    unordered_map_free(p_map1);
+    unordered_map_free(p_map2);
+    
+    /* Even one bucket per operation must not leave a long migration to the 
+       next growth. */
+    p_map1 = unordered_map_alloc(7, 0.75f, hash_function, equals_function);
+    unordered_map_set_incremental_rehash(p_map1, 1);
+    printf("Longest put, migrating one bucket per operation: %f seconds.\n",
+           get_maximum_put_duration(p_map1, sz));
+    unordered_map_free(p_map1);
+    
+    /* Check the map right after each growth and a few operations later, 
+       while the old table is still being migrated. The capacity is tracked 
+       the way the map grows it: from 16 buckets, doubling whenever an 
+       insertion finds the map at its load factor. */
+    p_map1 = unordered_map_alloc(7, 0.75f, hash_function, equals_function);
+    unordered_map_set_incremental_rehash(p_map1, 1);
+    present = calloc(SMALL_SIZE, sizeof(bool));
+    
+    for (i = 0; i < SMALL_SIZE; ++i)
+    {
+        if (unordered_map_size(p_map1) >= (size_t)(capacity * 0.75f))
+        {
+            capacity *= 2;
+            growth_index = i;
+        }
+        
+        unordered_map_put(p_map1, (void*) i, (void*)(3 * i));
+        present[i] = true;
+        
+        if (i % 5 == 4 && present[i / 2])
+        {
+            unordered_map_remove(p_map1, (void*)(i / 2));
+            present[i / 2] = false;
+        }
+        
+        if (i == growth_index || i == growth_index + 3)
+        {
+            ok &= check_increasing_map(p_map1, present, SMALL_SIZE);
+        }
+    }
     
-    ASSERT(unordered_set_t_add      (p_set, (void*) 1));
-    ASSERT(unordered_set_t_size     (p_set) == 1);
-    ASSERT(unordered_set_t_add      (p_set, (void*) 1) == false);
-    ASSERT(unordered_set_t_size     (p_set) == 1);
-    ASSERT(unordered_set_t_contains (p_set, (void*) 1));
-    ASSERT(unordered_set_t_contains (p_set, (void*) 2) == false);
+    ASSERT(ok);
+    ASSERT(check_increasing_map(p_map1, present, SMALL_SIZE));
     
-    ASSERT(unordered_set_t_contains (p_set, (void*) 10) == false);
-    ASSERT(unordered_set_t_add      (p_set, (void*) 10));
-    ASSERT(unordered_set_t_contains (p_set, (void*) 10));
-    ASSERT(unordered_set_t_remove   (p_set, (void*) 11) == false);
-    ASSERT(unordered_set_t_remove   (p_set, (void*) 10));
-    ASSERT(unordered_set_t_contains (p_set, (void*) 10) == false);
+    unordered_map_free(p_map1);
+    free(present);
 }
 
-static void test_unordered_set_performance()
+static void test_unordered_map_put_all()
 {
-    unordered_set* p_set = unordered_set_t_alloc(7, 0.8f, hash_function, equals_function);
-    unordered_set_iterator* p_iterator;
-    
     const int sz = 1000000;
     
+    unordered_map* p_map1 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_map* p_map2 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_set* p_set = unordered_set_t_alloc(7, 
+                                                 0.75f, 
+                                                 hash_function, 
+                                                 equals_function);
+    void** keys = malloc(sizeof(void*) * sz);
+    void** values = malloc(sizeof(void*) * sz);
     clock_t t;
-    double duration = 0.0;
+    double duration;
     int i;
-    int j;
-    int a;
-    int b;
-    int tmp;
-    void* p_element;
-    bool* p_check_list;
-    int seed;
-    int* array = malloc(sizeof(int) * sz);
-    p_check_list = calloc(sz, sizeof(bool));
-    
-    puts("--- PERFORMANCE OF unordered_set ---");
-    
-    for (i = 0; i < sz; ++i) 
-        array[i] = i;
-    
-    seed = time(NULL);
-    printf("Seed: %d.\n", seed);
-    srand(seed);
+    bool ok = true;
     
+    /* The keys repeat about twice on average, and the later value wins. */
     for (i = 0; i < sz; ++i)
     {
-        a = rand() % sz;
-        b = rand() % sz;
-        
-        tmp = array[a];
-        array[a] = array[b];
-        array[b] = tmp;
+        keys[i] = (void*)(rand() % (sz / 2));
+        values[i] = (void*) i;
     }
     
+    puts("--- unordered_map_put_all ---");
+    
     t = clock();
     
     for (i = 0; i < sz; ++i)
     {
-        unordered_set_t_add(p_set, (void*) array[i]);
+        unordered_map_put(p_map1, keys[i], values[i]);
     }
     
-    duration += ((double) clock() - t);
+    duration = (double) clock() - t;
+    printf("unordered_map_put:     %f seconds.\n", duration / CLOCKS_PER_SEC);
     
-    printf("Healthy: %d\n", unordered_set_t_is_healthy(p_set));
-    p_iterator = unordered_set_iterator_t_alloc(p_set);
     t = clock();
+    ASSERT(unordered_map_put_all(p_map2, keys, values, sz));
+    duration = (double) clock() - t;
+    printf("unordered_map_put_all: %f seconds.\n", duration / CLOCKS_PER_SEC);
     
-    while (unordered_set_iterator_t_has_next(p_iterator)) 
+    ASSERT(unordered_map_is_healthy(p_map2));
+    ASSERT(unordered_map_size(p_map1) == unordered_map_size(p_map2));
+    
+    for (i = 0; i < sz; ++i)
     {
-        unordered_set_iterator_t_next(p_iterator, &p_element);
-        
-        p_check_list[(int) p_element] = true;
+        ok &= unordered_map_get(p_map1, keys[i]) 
+                == unordered_map_get(p_map2, keys[i]);
     }
     
+    ASSERT(ok);
+    
+    ASSERT(unordered_set_t_reserve(p_set, sz));
+    ASSERT(unordered_set_t_add_all(p_set, keys, sz));
+    ASSERT(unordered_set_t_is_healthy(p_set));
+    ASSERT(unordered_set_t_size(p_set) == unordered_map_size(p_map1));
+    
+    /* No table can hold this many, and the size must not wrap around. */
+    ASSERT(!unordered_map_reserve(p_map1, SIZE_MAX));
+    ASSERT(!unordered_set_t_reserve(p_set, SIZE_MAX));
+    ASSERT(!unordered_map_put_all(p_map1, keys, values, SIZE_MAX));
+    ASSERT(!unordered_set_t_add_all(p_set, keys, SIZE_MAX));
+    ASSERT(unordered_map_is_healthy(p_map1));
+    ASSERT(unordered_set_t_size(p_set) == unordered_map_size(p_map1));
+    
+    unordered_map_free(p_map1);
+    unordered_map_free(p_map2);
+    unordered_set_t_free(p_set);
+    free(keys);
+    free(values);
+}
+
+static void test_unordered_map_get_batch()
+{
+    const int sz = 4000000;
+    const size_t BATCH_SIZE = 256;
     
-    duration += ((double) clock() - t);
+    unordered_map* p_map = unordered_map_alloc(7, 
+                                               0.75f, 
+                                               hash_function, 
+                                               equals_function);
+    void** keys = malloc(sizeof(void*) * sz);
+    void** values1 = malloc(sizeof(void*) * sz);
+    void** values2 = malloc(sizeof(void*) * sz);
+    clock_t t;
+    double duration;
+    size_t i;
     
-    for (i = 0; i < sz; ++i) 
+    for (i = 0; i < sz; ++i)
     {
-        if (!p_check_list[i])
-        {
-            puts("Not all elements set.");
-            exit(1);
-        }
+        keys[i] = (void*) i;
     }
     
-    t = clock();
+    ASSERT(unordered_map_put_all(p_map, keys, keys, sz));
     
-    for (i = 0; i < 5; ++i) 
-        for (j = 0; j < sz; ++j) 
-            if (!unordered_set_t_contains(p_set, (void*) array[i])) 
-                exit(2);
-        
-    duration += ((double) clock() - t);
+    /* Query the keys in random order, one in four of them missing. */
+    for (i = 0; i < sz; ++i)
+    {
+        keys[i] = (void*)(rand() % (sz + sz / 3));
+    }
+    
+    puts("--- unordered_map_get_batch ---");
     
     t = clock();
     
-    for (i = 0; i < sz; ++i) 
+    for (i = 0; i < sz; ++i)
     {
-        if(!ASSERT(unordered_set_t_remove(p_set, (void*) array[i])))
-        {
-            printf("Fails at index %d\n", i);
-            exit(3);
-        }
+        values1[i] = unordered_map_get(p_map, keys[i]);
     }
     
-    duration += ((double) clock() - t);
-    printf("Healthy: %d\n", unordered_set_t_is_healthy(p_set));
+    duration = (double) clock() - t;
+    printf("unordered_map_get:       %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
     
-    p_iterator = unordered_set_iterator_t_alloc(p_set);
+    t = clock();
     
-    /* Empty iterator. */
-    while (unordered_set_iterator_t_has_next(p_iterator)) 
+    for (i = 0; i < sz; i += BATCH_SIZE)
     {
-        unordered_set_iterator_t_next(p_iterator, &p_element);
+        unordered_map_get_batch(p_map, 
+                                keys + i, 
+                                sz - i < BATCH_SIZE ? sz - i : BATCH_SIZE, 
+                                values2 + i);
     }
     
-    printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);    
+    duration = (double) clock() - t;
+    printf("unordered_map_get_batch: %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    ASSERT(memcmp(values1, values2, sizeof(void*) * sz) == 0);
+    
+    unordered_map_free(p_map);
+    free(keys);
+    free(values1);
+    free(values2);
 }
 
-static int priority_cmp(void* a, void* b) 
+static void* increment_count(void* key, void* value, void* context)
 {
-    return ((int) a) - ((int) b);
+    (void) key;
+    (void) context;
+    return (void*)((size_t) value + 1);
 }
 
-static void test_heap_correctness() 
+static void test_unordered_map_get_or_insert()
 {
-    heap* p_heap;
-    size_t i;
-    
-    p_heap = heap_alloc(2, 
-                        10, 
-                        1.0f, 
-                        hash_function, 
-                        equals_function, priority_cmp);
-    
-    ASSERT(heap_is_healthy(p_heap));
+    const int sz = 4000000;
+    const int DISTINCT_KEYS = 500000;
+    
+    unordered_map* p_map1 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_map* p_map2 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_map* p_map3 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    int* keys = malloc(sizeof(int) * sz);
+    void** slot;
+    bool inserted;
+    size_t inserted_count = 0;
+    clock_t t;
+    double duration;
+    int i;
+    bool ok = true;
     
-    for (i = 0; i < 30; ++i) 
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT(heap_add(p_heap, i, 30 - i));
+        keys[i] = rand() % DISTINCT_KEYS;
     }
     
-    for (i = 0; i < 30; ++i)
-    {
-        ASSERT(!heap_add(p_heap, i, i));
-    }
+    puts("--- unordered_map_get_or_insert ---");
     
-    ASSERT(heap_size(p_heap) == 30);
+    /* Count the occurrences of each key in three ways. */
+    t = clock();
     
-    for (i = 0; i < 30; ++i) 
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT(heap_contains(p_heap, i));
+        size_t count = (size_t) unordered_map_get(p_map1, (void*) keys[i]);
+        unordered_map_put(p_map1, (void*) keys[i], (void*)(count + 1));
     }
     
-    for (i = 30; i < 40; ++i) 
-    {
-        ASSERT(heap_contains(p_heap, i) == false);
-    }
+    duration = (double) clock() - t;
+    printf("get + put:     %f seconds.\n", duration / CLOCKS_PER_SEC);
     
-    ASSERT(heap_is_healthy(p_heap));
+    t = clock();
     
-    for (i = 29; i != (size_t) -1; --i) 
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT((int) heap_extract_min(p_heap) == i);
+        slot = unordered_map_get_or_insert(p_map2, 
+                                           (void*) keys[i], 
+                                           (void*) 0, 
+                                           &inserted);
+        *slot = (void*)((size_t) *slot + 1);
+        inserted_count += inserted;
     }
     
-    ASSERT(heap_size(p_heap) == 0);
-    ASSERT(heap_is_healthy(p_heap));
+    duration = (double) clock() - t;
+    printf("get_or_insert: %f seconds.\n", duration / CLOCKS_PER_SEC);
     
-    for (i = 10; i < 100; ++i) 
+    t = clock();
+    
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT(heap_add(p_heap, i, i));
+        ok &= unordered_map_compute(p_map3, 
+                                    (void*) keys[i], 
+                                    increment_count, 
+                                    NULL);
     }
     
-    ASSERT(heap_decrease_key(p_heap, 50, 0));
-    
-    ASSERT((size_t) heap_min(p_heap) == 50);
-    ASSERT((size_t) heap_extract_min(p_heap) == 50);
+    duration = (double) clock() - t;
+    printf("compute:       %f seconds.\n", duration / CLOCKS_PER_SEC);
     
-    for (i = 10; i < 50; ++i) 
-    {
-        ASSERT((size_t) heap_min(p_heap) == i);
-        ASSERT((size_t) heap_extract_min(p_heap) == i);
-    }
+    ASSERT(inserted_count == unordered_map_size(p_map1));
+    ASSERT(unordered_map_size(p_map2) == unordered_map_size(p_map1));
+    ASSERT(unordered_map_size(p_map3) == unordered_map_size(p_map1));
     
-    for (i = 51; i < 100; ++i) 
+    for (i = 0; i < DISTINCT_KEYS; ++i)
     {
-        ASSERT((size_t) heap_min(p_heap) == i);
-        ASSERT((size_t) heap_extract_min(p_heap) == i);
+        void* count = unordered_map_get(p_map1, (void*) i);
+        ok &= unordered_map_get(p_map2, (void*) i) == count;
+        ok &= unordered_map_get(p_map3, (void*) i) == count;
     }
     
-    ASSERT(heap_min(p_heap) == NULL);
-    ASSERT(heap_extract_min(p_heap) == NULL);
-    
-    ASSERT(heap_add(p_heap, 30, 30));
-    ASSERT(heap_add(p_heap, 40, 40));
-    ASSERT(heap_contains(p_heap, 30));
-    ASSERT(heap_contains(p_heap, 40));
-    ASSERT(heap_size(p_heap) == 2);
-    
-    heap_clear(p_heap);
+    ASSERT(ok);
     
-    ASSERT(heap_size(p_heap) == 0);
-    ASSERT(heap_extract_min(p_heap) == NULL);
+    unordered_map_free(p_map1);
+    unordered_map_free(p_map2);
+    unordered_map_free(p_map3);
+    free(keys);
 }
 
-static void test_heap_performance()
+static void test_unordered_map_shrink()
 {
-    heap* p_heap;
-    size_t degree;
-    size_t i;
+    const int sz = 1000000;
+    const int KEPT = 1000;
+    const int ROUNDS = 2000;
+    const int ROUND_SIZE = 100;
+    
+    unordered_map* p_map1 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_map* p_map2 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_map* p_map3 = unordered_map_alloc(7, 
+                                                0.75f, 
+                                                hash_function, 
+                                                equals_function);
+    unordered_set* p_set = unordered_set_t_alloc(7, 
+                                                 0.75f, 
+                                                 hash_function, 
+                                                 equals_function);
     clock_t t;
-    const size_t sz = 1000000;
     double duration;
+    int i;
+    int round;
+    bool ok = true;
     
-    puts("--- PERFORMANCE OF heap_t ---");
+    puts("--- unordered_map shrinking ---");
     
-    for (degree = 2; degree <= 10; ++degree)
+    unordered_map_set_low_water_mark(p_map2, 0.1f);
+    unordered_map_set_low_water_mark(p_map3, 0.1f);
+    unordered_map_set_incremental_rehash(p_map3, 4);
+    unordered_set_t_set_low_water_mark(p_set, 0.1f);
+    
+    /* A burst of insertions followed by removing nearly all of them. */
+    for (i = 0; i < sz; ++i)
     {
-        duration = 0.0;
-        printf("Degree %zu:\n", degree);
-        p_heap = heap_alloc(degree,
-                              10,
-                              1.0f,
-                              hash_function,
-                              equals_function,
-                              priority_cmp);
-        t = clock();
+        unordered_map_put(p_map1, (void*) i, (void*)(i + 1));
+        unordered_map_put(p_map2, (void*) i, (void*)(i + 1));
+        unordered_map_put(p_map3, (void*) i, (void*)(i + 1));
+        unordered_set_t_add(p_set, (void*) i);
+    }
+    
+    /* 1M mappings need 2M buckets under the load factor of 0.75. */
+    ASSERT(unordered_map_bucket_count(p_map1) == 2097152);
+    ASSERT(unordered_map_bucket_count(p_map3) == 2097152);
+    ASSERT(unordered_set_t_bucket_count(p_set) == 2097152);
+    
+    for (i = KEPT; i < sz; ++i)
+    {
+        ok &= unordered_map_remove(p_map1, (void*) i) == (void*)(i + 1);
+        ok &= unordered_map_remove(p_map2, (void*) i) == (void*)(i + 1);
+        ok &= unordered_map_remove(p_map3, (void*) i) == (void*)(i + 1);
+        ok &= unordered_set_t_remove(p_set, (void*) i);
         
-        for (i = 0; i < sz; ++i) 
+        /* Check the incremental map while its shrinks are migrated. */
+        if (i % 100000 == 0 || (sz - i < 20000 && i % 1000 == 0))
         {
-            heap_add(p_heap, i, 500000 + sz - i);
+            ok &= unordered_map_is_healthy(p_map3);
         }
+    }
+    
+    ASSERT(ok);
+    
+    /* Without a low-water mark nothing shrinks by itself. With a mark of 0.1,
+       the table is halved until 1000 mappings are at least a tenth of it. */
+    ASSERT(unordered_map_bucket_count(p_map1) == 2097152);
+    ASSERT(unordered_map_bucket_count(p_map2) == 8192);
+    ASSERT(unordered_map_bucket_count(p_map3) == 8192);
+    ASSERT(unordered_set_t_bucket_count(p_set) == 8192);
+    
+    /* The smallest table for 1000 mappings has 2048 buckets. */
+    ASSERT(unordered_map_shrink_to_fit(p_map1));
+    ASSERT(unordered_set_t_shrink_to_fit(p_set));
+    ASSERT(unordered_map_bucket_count(p_map1) == 2048);
+    ASSERT(unordered_set_t_bucket_count(p_set) == 2048);
+    ASSERT(unordered_map_size(p_map1) == KEPT);
+    ASSERT(unordered_map_size(p_map2) == KEPT);
+    ASSERT(unordered_map_size(p_map3) == KEPT);
+    ASSERT(unordered_set_t_size(p_set) == KEPT);
+    ASSERT(unordered_map_is_healthy(p_map1));
+    ASSERT(unordered_map_is_healthy(p_map2));
+    ASSERT(unordered_map_is_healthy(p_map3));
+    ASSERT(unordered_set_t_is_healthy(p_set));
+    
+    for (i = 0; i < KEPT; ++i)
+    {
+        ok &= unordered_map_get(p_map1, (void*) i) == (void*)(i + 1);
+        ok &= unordered_map_get(p_map2, (void*) i) == (void*)(i + 1);
+        ok &= unordered_map_get(p_map3, (void*) i) == (void*)(i + 1);
+        ok &= unordered_set_t_contains(p_set, (void*) i);
+    }
+    
+    ASSERT(ok);
+    
+    /* An emptied set shrinks to the smallest table. */
+    for (i = 0; i < KEPT; ++i)
+    {
+        unordered_set_t_remove(p_set, (void*) i);
+    }
+    
+    ASSERT(unordered_set_t_shrink_to_fit(p_set));
+    ASSERT(unordered_set_t_bucket_count(p_set) == 16);
+    ASSERT(unordered_set_t_is_healthy(p_set));
+    unordered_map_free(p_map3);
+    
+    /* Fill the map back up, then repeatedly clear and refill it a little. */
+    unordered_map_free(p_map1);
+    p_map1 = unordered_map_alloc(7, 0.75f, hash_function, equals_function);
+    
+    for (i = 0; i < sz; ++i)
+    {
+        unordered_map_put(p_map1, (void*) i, (void*)(i + 1));
+        unordered_map_put(p_map2, (void*) i, (void*)(i + 1));
+    }
+    
+    t = clock();
+    
+    for (round = 0; round < ROUNDS; ++round)
+    {
+        unordered_map_clear(p_map1);
         
-        /* State: 999999, 999998, 999997, ... */
-        ASSERT(heap_is_healthy(p_heap));
-        
-        for (i = sz / 2; i < sz; ++i)
+        for (i = 0; i < ROUND_SIZE; ++i)
         {
-            heap_decrease_key(p_heap, i, i);
+            unordered_map_put(p_map1, (void*) i, (void*)(i + 1));
         }
+    }
+    
+    duration = (double) clock() - t;
+    printf("clear + refill without low-water mark: %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    
+    for (round = 0; round < ROUNDS; ++round)
+    {
+        unordered_map_clear(p_map2);
         
-        ASSERT(heap_is_healthy(p_heap));
-        
-        for (i = 0; i < sz; ++i)
+        for (i = 0; i < ROUND_SIZE; ++i)
         {
-            heap_extract_min(p_heap);
+            unordered_map_put(p_map2, (void*) i, (void*)(i + 1));
         }
-        
-        duration += ((double) clock() - t);
-        
-        heap_free(p_heap);
-        
-        printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);
     }
+    
+    duration = (double) clock() - t;
+    printf("clear + refill with low-water mark:    %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    ASSERT(unordered_map_size(p_map1) == ROUND_SIZE);
+    ASSERT(unordered_map_size(p_map2) == ROUND_SIZE);
+    ASSERT(unordered_map_is_healthy(p_map1));
+    ASSERT(unordered_map_is_healthy(p_map2));
+    
+    /* Only the map with the mark restarted from 16 buckets at each clear. */
+    ASSERT(unordered_map_bucket_count(p_map1) == 2097152);
+    ASSERT(unordered_map_bucket_count(p_map2) == 256);
+    
+    unordered_map_free(p_map1);
+    unordered_map_free(p_map2);
+    unordered_set_t_free(p_set);
 }
 
-static bool int_eq(void* a, void* b)
+static size_t hash_calls = 0;
+static size_t equals_calls = 0;
+
+/* Distinct keys get distinct hashes, but all of them land in bucket 0 of any 
+   table smaller than 2^20 buckets. */
+static size_t counting_hash_function(void* v)
+{
+    ++hash_calls;
+    return (size_t) v << 20;
+}
+
+static bool counting_equals_function(void* a, void* b)
 {
+    ++equals_calls;
     return a == b;
 }
 
-static void test_list_correctness()
+static void test_unordered_map_cached_hashes()
 {
-    size_t i;
-    list* p_list = list_alloc(10);
+    const int sz = 2000;
     
-    for (i = 0; i < 40; i++) 
-    {
-        ASSERT(list_push_back(p_list, 2 * i));
-    }
+    unordered_map* p_map = unordered_map_alloc(7, 
+                                               0.75f, 
+                                               counting_hash_function, 
+                                               counting_equals_function);
+    unordered_set* p_set = unordered_set_t_alloc(7, 
+                                                 0.75f, 
+                                                 counting_hash_function, 
+                                                 counting_equals_function);
+    int i;
+    bool ok = true;
     
-    ASSERT(list_size(p_list) == 40);
+    puts("--- unordered_map cached hashes ---");
     
-    for (i = 0; i < 40; ++i) 
+    hash_calls = 0;
+    equals_calls = 0;
+    
+    /* Growing from 16 to 4096 buckets rehashes nothing, and the single long 
+       chain is walked without comparing any keys. */
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT((size_t) list_get(p_list, i) == 2 * i);
+        unordered_map_put(p_map, (void*) i, (void*)(i + 1));
+        unordered_set_t_add(p_set, (void*) i);
     }
     
-    for (i = 0; i < 40; ++i) 
+    ASSERT(unordered_map_reserve(p_map, 4 * sz));
+    ASSERT(unordered_set_t_reserve(p_set, 4 * sz));
+    ASSERT(hash_calls == 2 * sz);
+    ASSERT(equals_calls == 0);
+    
+    /* Keys missing from the map are never compared either. */
+    for (i = sz; i < 2 * sz; ++i)
     {
-        ASSERT(list_size(p_list) > 0);
-        ASSERT((size_t) list_pop_front(p_list) == 2 * i);
+        ok &= unordered_map_get(p_map, (void*) i) == NULL;
+        ok &= !unordered_set_t_contains(p_set, (void*) i);
     }
     
-    ASSERT(list_size(p_list) == 0);
+    ASSERT(ok);
+    ASSERT(equals_calls == 0);
     
-    for (i = 200; i > 0; --i) 
+    /* A present key is compared only with itself. */
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT(list_push_front(p_list, i));
+        ok &= unordered_map_get(p_map, (void*) i) == (void*)(i + 1);
+        ok &= unordered_set_t_contains(p_set, (void*) i);
     }
     
-    ASSERT(list_size(p_list) == 200);
+    ASSERT(ok);
+    ASSERT(equals_calls == 2 * sz);
     
-    for (i = 200; i > 0; --i) 
+    for (i = 0; i < sz; ++i)
     {
-        ASSERT((size_t) list_pop_back(p_list) == i);
+        ok &= unordered_map_remove(p_map, (void*) i) == (void*)(i + 1);
+        ok &= unordered_set_t_remove(p_set, (void*) i);
     }
     
-    ASSERT(list_size(p_list) == 0);
+    ASSERT(ok);
+    ASSERT(equals_calls == 4 * sz);
+    ASSERT(hash_calls == 8 * sz);
+    ASSERT(unordered_map_size(p_map) == 0);
+    ASSERT(unordered_set_t_size(p_set) == 0);
+    ASSERT(unordered_map_is_healthy(p_map));
+    ASSERT(unordered_set_t_is_healthy(p_set));
     
-    ASSERT(list_insert(p_list, 0, 0));
-    ASSERT(list_insert(p_list, 1, 1));
-    ASSERT(list_insert(p_list, 0, 2));
+    unordered_map_free(p_map);
+    unordered_set_t_free(p_set);
+}
+
+static void test_unordered_map_entry_reuse()
+{
+    const int sz = 100000;
+    const int CYCLES = 4;
+    const int SLAB_FILL = 1000000;
     
-    ASSERT((size_t) list_get(p_list, 0) == 2);
-    ASSERT((size_t) list_get(p_list, 1) == 0);
-    ASSERT((size_t) list_get(p_list, 2) == 1);
+    unordered_map* p_map = unordered_map_alloc(7, 
+                                               0.75f, 
+                                               hash_function, 
+                                               equals_function);
+    unordered_set* p_set = unordered_set_t_alloc(7, 
+                                                 0.75f, 
+                                                 hash_function, 
+                                                 equals_function);
+    unordered_map_iterator* p_map_iterator;
+    unordered_set_iterator* p_set_iterator;
+    void* p_key;
+    void* p_value;
+    int i;
+    int cycle;
+    int iterated;
+    bool ok = true;
     
-    /* <2, 0, 1> */
-    ASSERT(list_insert(p_list, 0, 10));
-    /* <10, 2, 0, 1> */
+    puts("--- unordered_map entry reuse ---");
+    
+    for (i = 0; i < sz; ++i)
+    {
+        unordered_map_put(p_map, (void*) i, (void*)(i + 1));
+        unordered_set_t_add(p_set, (void*) i);
+    }
+    
+    /* Every cycle frees half of the entries and takes them back from the free
+       list. Odd cycles reserve first, which moves the rest of the newest slab
+       to the free list as well. */
+    for (cycle = 0; cycle < CYCLES; ++cycle)
+    {
+        for (i = cycle % 2; i < sz; i += 2)
+        {
+            ok &= unordered_map_remove(p_map, (void*) i) != NULL;
+            ok &= unordered_set_t_remove(p_set, (void*) i);
+        }
+        
+        ASSERT(ok);
+        ASSERT(unordered_map_size(p_map) == sz / 2);
+        ASSERT(unordered_set_t_size(p_set) == sz / 2);
+        ASSERT(unordered_map_is_healthy(p_map));
+        ASSERT(unordered_set_t_is_healthy(p_set));
+        
+        if (cycle % 2 == 1)
+        {
+            ASSERT(unordered_map_reserve(p_map, sz));
+            ASSERT(unordered_set_t_reserve(p_set, sz));
+        }
+        
+        for (i = cycle % 2; i < sz; i += 2)
+        {
+            ok &= unordered_map_put(p_map, (void*) i, 
+                                    (void*)(i + cycle + 2)) == NULL;
+            ok &= unordered_set_t_add(p_set, (void*) i);
+        }
+        
+        ASSERT(ok);
+        ASSERT(unordered_map_size(p_map) == sz);
+        ASSERT(unordered_set_t_size(p_set) == sz);
+        ASSERT(unordered_map_is_healthy(p_map));
+        ASSERT(unordered_set_t_is_healthy(p_set));
+        
+        /* A reused entry must not keep the value of its previous mapping. */
+        for (i = cycle % 2; i < sz; i += 2)
+        {
+            ok &= unordered_map_get(p_map, (void*) i) == 
+                  (void*)(i + cycle + 2);
+            ok &= unordered_set_t_contains(p_set, (void*) i);
+        }
+        
+        ASSERT(ok);
+        
+        iterated = 0;
+        p_map_iterator = unordered_map_iterator_alloc(p_map);
+        
+        while (unordered_map_iterator_next(p_map_iterator, &p_key, &p_value))
+        {
+            ok &= unordered_map_get(p_map, p_key) == p_value;
+            ++iterated;
+        }
+        
+        unordered_map_iterator_free(p_map_iterator);
+        ASSERT(ok);
+        ASSERT(iterated == sz);
+        
+        iterated = 0;
+        p_set_iterator = unordered_set_iterator_t_alloc(p_set);
+        
+        while (unordered_set_iterator_t_next(p_set_iterator, &p_key))
+        {
+            ++iterated;
+        }
+        
+        unordered_set_iterator_t_free(p_set_iterator);
+        ASSERT(iterated == sz);
+    }
+    
+    /* 1M entries take a couple of dozen slabs, all released by the clear. */
+    for (i = sz; i < SLAB_FILL; ++i)
+    {
+        unordered_map_put(p_map, (void*) i, (void*)(i + 1));
+        unordered_set_t_add(p_set, (void*) i);
+    }
+    
+    ASSERT(unordered_map_size(p_map) == SLAB_FILL);
+    ASSERT(unordered_set_t_size(p_set) == SLAB_FILL);
+    
+    unordered_map_clear(p_map);
+    unordered_set_t_clear(p_set);
+    
+    ASSERT(unordered_map_size(p_map) == 0);
+    ASSERT(unordered_set_t_size(p_set) == 0);
+    ASSERT(unordered_map_is_healthy(p_map));
+    ASSERT(unordered_set_t_is_healthy(p_set));
+    ASSERT(unordered_map_get(p_map, (void*) 1) == NULL);
+    ASSERT(!unordered_set_t_contains(p_set, (void*) 1));
+    
+    p_map_iterator = unordered_map_iterator_alloc(p_map);
+    ASSERT(!unordered_map_iterator_next(p_map_iterator, &p_key, &p_value));
+    unordered_map_iterator_free(p_map_iterator);
+    
+    /* The cleared structures start over with fresh slabs. */
+    for (i = 0; i < sz; ++i)
+    {
+        ok &= unordered_map_put(p_map, (void*) i, (void*)(i + 3)) == NULL;
+        ok &= unordered_set_t_add(p_set, (void*) i);
+    }
+    
+    for (i = 0; i < sz; ++i)
+    {
+        ok &= unordered_map_get(p_map, (void*) i) == (void*)(i + 3);
+        ok &= unordered_set_t_contains(p_set, (void*) i);
+    }
+    
+    ASSERT(ok);
+    ASSERT(unordered_map_size(p_map) == sz);
+    ASSERT(unordered_set_t_size(p_set) == sz);
+    ASSERT(unordered_map_is_healthy(p_map));
+    ASSERT(unordered_set_t_is_healthy(p_set));
+    
+    unordered_map_free(p_map);
+    unordered_set_t_free(p_set);
+}
+
+void test_flat_unordered_map_correctness() 
+{
+    int i;
+    void* p_key;
+    void* p_value;
+    int expected_size;
+    bool* p_iterated = calloc(20, sizeof(bool));
+    flat_unordered_map* p_map = flat_unordered_map_alloc(7, 
+                                                         0.4f, 
+                                                         hash_function, 
+                                                         equals_function);
+    flat_unordered_map_iterator* p_iterator;
+    
+    for (i = -10; i < 10; ++i) 
+    {
+        ASSERT(flat_unordered_map_contains_key(p_map, (void*) i) == false);
+        ASSERT(flat_unordered_map_get(p_map, (void*) i) == NULL);
+        ASSERT(flat_unordered_map_size(p_map) == (i + 10));
+        
+        flat_unordered_map_put(p_map, (void*) i, (void*)(3 * i));
+        
+        ASSERT(flat_unordered_map_contains_key(p_map, (void*) i) == true);
+        ASSERT(flat_unordered_map_get(p_map, (void*) i) == (void*)(3 * i));
+        ASSERT(flat_unordered_map_size(p_map) == (i + 10) + 1);
+    }
+    
+    ASSERT(flat_unordered_map_is_healthy(p_map));
+    
+    expected_size = flat_unordered_map_size(p_map);
+    p_iterator = flat_unordered_map_iterator_alloc(p_map);
+    ASSERT(expected_size == 20);
+    
+    /* The iteration order is the slot order, so check each key once. */
+    for (i = -10; i < 10; ++i) 
+    {
+        ASSERT(flat_unordered_map_iterator_has_next(p_iterator) == 10 - i);
+        ASSERT(flat_unordered_map_iterator_next(p_iterator, 
+                                                &p_key, 
+                                                &p_value));
+        ASSERT(3 * (int) p_key == (int) p_value);
+        ASSERT(!p_iterated[(int) p_key + 10]);
+        p_iterated[(int) p_key + 10] = true;
+    }
+    
+    ASSERT(flat_unordered_map_iterator_has_next(p_iterator) == 0);
+    ASSERT(flat_unordered_map_size(p_map) == expected_size);
+    
+    flat_unordered_map_put(p_map, (void*) 100, (void*) 300);
+    ASSERT(flat_unordered_map_iterator_is_disturbed(p_iterator));
+    flat_unordered_map_iterator_free(p_iterator);
+    
+    flat_unordered_map_clear(p_map);
+    
+    ASSERT(flat_unordered_map_size(p_map) == 0);
+    ASSERT(flat_unordered_map_put(p_map, (void*) 1, (void*) 11) == NULL);
+    ASSERT(flat_unordered_map_size(p_map) == 1);
+    ASSERT(flat_unordered_map_put(p_map, (void*) 1, (void*) 12) 
+           == (void*) 11);
+    ASSERT(flat_unordered_map_size(p_map) == 1);
+    ASSERT(flat_unordered_map_contains_key(p_map, (void*) 1) == true);
+    ASSERT(flat_unordered_map_contains_key(p_map, (void*) 2) == false);
+    ASSERT(flat_unordered_map_get(p_map, (void*) 1) == (void*) 12);
+    ASSERT(flat_unordered_map_get(p_map, (void*) 2) == (void*) 0);
+  
+    ASSERT(flat_unordered_map_contains_key(p_map, (void*) 10) == false);
+    ASSERT(flat_unordered_map_get(p_map, (void*) 10) == 0);
+    ASSERT(flat_unordered_map_put(p_map, (void*) 10, (void*) 30) == 0);
+    ASSERT(flat_unordered_map_get(p_map, (void*) 10) == (void*) 30);
+    ASSERT(flat_unordered_map_contains_key(p_map, (void*) 10) == true);
+    ASSERT(flat_unordered_map_remove(p_map, (void*) 11) == NULL);
+    ASSERT(flat_unordered_map_get(p_map, (void*) 10) == (void*) 30);
+    ASSERT(flat_unordered_map_contains_key(p_map, (void*) 10) == true);
+    ASSERT(flat_unordered_map_remove(p_map, (void*) 10) == (void*) 30);
+    ASSERT(flat_unordered_map_get(p_map, (void*) 10) == 0);
+    ASSERT(flat_unordered_map_contains_key(p_map, (void*) 10) == false);
+    
+    /* Removals leave deleted slots behind, which the growth cleans up. */
+    for (i = 0; i < 10000; ++i) 
+    {
+        ASSERT(flat_unordered_map_put(p_map, (void*) i, (void*) i) 
+               == (i == 1 ? (void*) 12 : NULL));
+        
+        if (i % 3 == 0)
+        {
+            ASSERT(flat_unordered_map_remove(p_map, (void*) i) == (void*) i);
+        }
+    }
+    
+    ASSERT(flat_unordered_map_size(p_map) == 10000 - 3334);
+    ASSERT(flat_unordered_map_is_healthy(p_map));
+    
+    flat_unordered_map_free(p_map);
+    free(p_iterated);
+}
+
+void test_set_correctness() 
+{
+    int i;
+    void* p_key;
+    int expected_size;
+    set* p_set = set_alloc(int_comparator);
+    set_iterator* p_iterator;
+    
+    for (i = -10; i < 10; ++i) 
+    {
+        ASSERT(set_contains(p_set, (void*) i) == false);
+        ASSERT(set_size(p_set) == (i + 10));
+        
+        ASSERT(set_add(p_set, (void*) i) == true);
+        
+        ASSERT(set_contains(p_set, (void*) i) == true);
+        ASSERT(set_size(p_set) == (i + 10) + 1);
+    }
+    
+    expected_size = set_size(p_set);
+    p_iterator = set_iterator_alloc(p_set);
+    ASSERT(expected_size == 20);
+    
+    for (i = -10; i < 10; ++i) 
+    {
+        ASSERT(set_iterator_has_next(p_iterator) == 10 - i);
+        ASSERT(set_iterator_next(p_iterator, &p_key) == true);
+        ASSERT((int) p_key == i);
+    }
+    
+    ASSERT(set_iterator_has_next(p_iterator) == 0);
+    ASSERT(set_size(p_set) == expected_size);
+    
+    set_clear(p_set);
+    
+    ASSERT(set_size(p_set) == 0);
+    
+    ASSERT(set_add      (p_set, (void*) 1));
+    ASSERT(set_size     (p_set) == 1);
+    ASSERT(set_add      (p_set, (void*) 1) == false);
+    ASSERT(set_size     (p_set) == 1);
+    ASSERT(set_contains (p_set, (void*) 1));
+    ASSERT(set_contains (p_set, (void*) 2) == false);
+  
+    ASSERT(set_contains (p_set, (void*) 10) == false);
+    ASSERT(set_add      (p_set, (void*) 10));
+    ASSERT(set_contains (p_set, (void*) 10));
+    ASSERT(set_remove   (p_set, (void*) 11) == false);
+    ASSERT(set_remove   (p_set, (void*) 10));
+    ASSERT(set_contains (p_set, (void*) 10) == false);
+    
+    set_clear(p_set);
+    
+    set_free(p_set);
+}
+
+void test_unordered_set_correctness() 
+{
+    int i;
+    void* p_key;
+    int expected_size;
+    unordered_set* p_set = unordered_set_t_alloc(7, 0.8f, hash_function, equals_function);
+    unordered_set_iterator* p_iterator;
+    
+    for (i = -10; i < 10; ++i) 
+    {
+        ASSERT(unordered_set_t_contains(p_set, (void*) i) == false);
+        ASSERT(unordered_set_t_size(p_set) == (i + 10));
+        
+        ASSERT(unordered_set_t_add(p_set, (void*) i) == true);
+        
+        ASSERT(unordered_set_t_contains(p_set, (void*) i) == true);
+        ASSERT(unordered_set_t_size(p_set) == (i + 10) + 1);
+    }
+    
+    expected_size = unordered_set_t_size(p_set);
+    p_iterator = unordered_set_iterator_t_alloc(p_set);
+    ASSERT(expected_size == 20);
+    
+    for (i = -10; i < 10; ++i) 
+    {
+        ASSERT(unordered_set_iterator_t_has_next(p_iterator) == 10 - i);
+        ASSERT(unordered_set_iterator_t_next(p_iterator, &p_key) == true);
+        ASSERT((int) p_key == i);
+    }
+    
+    ASSERT(unordered_set_iterator_t_has_next(p_iterator) == 0);
+    ASSERT(unordered_set_t_size(p_set) == expected_size);
+    
+    unordered_set_t_clear(p_set);
+    
+    ASSERT(unordered_set_t_size(p_set) == 0);
+    
+    ASSERT(unordered_set_t_add      (p_set, (void*) 1));
+    ASSERT(unordered_set_t_size     (p_set) == 1);
+    ASSERT(unordered_set_t_add      (p_set, (void*) 1) == false);
+    ASSERT(unordered_set_t_size     (p_set) == 1);
+    ASSERT(unordered_set_t_contains (p_set, (void*) 1));
+    ASSERT(unordered_set_t_contains (p_set, (void*) 2) == false);
+    
+    ASSERT(unordered_set_t_contains (p_set, (void*) 10) == false);
+    ASSERT(unordered_set_t_add      (p_set, (void*) 10));
+    ASSERT(unordered_set_t_contains (p_set, (void*) 10));
+    ASSERT(unordered_set_t_remove   (p_set, (void*) 11) == false);
+    ASSERT(unordered_set_t_remove   (p_set, (void*) 10));
+    ASSERT(unordered_set_t_contains (p_set, (void*) 10) == false);
+}
+
+static void test_unordered_set_performance()
+{
+    unordered_set* p_set = unordered_set_t_alloc(7, 0.8f, hash_function, equals_function);
+    unordered_set_iterator* p_iterator;
+    
+    const int sz = 1000000;
+    
+    clock_t t;
+    double duration = 0.0;
+    int i;
+    int j;
+    int a;
+    int b;
+    int tmp;
+    void* p_element;
+    bool* p_check_list;
+    int seed;
+    int* array = malloc(sizeof(int) * sz);
+    p_check_list = calloc(sz, sizeof(bool));
+    
+    puts("--- PERFORMANCE OF unordered_set ---");
+    
+    for (i = 0; i < sz; ++i) 
+        array[i] = i;
+    
+    seed = time(NULL);
+    printf("Seed: %d.\n", seed);
+    srand(seed);
+    
+    for (i = 0; i < sz; ++i)
+    {
+        a = rand() % sz;
+        b = rand() % sz;
+        
+        tmp = array[a];
+        array[a] = array[b];
+        array[b] = tmp;
+    }
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i)
+    {
+        unordered_set_t_add(p_set, (void*) array[i]);
+    }
+    
+    duration += ((double) clock() - t);
+    
+    printf("Healthy: %d\n", unordered_set_t_is_healthy(p_set));
+    p_iterator = unordered_set_iterator_t_alloc(p_set);
+    t = clock();
+    
+    while (unordered_set_iterator_t_has_next(p_iterator)) 
+    {
+        unordered_set_iterator_t_next(p_iterator, &p_element);
+        
+        p_check_list[(int) p_element] = true;
+    }
+    
+    
+    duration += ((double) clock() - t);
+    
+    for (i = 0; i < sz; ++i) 
+    {
+        if (!p_check_list[i])
+        {
+            puts("Not all elements set.");
+            exit(1);
+        }
+    }
+    
+    t = clock();
+    
+    for (i = 0; i < 5; ++i) 
+        for (j = 0; j < sz; ++j) 
+            if (!unordered_set_t_contains(p_set, (void*) array[i])) 
+                exit(2);
+        
+    duration += ((double) clock() - t);
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i) 
+    {
+        if(!ASSERT(unordered_set_t_remove(p_set, (void*) array[i])))
+        {
+            printf("Fails at index %d\n", i);
+            exit(3);
+        }
+    }
+    
+    duration += ((double) clock() - t);
+    printf("Healthy: %d\n", unordered_set_t_is_healthy(p_set));
+    
+    p_iterator = unordered_set_iterator_t_alloc(p_set);
+    
+    /* Empty iterator. */
+    while (unordered_set_iterator_t_has_next(p_iterator)) 
+    {
+        unordered_set_iterator_t_next(p_iterator, &p_element);
+    }
+    
+    printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);    
+}
+
+static int priority_cmp(void* a, void* b) 
+{
+    return ((int) a) - ((int) b);
+}
+
+static void test_heap_correctness() 
+{
+    heap* p_heap;
+    size_t i;
+    
+    p_heap = heap_alloc(2, 
+                        10, 
+                        1.0f, 
+                        hash_function, 
+                        equals_function, priority_cmp);
+    
+    ASSERT(heap_is_healthy(p_heap));
+    
+    for (i = 0; i < 30; ++i) 
+    {
+        ASSERT(heap_add(p_heap, i, 30 - i));
+    }
+    
+    for (i = 0; i < 30; ++i)
+    {
+        ASSERT(!heap_add(p_heap, i, i));
+    }
+    
+    ASSERT(heap_size(p_heap) == 30);
+    
+    for (i = 0; i < 30; ++i) 
+    {
+        ASSERT(heap_contains(p_heap, i));
+    }
+    
+    for (i = 30; i < 40; ++i) 
+    {
+        ASSERT(heap_contains(p_heap, i) == false);
+    }
+    
+    ASSERT(heap_is_healthy(p_heap));
+    
+    for (i = 29; i != (size_t) -1; --i) 
+    {
+        ASSERT((int) heap_extract_min(p_heap) == i);
+    }
+    
+    ASSERT(heap_size(p_heap) == 0);
+    ASSERT(heap_is_healthy(p_heap));
+    
+    for (i = 10; i < 100; ++i) 
+    {
+        ASSERT(heap_add(p_heap, i, i));
+    }
+    
+    ASSERT(heap_decrease_key(p_heap, 50, 0));
+    
+    ASSERT((size_t) heap_min(p_heap) == 50);
+    ASSERT((size_t) heap_extract_min(p_heap) == 50);
+    
+    for (i = 10; i < 50; ++i) 
+    {
+        ASSERT((size_t) heap_min(p_heap) == i);
+        ASSERT((size_t) heap_extract_min(p_heap) == i);
+    }
+    
+    for (i = 51; i < 100; ++i) 
+    {
+        ASSERT((size_t) heap_min(p_heap) == i);
+        ASSERT((size_t) heap_extract_min(p_heap) == i);
+    }
+    
+    ASSERT(heap_min(p_heap) == NULL);
+    ASSERT(heap_extract_min(p_heap) == NULL);
+    
+    ASSERT(heap_add(p_heap, 30, 30));
+    ASSERT(heap_add(p_heap, 40, 40));
+    ASSERT(heap_contains(p_heap, 30));
+    ASSERT(heap_contains(p_heap, 40));
+    ASSERT(heap_size(p_heap) == 2);
+    
+    heap_clear(p_heap);
+    
+    ASSERT(heap_size(p_heap) == 0);
+    ASSERT(heap_extract_min(p_heap) == NULL);
+}
+
+static void test_heap_performance()
+{
+    heap* p_heap;
+    size_t degree;
+    size_t i;
+    clock_t t;
+    const size_t sz = 1000000;
+    double duration;
+    
+    puts("--- PERFORMANCE OF heap_t ---");
+    
+    for (degree = 2; degree <= 10; ++degree)
+    {
+        duration = 0.0;
+        printf("Degree %zu:\n", degree);
+        p_heap = heap_alloc(degree,
+                              10,
+                              1.0f,
+                              hash_function,
+                              equals_function,
+                              priority_cmp);
+        t = clock();
+        
+        for (i = 0; i < sz; ++i) 
+        {
+            heap_add(p_heap, i, 500000 + sz - i);
+        }
+        
+        /* State: 999999, 999998, 999997, ... */
+        ASSERT(heap_is_healthy(p_heap));
+        
+        for (i = sz / 2; i < sz; ++i)
+        {
+            heap_decrease_key(p_heap, i, i);
+        }
+        
+        ASSERT(heap_is_healthy(p_heap));
+        
+        for (i = 0; i < sz; ++i)
+        {
+            heap_extract_min(p_heap);
+        }
+        
+        duration += ((double) clock() - t);
+        
+        heap_free(p_heap);
+        
+        printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);
+    }
+}
+
+static bool int_eq(void* a, void* b)
+{
+    return a == b;
+}
+
+static void test_list_correctness()
+{
+    size_t i;
+    list* p_list = list_alloc(10);
+    
+    for (i = 0; i < 40; i++) 
+    {
+        ASSERT(list_push_back(p_list, 2 * i));
+    }
+    
+    ASSERT(list_size(p_list) == 40);
+    
+    for (i = 0; i < 40; ++i) 
+    {
+        ASSERT((size_t) list_get(p_list, i) == 2 * i);
+    }
+    
+    for (i = 0; i < 40; ++i) 
+    {
+        ASSERT(list_size(p_list) > 0);
+        ASSERT((size_t) list_pop_front(p_list) == 2 * i);
+    }
+    
+    ASSERT(list_size(p_list) == 0);
+    
+    for (i = 200; i > 0; --i) 
+    {
+        ASSERT(list_push_front(p_list, i));
+    }
+    
+    ASSERT(list_size(p_list) == 200);
+    
+    for (i = 200; i > 0; --i) 
+    {
+        ASSERT((size_t) list_pop_back(p_list) == i);
+    }
+    
+    ASSERT(list_size(p_list) == 0);
+    
+    ASSERT(list_insert(p_list, 0, 0));
+    ASSERT(list_insert(p_list, 1, 1));
+    ASSERT(list_insert(p_list, 0, 2));
+    
+    ASSERT((size_t) list_get(p_list, 0) == 2);
+    ASSERT((size_t) list_get(p_list, 1) == 0);
+    ASSERT((size_t) list_get(p_list, 2) == 1);
+    
+    /* <2, 0, 1> */
+    ASSERT(list_insert(p_list, 0, 10));
+    /* <10, 2, 0, 1> */
     ASSERT(list_insert(p_list, 4, 11));
     /* <10, 2, 0, 1, 11> */
     ASSERT(list_insert(p_list, 2, 12));
@@ -927,399 +2001,2218 @@ static void test_list_correctness()
     ASSERT(list_insert(p_list, 3, 14));
     /* <10, 2, 12, 14, 0, 1, 11> */
     
-    ASSERT((size_t) list_get(p_list, 0) == 10);
-    ASSERT((size_t) list_get(p_list, 1) == 2);
-    ASSERT((size_t) list_get(p_list, 2) == 12);
-    ASSERT((size_t) list_get(p_list, 3) == 14);
-    ASSERT((size_t) list_get(p_list, 4) == 0);
-    ASSERT((size_t) list_get(p_list, 5) == 1);
-    ASSERT((size_t) list_get(p_list, 6) == 11);
+    ASSERT((size_t) list_get(p_list, 0) == 10);
+    ASSERT((size_t) list_get(p_list, 1) == 2);
+    ASSERT((size_t) list_get(p_list, 2) == 12);
+    ASSERT((size_t) list_get(p_list, 3) == 14);
+    ASSERT((size_t) list_get(p_list, 4) == 0);
+    ASSERT((size_t) list_get(p_list, 5) == 1);
+    ASSERT((size_t) list_get(p_list, 6) == 11);
+    
+    ASSERT((size_t) list_set(p_list, 5, 100) == 1);
+    ASSERT((size_t) list_get(p_list, 5) == 100);
+    
+    ASSERT(list_size(p_list) == 7);
+    
+    ASSERT(list_contains(p_list,  10,  int_eq));
+    ASSERT(list_contains(p_list,  2,   int_eq));
+    ASSERT(list_contains(p_list,  12,  int_eq));
+    ASSERT(list_contains(p_list,  14,  int_eq));
+    ASSERT(list_contains(p_list,  0,   int_eq));
+    ASSERT(list_contains(p_list,  100, int_eq));
+    ASSERT(list_contains(p_list,  11,  int_eq));
+    ASSERT(!list_contains(p_list, 15,  int_eq));
+    ASSERT(!list_contains(p_list, 16,  int_eq));
+    
+    ASSERT(list_size(p_list) == 7);
+    
+    /* <10, 2, 12, 14, 0, 100, 11*/
+    ASSERT(list_remove_at(p_list, 4) == 0);
+    /* <10, 2, 12, 14, 100, 11> */
+    ASSERT((int) list_remove_at(p_list, 4) == 100);
+    /* <10, 2, 12, 14, 11> */
+    ASSERT((int) list_remove_at(p_list, 4) == 11);
+    /* <10, 2, 12, 14> */
+    ASSERT((int) list_remove_at(p_list, 0) == 10);
+    /* <2, 12, 14> */
+    ASSERT(list_remove_at(p_list, 4) == NULL);
+    ASSERT(list_remove_at(p_list, 3) == NULL);
+    /* <2, 12, 14> */
+    ASSERT((int) list_remove_at(p_list, 1) == 12);
+    /* <2, 14> */
+    ASSERT((int) list_remove_at(p_list, 1) == 14);
+    /* <2> */
+    ASSERT((int) list_remove_at(p_list, 0) == 2);
+    
+    ASSERT(list_size(p_list) == 0);
+    
+    for (i = 0; i < 5; ++i) 
+    {
+        ASSERT(list_push_front(p_list, 2 * i + 1));
+    }
+    
+    ASSERT((int) list_remove_at(p_list, 2) == 5);
+    ASSERT((int) list_pop_front(p_list) == 9);
+    ASSERT((int) list_pop_back(p_list) == 1);
+    ASSERT((int) list_pop_front(p_list) == 7);
+    ASSERT((int) list_pop_back(p_list) == 3);
+    
+    list_insert(p_list, 0, 1);
+    list_insert(p_list, 0, 2);
+    
+    ASSERT(list_size(p_list) == 2);
+    list_clear(p_list);
+    ASSERT(list_size(p_list) == 0);
+    ASSERT(list_push_front(p_list, 2));
+    ASSERT(list_push_front(p_list, 3));
+    ASSERT(list_push_front(p_list, 4));
+    list_free(p_list);
+}
+
+static void test_list_performance()
+{
+    list* p_list = list_alloc(10);
+    const int sz = 1000000;
+    
+    clock_t t;
+    double duration = 0.0;
+    int i;
+    int j;
+    int a;
+    int b;
+    int tmp;
+    int time_;
+    void* p_element;
+    
+    puts("--- PERFORMANCE OF list_t ---");
+    
+    time_ = time(NULL);
+    printf("Seed: %d.\n", time_);
+    srand(time_);
+    
+    t = clock();
+    
+    for (i = 0; i < sz / 2; ++i) 
+    {
+        ASSERT(list_push_front(p_list, sz / 2 - i - 1));
+    }
+    
+    for (i = sz / 2; i < sz; ++i) 
+    {
+        ASSERT(list_push_back(p_list, i));
+    }
+    
+    duration += ((double) clock() - t);
+    
+    t = clock();
+
+    for (i = 0; i < sz; ++i) 
+    {
+        ASSERT((int) list_get(p_list, i) == i);
+    }
+    
+    duration += ((double) clock() - t);
+    
+    t = clock();
+    
+    for (i = 0; i < sz; ++i)
+    {
+        ASSERT((int) list_pop_front(p_list) == i);
+    }
+    
+    duration += ((double) clock() - t);
+    
+    printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);        
+}
+
+static void test_fibonacci_heap_correctness() 
+{
+    fibonacci_heap* p_heap;
+    size_t i;
+    p_heap = fibonacci_heap_alloc(10, 
+                                    1.0f, 
+                                    hash_function, 
+                                    equals_function, 
+                                    priority_cmp);
+    
+    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    
+    for (i = 0; i < 30; ++i) 
+    {
+        ASSERT(fibonacci_heap_add(p_heap, i, 30 - i));
+    }
+    
+    for (i = 0; i < 30; ++i)
+    {
+        ASSERT(!fibonacci_heap_add(p_heap, i, i));
+    }
+    
+    ASSERT(fibonacci_heap_size(p_heap) == 30);
+    
+    for (i = 0; i < 30; ++i) 
+    {
+        ASSERT(fibonacci_heap_contains_key(p_heap, i));
+    }
+    
+    for (i = 30; i < 40; ++i) 
+    {
+        ASSERT(fibonacci_heap_contains_key(p_heap, i) == false);
+    }
+    
+    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    
+    for (i = 29; i != (size_t) -1; --i) 
+    {
+        ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == i);
+    }
+    
+    ASSERT(fibonacci_heap_size(p_heap) == 0);
+    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    
+    for (i = 10; i < 100; ++i) 
+    {
+        ASSERT(fibonacci_heap_add(p_heap, i, i));
+    }
+    
+    ASSERT(fibonacci_heap_decrease_key(p_heap, 50, 0));
+    
+    ASSERT((size_t) fibonacci_heap_min(p_heap) == 50);
+    ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == 50);
+    
+    for (i = 10; i < 50; ++i) 
+    {
+        ASSERT((size_t) fibonacci_heap_min(p_heap) == i);
+        ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == i);
+    }
+    
+    for (i = 51; i < 100; ++i) 
+    {
+        ASSERT((size_t) fibonacci_heap_min(p_heap) == i);
+        ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == i);
+    }
+    
+    ASSERT(fibonacci_heap_min(p_heap) == NULL);
+    ASSERT(fibonacci_heap_extract_min(p_heap) == NULL);
+    
+    for (i = 20; i < 40; ++i) 
+    {
+        ASSERT(fibonacci_heap_add(p_heap, i, i));
+    }
+    
+    ASSERT(fibonacci_heap_size(p_heap) == 20);
+    
+    fibonacci_heap_clear(p_heap);
+    
+    ASSERT(fibonacci_heap_size(p_heap) == 0);
+    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    
+    for (i = 0; i < 100; ++i) 
+    {
+        ASSERT(fibonacci_heap_contains_key(p_heap, i) == false);
+    }
+    
+    ASSERT(fibonacci_heap_add(p_heap, 2, 2));
+    ASSERT(fibonacci_heap_add(p_heap, 3, 3));
+    fibonacci_heap_free(p_heap);
+}
+
+static void test_fibonacci_heap_performance()
+{
+    fibonacci_heap* p_heap;
+    size_t i;
+    clock_t t;
+    const size_t sz = 1000000;
+    double duration;
+    
+    puts("--- PERFORMANCE OF fibonacci_heap_t ---");
+    
+    duration = 0.0;
+    p_heap = fibonacci_heap_alloc(10,
+                                    1.0f,
+                                    hash_function,
+                                    equals_function,
+                                    priority_cmp);
+    t = clock();
+
+    for (i = 0; i < sz; ++i) 
+    {
+        fibonacci_heap_add(p_heap, i, 500000 + sz - i);
+    }
+
+    /* State: 999999, 999998, 999997, ... */
+    ASSERT(fibonacci_heap_is_healthy(p_heap));
+
+    for (i = sz / 2; i < sz; ++i)
+    {
+        fibonacci_heap_decrease_key(p_heap, i, i);
+    }
+
+    ASSERT(fibonacci_heap_is_healthy(p_heap));
+
+    for (i = 0; i < sz; ++i)
+    {
+        fibonacci_heap_extract_min(p_heap);
+    }
+
+    duration += ((double) clock() - t);
+
+    fibonacci_heap_free(p_heap);
+
+    printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);
+}
+
+static bool is_sorted(void* base,
+                      size_t num, 
+                      size_t size, 
+                      int (*cmp)(const void*, const void*))
+{
+    size_t i;
+    
+    for (i = 0; i < num - 1; ++i) 
+    {
+        if (cmp(((char*) base) + size * i, ((char*) base) + size * (i + 1)) > 0) 
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static bool int_arrays_are_equal(int* arr1, int* arr2, size_t num)
+{
+    size_t i;
+    
+    for (i = 0; i < num; ++i) 
+    {
+        if (arr1[i] != arr2[i])
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static int* alloc_int_array(size_t size)
+{
+    return malloc(sizeof(int) * size);
+}
+
+static int* get_random_integer_array(size_t size)
+{
+    size_t i;
+    int* array = alloc_int_array(size);
+    
+    srand(time(NULL));
+    
+    for (i = 0; i < size; ++i) 
+    {
+        array[i] = rand();
+    }
+    
+    return array;
+}
+
+static int* get_presorted_integer_array(size_t num, size_t run_length)
+{
+    size_t i;
+    int* array = malloc(sizeof(int) * num);
+    
+    for (i = 0; i < num; ++i) 
+    {
+        array[i] = run_length - i % run_length;
+    }
+    
+    return array;
+}
+
+static int* get_blocked_integer_array(size_t num, size_t block_length)
+{
+    size_t i;
+    size_t half = num / 2;
+    int* array = malloc(sizeof(int) * num);
+    
+    /* Two sorted halves whose merge alternates between long blocks. */
+    for (i = 0; i < num; ++i) 
+    {
+        size_t j = i < half ? i : i - half;
+        array[i] = (j / block_length) * 2 * block_length 
+                 + (i < half ? 0 : block_length)
+                 + j % block_length;
+    }
+    
+    return array;
+}
+
+static int* copy_integer_array(int* array, size_t num)
+{
+    int* copy = alloc_int_array(num);
+    memcpy(copy, array, sizeof(int) * num);
+    return copy;
+}
+
+static double wall_clock_seconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct key_index_pair {
+    int    key;
+    size_t index;
+} key_index_pair;
+
+static int key_index_pair_cmp(const void* a, const void* b)
+{
+    return ((key_index_pair*) a)->key - ((key_index_pair*) b)->key;
+}
+
+static bool is_stably_sorted(key_index_pair* pairs, size_t num)
+{
+    size_t i;
+    
+    for (i = 0; i + 1 < num; ++i) 
+    {
+        if (pairs[i].key > pairs[i + 1].key)
+        {
+            return false;
+        }
+        
+        if (pairs[i].key == pairs[i + 1].key 
+                && pairs[i].index > pairs[i + 1].index)
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+STABLE_SORT_DEFINE(typed_sort_int, int, a < b)
+STABLE_SORT_DEFINE(typed_sort_key_index_pair, key_index_pair, a.key < b.key)
+
+static void test_stable_sort() 
+{
+    clock_t t;
+    double duration;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t RUNS = 4;
+    
+    int* array1 = get_presorted_integer_array(ARRAY_SIZE, RUNS);
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- stable_sort ---");
+    puts("- Presorted array -");
+    
+    t = clock();
+    qsort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("qsort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    t = clock();
+    stable_sort(array2, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+       
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    /** Profiling on random integer array *************************************/
+    
+    puts("- Random array -");
+    
+    array1 = get_random_integer_array(ARRAY_SIZE);
+    array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    t = clock();
+    qsort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("qsort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    t = clock();
+    stable_sort(array2, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(array1);
+    free(array2);
+    
+    /** Profiling on an array whose merge is dominated by long blocks *********/
+    
+    puts("- Blocked array -");
+    
+    array1 = get_blocked_integer_array(ARRAY_SIZE, 1000);
+    array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    t = clock();
+    qsort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("qsort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    t = clock();
+    stable_sort(array2, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(array1);
+    free(array2);
+}
+
+// Sixteen bytes long, so that 'stable_sort' merges it by a specialized copy:
+typedef struct wide_key_index_pair
+{
+    int64_t key;
+    int64_t index;
+}
+wide_key_index_pair;
+
+static int wide_key_index_pair_cmp(const void* a, const void* b)
+{
+    const int64_t x = ((const wide_key_index_pair*) a)->key;
+    const int64_t y = ((const wide_key_index_pair*) b)->key;
+    return (x > y) - (x < y);
+}
+
+/*******************************************************************************
+* Returns true if the pairs are sorted by key, the pairs with equal keys are   *
+* in index order, and each index from 0 to 'num - 1' occurs exactly once.      *
+*******************************************************************************/
+static bool wide_pairs_are_stably_sorted(const wide_key_index_pair* pairs, 
+                                         const size_t num)
+{
+    bool* seen = calloc(num + 1, sizeof(bool));
+    bool result = true;
+    size_t i;
+    
+    for (i = 0; i < num && result; ++i)
+    {
+        const int64_t index = pairs[i].index;
+        
+        if (index < 0 || (size_t) index >= num || seen[index])
+        {
+            result = false;
+        }
+        else
+        {
+            seen[index] = true;
+        }
+        
+        if (i + 1 < num 
+                && (pairs[i].key > pairs[i + 1].key
+                    || (pairs[i].key == pairs[i + 1].key 
+                        && pairs[i].index > pairs[i + 1].index)))
+        {
+            result = false;
+        }
+    }
+    
+    free(seen);
+    return result;
+}
+
+static void test_stable_sort_wide_records()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    size_t input;
+    
+    const size_t ARRAY_SIZE = 5 * 1000 * 1000;
+    
+    wide_key_index_pair* pairs = malloc(sizeof(wide_key_index_pair) 
+                                        * ARRAY_SIZE);
+    int* blocked = get_blocked_integer_array(ARRAY_SIZE, 1000);
+    
+    puts("--- stable_sort on 16-byte records ---");
+    
+    for (input = 0; input < 2; ++input)
+    {
+        // The blocked keys are divided so that the galloping merge sees long
+        // blocks with equal keys on both sides:
+        for (i = 0; i < ARRAY_SIZE; ++i)
+        {
+            pairs[i].key = input == 0 ? rand() % 1000 : blocked[i] / 10;
+            pairs[i].index = (int64_t) i;
+        }
+        
+        puts(input == 0 ? "- Random keys -" : "- Blocked keys -");
+        
+        t = clock();
+        stable_sort(pairs, 
+                    ARRAY_SIZE, 
+                    sizeof(wide_key_index_pair), 
+                    wide_key_index_pair_cmp);
+        duration = (double) clock() - t;
+        
+        bool stable = wide_pairs_are_stably_sorted(pairs, ARRAY_SIZE);
+        printf("stable_sort in %f seconds. Stable: %d\n", 
+               duration / CLOCKS_PER_SEC, 
+               stable);
+        ASSERT(stable);
+    }
+    
+    free(blocked);
+    free(pairs);
+}
+
+static void test_stable_sort_with_buffer()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t SMALL_ARRAY_SIZE = 100;
+    
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- stable_sort_with_buffer ---");
+    puts("- Many small arrays -");
+    
+    t = clock();
+    
+    for (i = 0; i < ARRAY_SIZE; i += SMALL_ARRAY_SIZE)
+    {
+        stable_sort(array1 + i, SMALL_ARRAY_SIZE, sizeof(int), int_cmp);
+    }
+    
+    duration = (double) clock() - t;
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    size_t scratch_size = stable_sort_scratch_size(SMALL_ARRAY_SIZE, 
+                                                   sizeof(int));
+    void* scratch = malloc(scratch_size);
+    bool ok = true;
+    
+    t = clock();
+    
+    for (i = 0; i < ARRAY_SIZE; i += SMALL_ARRAY_SIZE)
+    {
+        ok &= stable_sort_with_buffer(array2 + i, 
+                                      SMALL_ARRAY_SIZE, 
+                                      sizeof(int), 
+                                      int_cmp,
+                                      scratch,
+                                      scratch_size) == STABLE_SORT_SUCCESS;
+    }
+    
+    duration = (double) clock() - t;
+    printf("stable_sort_with_buffer in %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(ok);
+    ASSERT(eq);
+    
+    /** Errors are reported instead of aborting *******************************/
+    
+    int* array3 = get_random_integer_array(SMALL_ARRAY_SIZE);
+    int* array4 = copy_integer_array(array3, SMALL_ARRAY_SIZE);
+    
+    ASSERT(stable_sort_with_buffer(array3, 
+                                   SMALL_ARRAY_SIZE, 
+                                   sizeof(int), 
+                                   int_cmp,
+                                   scratch,
+                                   scratch_size - 1) 
+           == STABLE_SORT_BUFFER_TOO_SMALL);
+    ASSERT(int_arrays_are_equal(array3, array4, SMALL_ARRAY_SIZE));
+    ASSERT(stable_sort_with_buffer(NULL, 
+                                   SMALL_ARRAY_SIZE, 
+                                   sizeof(int), 
+                                   int_cmp,
+                                   scratch,
+                                   scratch_size) 
+           == STABLE_SORT_INVALID_ARGUMENT);
+    ASSERT(stable_sort_with_buffer(array3, 1, sizeof(int), int_cmp, NULL, 0)
+           == STABLE_SORT_SUCCESS);
+    
+    free(scratch);
+    free(array1);
+    free(array2);
+    free(array3);
+    free(array4);
+}
+
+static void test_typed_stable_sort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- STABLE_SORT_DEFINE ---");
+    puts("- Random array -");
+    
+    t = clock();
+    stable_sort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    t = clock();
+    typed_sort_int(array2, ARRAY_SIZE);
+    duration = (double) clock() - t;
+    
+    printf("typed_sort_int in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(array1);
+    free(array2);
+    
+    /** Stability on an array with many equal keys ****************************/
+    
+    puts("- Stability -");
+    
+    int* keys = get_random_integer_array(ARRAY_SIZE);
+    key_index_pair* pairs = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        pairs[i].key   = keys[i] % 1000;
+        pairs[i].index = i;
+    }
+    
+    typed_sort_key_index_pair(pairs, ARRAY_SIZE);
+    
+    eq = is_stably_sorted(pairs, ARRAY_SIZE);
+    printf("Stable: %d\n", eq);
+    ASSERT(eq);
+    
+    free(keys);
+    free(pairs);
+}
+
+static int double_cmp(const void* a, const void* b)
+{
+    const double x = *(const double*) a;
+    const double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static void test_primitive_sort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    int* array3 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- stable_sort_int32 ---");
+    puts("- Random array -");
+    
+    t = clock();
+    stable_sort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    typed_sort_int(array2, ARRAY_SIZE);
+    duration = (double) clock() - t;
+    
+    printf("typed_sort_int in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    stable_sort_int32((int32_t*) array3, ARRAY_SIZE);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort_int32 in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    bool eq = int_arrays_are_equal(array1, array3, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(array1);
+    free(array2);
+    free(array3);
+    
+    puts("--- stable_sort_double ---");
+    puts("- Random array -");
+    
+    double* array4 = malloc(sizeof(double) * ARRAY_SIZE);
+    double* array5 = malloc(sizeof(double) * ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        array4[i] = (double) rand() / RAND_MAX - 0.5;
+    }
+    
+    memcpy(array5, array4, sizeof(double) * ARRAY_SIZE);
+    
+    t = clock();
+    stable_sort(array4, ARRAY_SIZE, sizeof(double), double_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    stable_sort_double(array5, ARRAY_SIZE);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort_double in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    eq = memcmp(array4, array5, sizeof(double) * ARRAY_SIZE) == 0;
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(array4);
+    free(array5);
+}
+
+static int int32_cmp(const void* a, const void* b)
+{
+    const int32_t x = *(const int32_t*) a;
+    const int32_t y = *(const int32_t*) b;
+    return (x > y) - (x < y);
+}
+
+static int int64_cmp(const void* a, const void* b)
+{
+    const int64_t x = *(const int64_t*) a;
+    const int64_t y = *(const int64_t*) b;
+    return (x > y) - (x < y);
+}
+
+static int float_cmp(const void* a, const void* b)
+{
+    const float x = *(const float*) a;
+    const float y = *(const float*) b;
+    return (x > y) - (x < y);
+}
+
+typedef enum primitive_pattern
+{
+    PRIMITIVE_RANDOM,
+    PRIMITIVE_FEW_DISTINCT,
+    PRIMITIVE_EXTREMES,
+    PRIMITIVE_DESCENDING
+}
+primitive_pattern;
+
+static const size_t PRIMITIVE_PATTERNS = 4;
+
+static int64_t random_int64()
+{
+    const uint64_t bits = ((uint64_t) rand() << 48) 
+                        ^ ((uint64_t) rand() << 24) 
+                        ^ (uint64_t) rand();
+    return (int64_t) bits;
+}
+
+/*******************************************************************************
+* Returns the 'i'th of 'num' test keys following 'pattern'. The extremes are   *
+* the limits of the type, -1, 0 and 1 for integers, and the infinities, the    *
+* limits, the smallest normal and subnormal values and both zeros for floating *
+* point numbers.                                                               *
+*******************************************************************************/
+static int64_t int64_test_key(const primitive_pattern pattern, 
+                              const size_t i, 
+                              const size_t num)
+{
+    static const int64_t EXTREMES[] = { INT64_MIN, INT64_MAX, -1, 0, 1 };
+    
+    switch (pattern)
+    {
+        case PRIMITIVE_RANDOM:
+            return random_int64();
+            
+        case PRIMITIVE_FEW_DISTINCT:
+            return rand() % 5 - 2;
+            
+        case PRIMITIVE_EXTREMES:
+            return EXTREMES[rand() % 5];
+            
+        default:
+            return (int64_t) (num - i) - (int64_t) (num / 2);
+    }
+}
+
+static int32_t int32_test_key(const primitive_pattern pattern, 
+                              const size_t i, 
+                              const size_t num)
+{
+    static const int32_t EXTREMES[] = { INT32_MIN, INT32_MAX, -1, 0, 1 };
+    
+    switch (pattern)
+    {
+        case PRIMITIVE_RANDOM:
+            return (int32_t) (random_int64() >> 32);
+            
+        case PRIMITIVE_EXTREMES:
+            return EXTREMES[rand() % 5];
+            
+        default:
+            return (int32_t) int64_test_key(pattern, i, num);
+    }
+}
+
+// A random value between -2^29 and 2^29, with a random exponent:
+static double random_double()
+{
+    const double value = (double) rand() / RAND_MAX - 0.5;
+    const double scale = (double) (1 << (rand() % 30));
+    return rand() % 2 ? value * scale : value / scale;
+}
+
+static double double_test_key(const primitive_pattern pattern, 
+                              const size_t i, 
+                              const size_t num)
+{
+    static const double EXTREMES[] = { -INFINITY, INFINITY, -DBL_MAX, DBL_MAX,
+                                       -DBL_MIN, DBL_MIN, -DBL_MIN / 4, 
+                                       DBL_MIN / 4, -0.0, 0.0 };
+    
+    switch (pattern)
+    {
+        case PRIMITIVE_RANDOM:
+            return random_double();
+            
+        case PRIMITIVE_EXTREMES:
+            return EXTREMES[rand() % 10];
+            
+        default:
+            return (double) int64_test_key(pattern, i, num);
+    }
+}
+
+static float float_test_key(const primitive_pattern pattern, 
+                            const size_t i, 
+                            const size_t num)
+{
+    static const float EXTREMES[] = { -INFINITY, INFINITY, -FLT_MAX, FLT_MAX,
+                                      -FLT_MIN, FLT_MIN, -FLT_MIN / 4, 
+                                      FLT_MIN / 4, -0.0f, 0.0f };
+    
+    switch (pattern)
+    {
+        case PRIMITIVE_EXTREMES:
+            return EXTREMES[rand() % 10];
+            
+        default:
+            return (float) double_test_key(pattern, i, num);
+    }
+}
+
+/*******************************************************************************
+* Defines a function that sorts 'num' keys following 'pattern' with 'sort' and *
+* with 'stable_sort' and returns true if the results are equal. Floating point *
+* keys are compared with ==, since the order of -0.0 and +0.0 is unspecified.  *
+*******************************************************************************/
+#define DEFINE_PRIMITIVE_SORT_CHECK(name, type, sort, cmp, make_key)           \
+static bool name(const primitive_pattern pattern, const size_t num)            \
+{                                                                              \
+    type* array1 = malloc(sizeof(type) * (num + 1));                           \
+    type* array2 = malloc(sizeof(type) * (num + 1));                           \
+    bool eq = true;                                                            \
+    size_t i;                                                                  \
+                                                                               \
+    for (i = 0; i < num; ++i)                                                  \
+    {                                                                          \
+        array1[i] = make_key(pattern, i, num);                                 \
+    }                                                                          \
+                                                                               \
+    memcpy(array2, array1, sizeof(type) * num);                                \
+    stable_sort(array1, num, sizeof(type), cmp);                               \
+    sort(array2, num);                                                         \
+                                                                               \
+    for (i = 0; i < num; ++i)                                                  \
+    {                                                                          \
+        eq = eq && array1[i] == array2[i];                                     \
+    }                                                                          \
+                                                                               \
+    free(array1);                                                              \
+    free(array2);                                                              \
+    return eq;                                                                 \
+}
+
+DEFINE_PRIMITIVE_SORT_CHECK(check_sort_int32, 
+                            int32_t, 
+                            stable_sort_int32, 
+                            int32_cmp, 
+                            int32_test_key)
+DEFINE_PRIMITIVE_SORT_CHECK(check_sort_int64, 
+                            int64_t, 
+                            stable_sort_int64, 
+                            int64_cmp, 
+                            int64_test_key)
+DEFINE_PRIMITIVE_SORT_CHECK(check_sort_float, 
+                            float, 
+                            stable_sort_float, 
+                            float_cmp, 
+                            float_test_key)
+DEFINE_PRIMITIVE_SORT_CHECK(check_sort_double, 
+                            double, 
+                            stable_sort_double, 
+                            double_cmp, 
+                            double_test_key)
+
+static void test_primitive_sort_edge_cases()
+{
+    // Every length up to 200, then the lengths around multiples of the block
+    // lengths of 32 and 64 keys. Lengths below a block take the scalar path
+    // alone:
+    const size_t LONGER_LENGTHS[] = { 255, 256, 257, 511, 512, 513, 
+                                      1023, 1024, 1025, 4095, 4096, 4097 };
+    const size_t LONGER_COUNT = sizeof(LONGER_LENGTHS) 
+                              / sizeof(LONGER_LENGTHS[0]);
+    bool int32_ok  = true;
+    bool int64_ok  = true;
+    bool float_ok  = true;
+    bool double_ok = true;
+    size_t i;
+    size_t pattern;
+    
+    puts("--- stable_sort_int32/int64/float/double edge cases ---");
+    
+    for (i = 0; i <= 200 + LONGER_COUNT; ++i)
+    {
+        const size_t num = i <= 200 ? i : LONGER_LENGTHS[i - 201];
+        
+        for (pattern = 0; pattern < PRIMITIVE_PATTERNS; ++pattern)
+        {
+            int32_ok  = check_sort_int32(pattern, num)  && int32_ok;
+            int64_ok  = check_sort_int64(pattern, num)  && int64_ok;
+            float_ok  = check_sort_float(pattern, num)  && float_ok;
+            double_ok = check_sort_double(pattern, num) && double_ok;
+        }
+    }
+    
+    printf("int32: %d, int64: %d, float: %d, double: %d\n", 
+           int32_ok, 
+           int64_ok, 
+           float_ok, 
+           double_ok);
+    ASSERT(int32_ok);
+    ASSERT(int64_ok);
+    ASSERT(float_ok);
+    ASSERT(double_ok);
+}
+
+static void test_stable_argsort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    size_t j;
+    
+    // Sorting the indices pays off only once the records are large enough
+    // that moving them costs more than the scattered comparisons:
+    const size_t RECORD_SIZES[] = { 200, 2048 };
+    const size_t ARRAY_SIZES[]  = { 1000 * 1000, 100 * 1000 };
+    
+    puts("--- stable_argsort ---");
+    
+    for (j = 0; j < sizeof(RECORD_SIZES) / sizeof(RECORD_SIZES[0]); ++j)
+    {
+        const size_t RECORD_SIZE = RECORD_SIZES[j];
+        const size_t ARRAY_SIZE = ARRAY_SIZES[j];
+        
+        int* keys = get_random_integer_array(ARRAY_SIZE);
+        char* records1 = malloc(RECORD_SIZE * ARRAY_SIZE);
+        char* records2 = malloc(RECORD_SIZE * ARRAY_SIZE);
+        size_t* permutation = malloc(sizeof(size_t) * ARRAY_SIZE);
+        
+        // Each record starts with its key, followed by the payload:
+        for (i = 0; i < ARRAY_SIZE; ++i)
+        {
+            const int key = keys[i] % 1000;
+            char* record = records1 + i * RECORD_SIZE;
+            
+            memset(record, (int) i, RECORD_SIZE);
+            memcpy(record, &key, sizeof(int));
+        }
+        
+        memcpy(records2, records1, RECORD_SIZE * ARRAY_SIZE);
+        
+        printf("- Random array of %zu-byte records -\n", RECORD_SIZE);
+        
+        t = clock();
+        stable_sort(records1, ARRAY_SIZE, RECORD_SIZE, int_cmp);
+        duration = (double) clock() - t;
+        
+        printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+        
+        t = clock();
+        stable_argsort(records2, ARRAY_SIZE, RECORD_SIZE, int_cmp, permutation);
+        apply_permutation(records2, ARRAY_SIZE, RECORD_SIZE, permutation);
+        duration = (double) clock() - t;
+        
+        printf("stable_argsort and apply_permutation in %f seconds.\n", 
+               duration / CLOCKS_PER_SEC);
+        
+        bool eq = memcmp(records1, records2, RECORD_SIZE * ARRAY_SIZE) == 0;
+        printf("Arrays equal: %d\n", eq);
+        ASSERT(eq);
+        
+        free(keys);
+        free(records1);
+        free(records2);
+        free(permutation);
+    }
+}
+
+static void test_stable_sort_low_memory()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t RUNS = 1000;
+    
+    int* inputs[2];
+    inputs[0] = get_random_integer_array(ARRAY_SIZE);
+    inputs[1] = get_presorted_integer_array(ARRAY_SIZE, RUNS);
+    
+    puts("--- stable_sort_low_memory ---");
+    
+    for (i = 0; i < 2; ++i)
+    {
+        puts(i == 0 ? "- Random array -" : "- Presorted array -");
+        
+        int* array1 = copy_integer_array(inputs[i], ARRAY_SIZE);
+        int* array2 = copy_integer_array(inputs[i], ARRAY_SIZE);
+        
+        t = clock();
+        stable_sort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+        duration = (double) clock() - t;
+        
+        printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+        
+        t = clock();
+        stable_sort_low_memory(array2, ARRAY_SIZE, sizeof(int), int_cmp);
+        duration = (double) clock() - t;
+        
+        printf("stable_sort_low_memory in %f seconds.\n", 
+               duration / CLOCKS_PER_SEC);
+        
+        bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+        printf("Arrays equal: %d\n", eq);
+        ASSERT(eq);
+        
+        free(array1);
+        free(array2);
+        free(inputs[i]);
+    }
+    
+    /** Stability *************************************************************/
+    
+    const size_t PAIR_ARRAY_SIZE = 1000 * 1000;
+    key_index_pair* pairs = malloc(sizeof(key_index_pair) * PAIR_ARRAY_SIZE);
+    
+    for (i = 0; i < PAIR_ARRAY_SIZE; ++i)
+    {
+        pairs[i].key = rand() % 1000;
+        pairs[i].index = i;
+    }
+    
+    stable_sort_low_memory(pairs, 
+                           PAIR_ARRAY_SIZE, 
+                           sizeof(key_index_pair), 
+                           key_index_pair_cmp);
+    
+    bool stable = is_stably_sorted(pairs, PAIR_ARRAY_SIZE);
+    printf("Stable: %d\n", stable);
+    ASSERT(stable);
+    free(pairs);
+}
+
+static void print_ways(const size_t ways)
+{
+    if (ways == SIZE_MAX)
+    {
+        printf("All ways");
+    }
+    else
+    {
+        printf("%zu ways", ways);
+    }
+}
+
+static void test_stable_sort_k_way()
+{
+    clock_t t;
+    double duration;
+    size_t i, j;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t RUNS = 10 * 1000;
+    const size_t WAYS[] = { 2, 4, 8, 16, SIZE_MAX };
+    
+    int* inputs[2];
+    inputs[0] = get_random_integer_array(ARRAY_SIZE);
+    inputs[1] = get_presorted_integer_array(ARRAY_SIZE, RUNS);
+    
+    puts("--- stable_sort_k_way ---");
+    
+    for (i = 0; i < 2; ++i)
+    {
+        puts(i == 0 ? "- Random array -" : "- Presorted array -");
+        
+        int* expected = copy_integer_array(inputs[i], ARRAY_SIZE);
+        stable_sort(expected, ARRAY_SIZE, sizeof(int), int_cmp);
+        
+        for (j = 0; j < sizeof(WAYS) / sizeof(WAYS[0]); ++j)
+        {
+            int* array = copy_integer_array(inputs[i], ARRAY_SIZE);
+            
+            t = clock();
+            stable_sort_k_way(array, ARRAY_SIZE, sizeof(int), int_cmp, WAYS[j]);
+            duration = (double) clock() - t;
+            
+            bool eq = int_arrays_are_equal(expected, array, ARRAY_SIZE);
+            print_ways(WAYS[j]);
+            printf(" in %f seconds. Arrays equal: %d\n",
+                   duration / CLOCKS_PER_SEC,
+                   eq);
+            ASSERT(eq);
+            free(array);
+        }
+        
+        free(expected);
+        free(inputs[i]);
+    }
+    
+    /** Large records, many runs **********************************************/
+    
+    // Here each merge pass is bound by moving the records rather than by the
+    // comparisons, so fewer passes pay off:
+    const size_t RECORD_SIZE = 256;
+    const size_t RECORD_ARRAY_SIZE = 512 * 1024;
+    const size_t RECORD_RUNS = 4096;
+    
+    char* records = malloc(RECORD_SIZE * RECORD_ARRAY_SIZE);
+    char* expected_records = malloc(RECORD_SIZE * RECORD_ARRAY_SIZE);
+    char* sorted_records = malloc(RECORD_SIZE * RECORD_ARRAY_SIZE);
+    
+    // Each record starts with its key, followed by the payload:
+    for (i = 0; i < RECORD_ARRAY_SIZE; ++i)
+    {
+        const int key = rand();
+        
+        memset(records + i * RECORD_SIZE, (int) i, RECORD_SIZE);
+        memcpy(records + i * RECORD_SIZE, &key, sizeof(int));
+    }
+    
+    for (i = 0; i < RECORD_RUNS; ++i)
+    {
+        const size_t first = RECORD_ARRAY_SIZE * i / RECORD_RUNS;
+        const size_t last = RECORD_ARRAY_SIZE * (i + 1) / RECORD_RUNS;
+        
+        stable_sort(records + first * RECORD_SIZE, 
+                    last - first, 
+                    RECORD_SIZE, 
+                    int_cmp);
+    }
+    
+    puts("- Presorted array of 256-byte records, 4096 runs -");
+    
+    memcpy(expected_records, records, RECORD_SIZE * RECORD_ARRAY_SIZE);
+    
+    t = clock();
+    stable_sort(expected_records, RECORD_ARRAY_SIZE, RECORD_SIZE, int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    for (j = 1; j < sizeof(WAYS) / sizeof(WAYS[0]); ++j)
+    {
+        memcpy(sorted_records, records, RECORD_SIZE * RECORD_ARRAY_SIZE);
+        
+        t = clock();
+        stable_sort_k_way(sorted_records, 
+                          RECORD_ARRAY_SIZE, 
+                          RECORD_SIZE, 
+                          int_cmp, 
+                          WAYS[j]);
+        duration = (double) clock() - t;
+        
+        bool eq = memcmp(expected_records, 
+                         sorted_records, 
+                         RECORD_SIZE * RECORD_ARRAY_SIZE) == 0;
+        print_ways(WAYS[j]);
+        printf(" in %f seconds. Arrays equal: %d\n",
+               duration / CLOCKS_PER_SEC,
+               eq);
+        ASSERT(eq);
+    }
     
-    ASSERT((size_t) list_set(p_list, 5, 100) == 1);
-    ASSERT((size_t) list_get(p_list, 5) == 100);
+    free(records);
+    free(expected_records);
+    free(sorted_records);
     
-    ASSERT(list_size(p_list) == 7);
+    /** Stability *************************************************************/
     
-    ASSERT(list_contains(p_list,  10,  int_eq));
-    ASSERT(list_contains(p_list,  2,   int_eq));
-    ASSERT(list_contains(p_list,  12,  int_eq));
-    ASSERT(list_contains(p_list,  14,  int_eq));
-    ASSERT(list_contains(p_list,  0,   int_eq));
-    ASSERT(list_contains(p_list,  100, int_eq));
-    ASSERT(list_contains(p_list,  11,  int_eq));
-    ASSERT(!list_contains(p_list, 15,  int_eq));
-    ASSERT(!list_contains(p_list, 16,  int_eq));
+    const size_t PAIR_ARRAY_SIZE = 100 * 1000;
+    key_index_pair* pairs = malloc(sizeof(key_index_pair) * PAIR_ARRAY_SIZE);
     
-    ASSERT(list_size(p_list) == 7);
+    for (i = 0; i < PAIR_ARRAY_SIZE; ++i)
+    {
+        pairs[i].key = rand() % 100;
+        pairs[i].index = i;
+    }
     
-    /* <10, 2, 12, 14, 0, 100, 11*/
-    ASSERT(list_remove_at(p_list, 4) == 0);
-    /* <10, 2, 12, 14, 100, 11> */
-    ASSERT((int) list_remove_at(p_list, 4) == 100);
-    /* <10, 2, 12, 14, 11> */
-    ASSERT((int) list_remove_at(p_list, 4) == 11);
-    /* <10, 2, 12, 14> */
-    ASSERT((int) list_remove_at(p_list, 0) == 10);
-    /* <2, 12, 14> */
-    ASSERT(list_remove_at(p_list, 4) == NULL);
-    ASSERT(list_remove_at(p_list, 3) == NULL);
-    /* <2, 12, 14> */
-    ASSERT((int) list_remove_at(p_list, 1) == 12);
-    /* <2, 14> */
-    ASSERT((int) list_remove_at(p_list, 1) == 14);
-    /* <2> */
-    ASSERT((int) list_remove_at(p_list, 0) == 2);
+    stable_sort_k_way(pairs, 
+                      PAIR_ARRAY_SIZE, 
+                      sizeof(key_index_pair), 
+                      key_index_pair_cmp, 
+                      5);
     
-    ASSERT(list_size(p_list) == 0);
+    bool stable = is_stably_sorted(pairs, PAIR_ARRAY_SIZE);
+    printf("Stable: %d\n", stable);
+    ASSERT(stable);
+    free(pairs);
+}
+
+static void test_external_sort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
     
-    for (i = 0; i < 5; ++i) 
+    const size_t ARRAY_SIZE = 2 * 1000 * 1000;
+    const size_t MEMORY_BUDGET = 256 * 1024;
+    const char* INPUT_FILE_NAME = "external_sort_input.bin";
+    const char* OUTPUT_FILE_NAME = "external_sort_output.bin";
+    
+    key_index_pair* pairs1 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    key_index_pair* pairs2 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
     {
-        ASSERT(list_push_front(p_list, 2 * i + 1));
+        pairs1[i].key = rand() % 1000;
+        pairs1[i].index = i;
     }
     
-    ASSERT((int) list_remove_at(p_list, 2) == 5);
-    ASSERT((int) list_pop_front(p_list) == 9);
-    ASSERT((int) list_pop_back(p_list) == 1);
-    ASSERT((int) list_pop_front(p_list) == 7);
-    ASSERT((int) list_pop_back(p_list) == 3);
+    FILE* file = fopen(INPUT_FILE_NAME, "wb");
+    ASSERT(file);
+    ASSERT(fwrite(pairs1, sizeof(key_index_pair), ARRAY_SIZE, file) 
+           == ARRAY_SIZE);
+    fclose(file);
     
-    list_insert(p_list, 0, 1);
-    list_insert(p_list, 0, 2);
+    puts("--- external_sort ---");
+    puts("- Random array of key/index pairs, 256 KiB budget -");
     
-    ASSERT(list_size(p_list) == 2);
-    list_clear(p_list);
-    ASSERT(list_size(p_list) == 0);
-    ASSERT(list_push_front(p_list, 2));
-    ASSERT(list_push_front(p_list, 3));
-    ASSERT(list_push_front(p_list, 4));
-    list_free(p_list);
+    t = clock();
+    stable_sort(pairs1, ARRAY_SIZE, sizeof(key_index_pair), key_index_pair_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    external_sort_status status = external_sort(INPUT_FILE_NAME,
+                                                OUTPUT_FILE_NAME,
+                                                sizeof(key_index_pair),
+                                                key_index_pair_cmp,
+                                                MEMORY_BUDGET);
+    duration = (double) clock() - t;
+    
+    printf("external_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    ASSERT(status == EXTERNAL_SORT_SUCCESS);
+    
+    file = fopen(OUTPUT_FILE_NAME, "rb");
+    ASSERT(file);
+    ASSERT(fread(pairs2, sizeof(key_index_pair), ARRAY_SIZE + 1, file) 
+           == ARRAY_SIZE);
+    fclose(file);
+    
+    bool stable = is_stably_sorted(pairs2, ARRAY_SIZE);
+    bool eq = memcmp(pairs1, pairs2, sizeof(key_index_pair) * ARRAY_SIZE) == 0;
+    printf("Stable: %d\n", stable);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(stable);
+    ASSERT(eq);
+    
+    /** Errors are reported ***************************************************/
+    
+    ASSERT(external_sort(INPUT_FILE_NAME, 
+                         OUTPUT_FILE_NAME, 
+                         sizeof(key_index_pair), 
+                         key_index_pair_cmp, 
+                         2 * sizeof(key_index_pair)) 
+           == EXTERNAL_SORT_BUDGET_TOO_SMALL);
+    ASSERT(external_sort(INPUT_FILE_NAME, 
+                         OUTPUT_FILE_NAME, 
+                         3 * sizeof(key_index_pair), 
+                         key_index_pair_cmp, 
+                         MEMORY_BUDGET) 
+           == EXTERNAL_SORT_INVALID_ARGUMENT);
+    ASSERT(external_sort(INPUT_FILE_NAME, 
+                         "no_such_directory/external_sort_output.bin", 
+                         sizeof(key_index_pair), 
+                         key_index_pair_cmp, 
+                         MEMORY_BUDGET) 
+           == EXTERNAL_SORT_IO_ERROR);
+    
+    /** Sorting a file in place ***********************************************/
+    
+    puts("- In place -");
+    
+    status = external_sort(INPUT_FILE_NAME,
+                           INPUT_FILE_NAME,
+                           sizeof(key_index_pair),
+                           key_index_pair_cmp,
+                           MEMORY_BUDGET);
+    ASSERT(status == EXTERNAL_SORT_SUCCESS);
+    
+    // A failed sort leaves the file as it was:
+    ASSERT(external_sort(INPUT_FILE_NAME, 
+                         INPUT_FILE_NAME, 
+                         3 * sizeof(key_index_pair), 
+                         key_index_pair_cmp, 
+                         MEMORY_BUDGET) 
+           == EXTERNAL_SORT_INVALID_ARGUMENT);
+    
+    memset(pairs2, 0, sizeof(key_index_pair) * ARRAY_SIZE);
+    file = fopen(INPUT_FILE_NAME, "rb");
+    ASSERT(file);
+    ASSERT(fread(pairs2, sizeof(key_index_pair), ARRAY_SIZE + 1, file) 
+           == ARRAY_SIZE);
+    fclose(file);
+    
+    eq = memcmp(pairs1, pairs2, sizeof(key_index_pair) * ARRAY_SIZE) == 0;
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    // No temporary output is left behind:
+    file = fopen("external_sort_input.bin.tmp0", "rb");
+    ASSERT(!file);
+    
+    remove(INPUT_FILE_NAME);
+    remove(OUTPUT_FILE_NAME);
+    free(pairs1);
+    free(pairs2);
 }
 
-static void test_list_performance()
+static void test_partial_stable_sort()
 {
-    list* p_list = list_alloc(10);
-    const int sz = 1000000;
-    
     clock_t t;
-    double duration = 0.0;
-    int i;
-    int j;
-    int a;
-    int b;
-    int tmp;
-    int time_;
-    void* p_element;
+    double duration;
+    size_t i;
     
-    puts("--- PERFORMANCE OF list_t ---");
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t K = 1000;
     
-    time_ = time(NULL);
-    printf("Seed: %d.\n", time_);
-    srand(time_);
+    key_index_pair* pairs1 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    key_index_pair* pairs2 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    key_index_pair* pairs3 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        pairs1[i].key = rand() % (1000 * 1000);
+        pairs1[i].index = i;
+    }
+    
+    memcpy(pairs2, pairs1, sizeof(key_index_pair) * ARRAY_SIZE);
+    memcpy(pairs3, pairs1, sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    puts("--- partial_stable_sort ---");
+    puts("- Random array, first 1000 elements -");
     
     t = clock();
+    stable_sort(pairs1, ARRAY_SIZE, sizeof(key_index_pair), key_index_pair_cmp);
+    duration = (double) clock() - t;
     
-    for (i = 0; i < sz / 2; ++i) 
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    t = clock();
+    partial_stable_sort(pairs2, 
+                        ARRAY_SIZE, 
+                        K, 
+                        sizeof(key_index_pair), 
+                        key_index_pair_cmp);
+    duration = (double) clock() - t;
+    
+    printf("partial_stable_sort in %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    bool eq = memcmp(pairs1, pairs2, sizeof(key_index_pair) * K) == 0;
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    /** Selection *************************************************************/
+    
+    const size_t N = ARRAY_SIZE / 2;
+    
+    t = clock();
+    select_nth(pairs3, ARRAY_SIZE, N, sizeof(key_index_pair), 
+               key_index_pair_cmp);
+    duration = (double) clock() - t;
+    
+    printf("select_nth in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    bool partitioned = pairs3[N].key == pairs1[N].key;
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
     {
-        ASSERT(list_push_front(p_list, sz / 2 - i - 1));
+        if ((i < N && pairs3[i].key > pairs3[N].key) 
+                || (i > N && pairs3[i].key < pairs3[N].key))
+        {
+            partitioned = false;
+        }
     }
     
-    for (i = sz / 2; i < sz; ++i) 
+    printf("Partitioned: %d\n", partitioned);
+    ASSERT(partitioned);
+    
+    free(pairs1);
+    free(pairs2);
+    free(pairs3);
+}
+
+static int string_cmp(const void* a, const void* b)
+{
+    return strcmp(*(const char**) a, *(const char**) b);
+}
+
+static void test_string_sort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t ARRAY_SIZE = 1000 * 1000;
+    const size_t STRING_CAPACITY = 64;
+    
+    char* storage = malloc(ARRAY_SIZE * STRING_CAPACITY);
+    const char** strings1 = malloc(sizeof(char*) * ARRAY_SIZE);
+    const char** strings2 = malloc(sizeof(char*) * ARRAY_SIZE);
+    
+    // Keys with long common prefixes, like paths or URLs:
+    for (i = 0; i < ARRAY_SIZE; ++i)
     {
-        ASSERT(list_push_back(p_list, i));
+        char* string = storage + i * STRING_CAPACITY;
+        
+        sprintf(string, 
+                "https://www.example.com/users/%d/items/%d", 
+                rand() % 1000, 
+                rand() % 100000);
+        strings1[i] = string;
     }
     
-    duration += ((double) clock() - t);
+    memcpy(strings2, strings1, sizeof(char*) * ARRAY_SIZE);
+    
+    puts("--- string_sort ---");
+    puts("- Random URLs -");
+    
+    t = clock();
+    stable_sort(strings1, ARRAY_SIZE, sizeof(char*), string_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
     
     t = clock();
+    string_sort(strings2, ARRAY_SIZE);
+    duration = (double) clock() - t;
+    
+    printf("string_sort in %f seconds.\n", duration / CLOCKS_PER_SEC);
+    
+    // Equal strings are distinct pointers, so this checks the stability too:
+    bool eq = memcmp(strings1, strings2, sizeof(char*) * ARRAY_SIZE) == 0;
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(strings1);
+    free(strings2);
+    free(storage);
+}
 
-    for (i = 0; i < sz; ++i) 
+static void test_segmented_stable_sort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t SEGMENTS = 200 * 1000;
+    const size_t MINIMUM_SEGMENT_LENGTH = 5;
+    const size_t MAXIMUM_SEGMENT_LENGTH = 100;
+    const size_t THREADS = 4;
+    
+    size_t* offsets = malloc(sizeof(size_t) * (SEGMENTS + 1));
+    offsets[0] = 0;
+    
+    for (i = 0; i < SEGMENTS; ++i)
     {
-        ASSERT((int) list_get(p_list, i) == i);
+        offsets[i + 1] = offsets[i] 
+                       + MINIMUM_SEGMENT_LENGTH 
+                       + rand() % (MAXIMUM_SEGMENT_LENGTH 
+                                   - MINIMUM_SEGMENT_LENGTH + 1);
     }
     
-    duration += ((double) clock() - t);
+    const size_t ARRAY_SIZE = offsets[SEGMENTS];
+    
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    int* array3 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- segmented_stable_sort ---");
+    puts("- 200000 random segments of 5 to 100 elements -");
     
     t = clock();
     
-    for (i = 0; i < sz; ++i)
+    for (i = 0; i < SEGMENTS; ++i)
     {
-        ASSERT((int) list_pop_front(p_list) == i);
+        stable_sort(array1 + offsets[i], 
+                    offsets[i + 1] - offsets[i], 
+                    sizeof(int), 
+                    int_cmp);
     }
     
-    duration += ((double) clock() - t);
+    duration = (double) clock() - t;
+    printf("stable_sort per segment in %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
     
-    printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);        
+    t = clock();
+    segmented_stable_sort(array2, offsets, SEGMENTS, sizeof(int), int_cmp, 1);
+    duration = (double) clock() - t;
+    
+    printf("segmented_stable_sort in %f seconds.\n", 
+           duration / CLOCKS_PER_SEC);
+    
+    double start = wall_clock_seconds();
+    segmented_stable_sort(array3, 
+                          offsets, 
+                          SEGMENTS, 
+                          sizeof(int), 
+                          int_cmp, 
+                          THREADS);
+    
+    printf("segmented_stable_sort with %zu threads in %f seconds.\n", 
+           THREADS,
+           wall_clock_seconds() - start);
+    
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE)
+           && int_arrays_are_equal(array1, array3, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(offsets);
+    free(array1);
+    free(array2);
+    free(array3);
 }
 
-static void test_fibonacci_heap_correctness() 
+static void test_parallel_stable_sort()
 {
-    fibonacci_heap* p_heap;
+    double t;
+    double duration;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t THREADS = 4;
+    
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- parallel_stable_sort ---");
+    puts("- Random array -");
+    
+    t = wall_clock_seconds();
+    stable_sort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = wall_clock_seconds() - t;
+    
+    printf("stable_sort in %f seconds. Sorted: %d.\n", 
+           duration,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    t = wall_clock_seconds();
+    parallel_stable_sort(array2, ARRAY_SIZE, sizeof(int), int_cmp, THREADS);
+    duration = wall_clock_seconds() - t;
+    
+    printf("parallel_stable_sort in %f seconds. Sorted: %d.\n", 
+           duration,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
+    
+    free(array1);
+    free(array2);
+    
+    /** Stability on an array with many equal keys ****************************/
+    
+    puts("- Stability -");
+    
     size_t i;
-    p_heap = fibonacci_heap_alloc(10, 
-                                    1.0f, 
-                                    hash_function, 
-                                    equals_function, 
-                                    priority_cmp);
+    int* keys = get_random_integer_array(ARRAY_SIZE);
+    key_index_pair* pairs1 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    key_index_pair* pairs2 = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        pairs1[i].key   = keys[i] % 1000;
+        pairs1[i].index = i;
+    }
+    
+    memcpy(pairs2, pairs1, sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    stable_sort(pairs1, ARRAY_SIZE, sizeof(key_index_pair), key_index_pair_cmp);
+    parallel_stable_sort(pairs2, 
+                         ARRAY_SIZE, 
+                         sizeof(key_index_pair), 
+                         key_index_pair_cmp, 
+                         THREADS);
+    
+    eq = memcmp(pairs1, pairs2, sizeof(key_index_pair) * ARRAY_SIZE) == 0;
+    printf("Stable: %d\n", 
+           is_stably_sorted(pairs2, ARRAY_SIZE) && eq);
+    ASSERT(eq);
+    ASSERT(is_stably_sorted(pairs2, ARRAY_SIZE));
+    
+    free(keys);
+    free(pairs1);
+    free(pairs2);
+    
+    /** More threads than there are chunks ************************************/
+    
+    puts("- SIZE_MAX threads -");
+    
+    const size_t SMALL_SIZES[] = { 40000, 200000 };
+    
+    for (i = 0; i < sizeof(SMALL_SIZES) / sizeof(SMALL_SIZES[0]); ++i)
+    {
+        array1 = get_random_integer_array(SMALL_SIZES[i]);
+        array2 = copy_integer_array(array1, SMALL_SIZES[i]);
+        
+        stable_sort(array1, SMALL_SIZES[i], sizeof(int), int_cmp);
+        parallel_stable_sort(array2, 
+                             SMALL_SIZES[i], 
+                             sizeof(int), 
+                             int_cmp, 
+                             SIZE_MAX);
+        
+        eq = int_arrays_are_equal(array1, array2, SMALL_SIZES[i]);
+        printf("%zu elements, arrays equal: %d\n", SMALL_SIZES[i], eq);
+        ASSERT(eq);
+        
+        free(array1);
+        free(array2);
+    }
+}
+
+static void test_integer_sort()
+{
+    clock_t t;
+    double duration;
+    size_t i;
+    
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
+    {
+        array1[i] -= RAND_MAX / 2;
+    }
+    
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    
+    puts("--- integer_sort ---");
+    puts("- Random array -");
+    
+    t = clock();
+    stable_sort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
+    duration = (double) clock() - t;
+    
+    printf("stable_sort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    t = clock();
+    integer_sort(array2, ARRAY_SIZE, sizeof(int), 0, sizeof(int), true);
+    duration = (double) clock() - t;
+    
+    printf("integer_sort in %f seconds. Sorted: %d.\n", 
+           duration / CLOCKS_PER_SEC,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+    
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
     
-    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    free(array1);
+    free(array2);
     
-    for (i = 0; i < 30; ++i) 
-    {
-        ASSERT(fibonacci_heap_add(p_heap, i, 30 - i));
-    }
+    /** Stability on an array with many equal keys ****************************/
     
-    for (i = 0; i < 30; ++i)
-    {
-        ASSERT(!fibonacci_heap_add(p_heap, i, i));
-    }
+    puts("- Stability -");
     
-    ASSERT(fibonacci_heap_size(p_heap) == 30);
+    int* keys = get_random_integer_array(ARRAY_SIZE);
+    key_index_pair* pairs = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
     
-    for (i = 0; i < 30; ++i) 
+    for (i = 0; i < ARRAY_SIZE; ++i)
     {
-        ASSERT(fibonacci_heap_contains_key(p_heap, i));
+        pairs[i].key   = keys[i] % 1000;
+        pairs[i].index = i;
     }
     
-    for (i = 30; i < 40; ++i) 
-    {
-        ASSERT(fibonacci_heap_contains_key(p_heap, i) == false);
-    }
+    t = clock();
+    integer_sort(pairs, 
+                 ARRAY_SIZE, 
+                 sizeof(key_index_pair), 
+                 offsetof(key_index_pair, key),
+                 sizeof(int),
+                 true);
+    duration = (double) clock() - t;
     
-    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    eq = is_stably_sorted(pairs, ARRAY_SIZE);
+    printf("integer_sort in %f seconds. Stable: %d\n", 
+           duration / CLOCKS_PER_SEC, 
+           eq);
+    ASSERT(eq);
     
-    for (i = 29; i != (size_t) -1; --i) 
-    {
-        ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == i);
-    }
+    free(keys);
+    free(pairs);
+}
+
+static void test_parallel_integer_sort()
+{
+    double t;
+    double duration;
+    size_t i;
     
-    ASSERT(fibonacci_heap_size(p_heap) == 0);
-    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
+    const size_t THREADS = 4;
     
-    for (i = 10; i < 100; ++i) 
+    int* array1 = get_random_integer_array(ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
     {
-        ASSERT(fibonacci_heap_add(p_heap, i, i));
+        array1[i] -= RAND_MAX / 2;
     }
     
-    ASSERT(fibonacci_heap_decrease_key(p_heap, 50, 0));
+    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
     
-    ASSERT((size_t) fibonacci_heap_min(p_heap) == 50);
-    ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == 50);
+    puts("--- parallel_integer_sort ---");
+    puts("- Random array -");
     
-    for (i = 10; i < 50; ++i) 
-    {
-        ASSERT((size_t) fibonacci_heap_min(p_heap) == i);
-        ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == i);
-    }
+    t = wall_clock_seconds();
+    integer_sort(array1, ARRAY_SIZE, sizeof(int), 0, sizeof(int), true);
+    duration = wall_clock_seconds() - t;
     
-    for (i = 51; i < 100; ++i) 
-    {
-        ASSERT((size_t) fibonacci_heap_min(p_heap) == i);
-        ASSERT((size_t) fibonacci_heap_extract_min(p_heap) == i);
-    }
+    printf("integer_sort in %f seconds. Sorted: %d.\n", 
+           duration,
+           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
     
-    ASSERT(fibonacci_heap_min(p_heap) == NULL);
-    ASSERT(fibonacci_heap_extract_min(p_heap) == NULL);
+    t = wall_clock_seconds();
+    parallel_integer_sort(array2, 
+                          ARRAY_SIZE, 
+                          sizeof(int), 
+                          0, 
+                          sizeof(int), 
+                          true, 
+                          THREADS);
+    duration = wall_clock_seconds() - t;
+    
+    printf("parallel_integer_sort in %f seconds. Sorted: %d.\n", 
+           duration,
+           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
     
-    for (i = 20; i < 40; ++i) 
-    {
-        ASSERT(fibonacci_heap_add(p_heap, i, i));
-    }
+    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
+    printf("Arrays equal: %d\n", eq);
+    ASSERT(eq);
     
-    ASSERT(fibonacci_heap_size(p_heap) == 20);
+    free(array1);
+    free(array2);
     
-    fibonacci_heap_clear(p_heap);
+    /** Stability on an array with many equal keys ****************************/
     
-    ASSERT(fibonacci_heap_size(p_heap) == 0);
-    ASSERT(fibonacci_heap_is_healthy(p_heap));
+    puts("- Stability -");
     
-    for (i = 0; i < 100; ++i) 
+    int* keys = get_random_integer_array(ARRAY_SIZE);
+    key_index_pair* pairs = malloc(sizeof(key_index_pair) * ARRAY_SIZE);
+    
+    for (i = 0; i < ARRAY_SIZE; ++i)
     {
-        ASSERT(fibonacci_heap_contains_key(p_heap, i) == false);
+        pairs[i].key   = keys[i] % 1000;
+        pairs[i].index = i;
     }
     
-    ASSERT(fibonacci_heap_add(p_heap, 2, 2));
-    ASSERT(fibonacci_heap_add(p_heap, 3, 3));
-    fibonacci_heap_free(p_heap);
-}
-
-static void test_fibonacci_heap_performance()
-{
-    fibonacci_heap* p_heap;
-    size_t i;
-    clock_t t;
-    const size_t sz = 1000000;
-    double duration;
+    parallel_integer_sort(pairs, 
+                          ARRAY_SIZE, 
+                          sizeof(key_index_pair), 
+                          offsetof(key_index_pair, key),
+                          sizeof(int),
+                          true,
+                          THREADS);
     
-    puts("--- PERFORMANCE OF fibonacci_heap_t ---");
+    eq = is_stably_sorted(pairs, ARRAY_SIZE);
+    printf("Stable: %d\n", eq);
+    ASSERT(eq);
     
-    duration = 0.0;
-    p_heap = fibonacci_heap_alloc(10,
-                                    1.0f,
-                                    hash_function,
-                                    equals_function,
-                                    priority_cmp);
-    t = clock();
-
-    for (i = 0; i < sz; ++i) 
-    {
-        fibonacci_heap_add(p_heap, i, 500000 + sz - i);
-    }
-
-    /* State: 999999, 999998, 999997, ... */
-    ASSERT(fibonacci_heap_is_healthy(p_heap));
-
-    for (i = sz / 2; i < sz; ++i)
-    {
-        fibonacci_heap_decrease_key(p_heap, i, i);
-    }
-
-    ASSERT(fibonacci_heap_is_healthy(p_heap));
-
-    for (i = 0; i < sz; ++i)
-    {
-        fibonacci_heap_extract_min(p_heap);
-    }
-
-    duration += ((double) clock() - t);
-
-    fibonacci_heap_free(p_heap);
-
-    printf("Duration: %f seconds.\n", duration / CLOCKS_PER_SEC);
+    free(keys);
+    free(pairs);
 }
 
-static bool is_sorted(void* base,
-                      size_t num, 
-                      size_t size, 
-                      int (*cmp)(const void*, const void*))
+typedef struct concurrent_map_task {
+    concurrent_unordered_map* map;
+    unordered_map*            locked_map; /* Used with 'lock' if not NULL. */
+    mtx_t*                    lock;
+    size_t                    first_key;
+    size_t                    key_count;
+    size_t                    operations;
+    size_t                    key_range;
+    unsigned                  seed;
+} concurrent_map_task;
+
+static int put_key_range(void* arg)
 {
+    concurrent_map_task* task = arg;
     size_t i;
     
-    for (i = 0; i < num - 1; ++i) 
+    for (i = task->first_key; i < task->first_key + task->key_count; ++i)
     {
-        if (cmp(((char*) base) + size * i, ((char*) base) + size * (i + 1)) > 0) 
-        {
-            return false;
-        }
+        concurrent_unordered_map_put(task->map, (void*) i, (void*)(i + 1));
+        concurrent_unordered_map_compute(task->map, 
+                                         (void*)(i % 1000 + 1000000000), 
+                                         increment_count, 
+                                         NULL);
     }
     
-    return true;
+    return 0;
 }
 
-static bool int_arrays_are_equal(int* arr1, int* arr2, size_t num)
+static int remove_odd_keys(void* arg)
 {
+    concurrent_map_task* task = arg;
     size_t i;
     
-    for (i = 0; i < num; ++i) 
+    for (i = task->first_key; i < task->first_key + task->key_count; ++i)
     {
-        if (arr1[i] != arr2[i])
+        if (i % 2 == 1)
         {
-            return false;
+            concurrent_unordered_map_remove(task->map, (void*) i);
         }
     }
     
-    return true;
+    return 0;
 }
 
-static int* alloc_int_array(size_t size)
+/* The finalizer of SplitMix64. 'hash_function' gives a dense key range one key 
+   per bucket, which hides the cost of collisions in the benchmark. */
+static size_t mixing_hash_function(void* v)
 {
-    return malloc(sizeof(int) * size);
+    uint64_t z = (uint64_t)(size_t) v;
+    
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return (size_t)(z ^ (z >> 31));
 }
 
-static int* get_random_integer_array(size_t size)
+/* 90% lookups, 5% insertions and 5% removals over random keys. */
+static int run_mixed_operations(void* arg)
 {
+    concurrent_map_task* task = arg;
+    unsigned x = task->seed;
     size_t i;
-    int* array = alloc_int_array(size);
+    size_t key;
+    unsigned op;
     
-    srand(time(NULL));
-    
-    for (i = 0; i < size; ++i) 
+    for (i = 0; i < task->operations; ++i)
     {
-        array[i] = rand();
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        key = x % task->key_range;
+        op  = (x >> 24) % 20;
+        
+        if (task->locked_map)
+        {
+            mtx_lock(task->lock);
+            
+            if (op == 0)
+                unordered_map_put(task->locked_map, (void*) key, (void*) 1);
+            else if (op == 1)
+                unordered_map_remove(task->locked_map, (void*) key);
+            else
+                unordered_map_get(task->locked_map, (void*) key);
+            
+            mtx_unlock(task->lock);
+        }
+        else
+        {
+            if (op == 0)
+                concurrent_unordered_map_put(task->map, (void*) key, (void*) 1);
+            else if (op == 1)
+                concurrent_unordered_map_remove(task->map, (void*) key);
+            else
+                concurrent_unordered_map_get(task->map, (void*) key);
+        }
     }
     
-    return array;
+    return 0;
 }
 
-static int* get_presorted_integer_array(size_t num, size_t run_length)
+static void run_tasks(int (*function)(void*), 
+                      concurrent_map_task* tasks, 
+                      size_t threads)
 {
-    size_t i;
-    int* array = malloc(sizeof(int) * num);
+    thrd_t handles[64];
+    size_t t;
     
-    for (i = 0; i < num; ++i) 
+    for (t = 0; t < threads; ++t)
     {
-        array[i] = run_length - i % run_length;
+        ASSERT(thrd_create(&handles[t], function, &tasks[t]) == thrd_success);
     }
     
-    return array;
+    for (t = 0; t < threads; ++t)
+    {
+        thrd_join(handles[t], NULL);
+    }
 }
 
-static int* copy_integer_array(int* array, size_t num)
+static void count_mapping(void* key, void* value, void* context)
 {
-    int* copy = alloc_int_array(num);
-    memcpy(copy, array, sizeof(int) * num);
-    return copy;
+    (void) key;
+    (void) value;
+    ++*(size_t*) context;
 }
 
-static void test_stable_sort() 
+static void test_concurrent_unordered_map_correctness()
 {
-    clock_t t;
-    double duration;
+    const size_t THREADS = 8;
+    const size_t KEYS_PER_THREAD = 50000;
+    const size_t BATCH_SIZE = 100000;
+    concurrent_unordered_map* p_map = 
+            concurrent_unordered_map_alloc(0, 
+                                           0.75f, 
+                                           16, 
+                                           hash_function, 
+                                           equals_function);
+    concurrent_map_task tasks[8];
+    void** keys;
+    void** values;
+    size_t bucket_count;
+    size_t count = 0;
+    size_t i;
+    size_t t;
+    bool ok = true;
     
-    const size_t ARRAY_SIZE = 10 * 1000 * 1000;
-    const size_t RUNS = 4;
+    puts("--- concurrent_unordered_map correctness ---");
     
-    int* array1 = get_presorted_integer_array(ARRAY_SIZE, RUNS);
-    int* array2 = copy_integer_array(array1, ARRAY_SIZE);
+    for (t = 0; t < THREADS; ++t)
+    {
+        tasks[t].map       = p_map;
+        tasks[t].first_key = t * KEYS_PER_THREAD;
+        tasks[t].key_count = KEYS_PER_THREAD;
+    }
     
-    puts("--- stable_sort ---");
-    puts("- Presorted array -");
+    /* Each thread inserts its own keys and bumps 1000 shared counters. */
+    run_tasks(put_key_range, tasks, THREADS);
     
-    t = clock();
-    qsort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
-    duration = (double) clock() - t;
+    ASSERT(concurrent_unordered_map_size(p_map) == 
+           THREADS * KEYS_PER_THREAD + 1000);
+    ASSERT(concurrent_unordered_map_is_healthy(p_map));
     
-    printf("qsort in %f seconds. Sorted: %d.\n", 
-           duration / CLOCKS_PER_SEC,
-           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    for (i = 0; i < THREADS * KEYS_PER_THREAD; ++i)
+    {
+        ok &= concurrent_unordered_map_get(p_map, (void*) i) == (void*)(i + 1);
+    }
     
-    t = clock();
-    stable_sort(array2, ARRAY_SIZE, sizeof(int), int_cmp);
-    duration = (double) clock() - t;
+    for (i = 0; i < 1000; ++i)
+    {
+        ok &= (size_t) concurrent_unordered_map_get(p_map, 
+                                                    (void*)(i + 1000000000)) 
+              == THREADS * KEYS_PER_THREAD / 1000;
+    }
     
-    printf("stable_sort in %f seconds. Sorted: %d.\n", 
-           duration / CLOCKS_PER_SEC,
-           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
-       
-    bool eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
-    printf("Arrays equal: %d\n", eq);
-    ASSERT(eq);
+    ASSERT(ok);
     
-    /** Profiling on random integer array *************************************/
+    run_tasks(remove_odd_keys, tasks, THREADS);
     
-    puts("- Random array -");
+    ASSERT(concurrent_unordered_map_size(p_map) == 
+           THREADS * KEYS_PER_THREAD / 2 + 1000);
+    ASSERT(concurrent_unordered_map_is_healthy(p_map));
     
-    array1 = get_random_integer_array(ARRAY_SIZE);
-    array2 = copy_integer_array(array1, ARRAY_SIZE);
+    for (i = 0; i < THREADS * KEYS_PER_THREAD; ++i)
+    {
+        ok &= concurrent_unordered_map_contains_key(p_map, (void*) i) 
+              == (i % 2 == 0);
+    }
     
-    t = clock();
-    qsort(array1, ARRAY_SIZE, sizeof(int), int_cmp);
-    duration = (double) clock() - t;
+    ASSERT(ok);
     
-    printf("qsort in %f seconds. Sorted: %d.\n", 
-           duration / CLOCKS_PER_SEC,
-           is_sorted(array1, ARRAY_SIZE, sizeof(int), int_cmp));
+    ASSERT(concurrent_unordered_map_for_each(p_map, count_mapping, &count));
+    ASSERT(count == concurrent_unordered_map_size(p_map));
     
-    t = clock();
-    stable_sort(array2, ARRAY_SIZE, sizeof(int), int_cmp);
-    duration = (double) clock() - t;
+    /* Removing half of the keys leaves every stripe with room to spare. */
+    bucket_count = concurrent_unordered_map_bucket_count(p_map);
+    ASSERT(concurrent_unordered_map_shrink_to_fit(p_map));
+    ASSERT(concurrent_unordered_map_bucket_count(p_map) < bucket_count);
+    ASSERT(concurrent_unordered_map_is_healthy(p_map));
     
-    printf("stable_sort in %f seconds. Sorted: %d.\n", 
-           duration / CLOCKS_PER_SEC,
-           is_sorted(array2, ARRAY_SIZE, sizeof(int), int_cmp));
+    concurrent_unordered_map_clear(p_map);
     
-    eq = int_arrays_are_equal(array1, array2, ARRAY_SIZE);
-    printf("Arrays equal: %d\n", eq);
-    ASSERT(eq);
+    ASSERT(concurrent_unordered_map_size(p_map) == 0);
+    ASSERT(concurrent_unordered_map_is_healthy(p_map));
+    
+    concurrent_unordered_map_free(p_map);
+    
+    /* The batch operations, on a single stripe and on many. */
+    keys   = malloc(sizeof(void*) * BATCH_SIZE);
+    values = malloc(sizeof(void*) * BATCH_SIZE);
+    
+    for (i = 0; i < BATCH_SIZE; ++i)
+    {
+        keys[i]   = (void*)(i * 7);
+        values[i] = (void*)(i + 1);
+    }
+    
+    for (t = 1; t <= 64; t *= 64)
+    {
+        p_map = concurrent_unordered_map_alloc(0, 
+                                               0.75f, 
+                                               t, 
+                                               hash_function, 
+                                               equals_function);
+        concurrent_unordered_map_set_incremental_rehash(p_map, 2);
+        concurrent_unordered_map_set_low_water_mark(p_map, 0.1f);
+        
+        ASSERT(concurrent_unordered_map_reserve(p_map, BATCH_SIZE / 2));
+        ASSERT(concurrent_unordered_map_put_all(p_map, 
+                                                keys, 
+                                                values, 
+                                                BATCH_SIZE / 2));
+        ASSERT(!concurrent_unordered_map_put_all(p_map, 
+                                                 keys, 
+                                                 values, 
+                                                 SIZE_MAX));
+        ASSERT(concurrent_unordered_map_size(p_map) == BATCH_SIZE / 2);
+        
+        concurrent_unordered_map_get_batch(p_map, keys, BATCH_SIZE, values);
+        
+        for (i = 0; i < BATCH_SIZE; ++i)
+        {
+            ok &= values[i] == (i < BATCH_SIZE / 2 ? (void*)(i + 1) : NULL);
+        }
+        
+        ASSERT(ok);
+        ASSERT(concurrent_unordered_map_is_healthy(p_map));
+        
+        concurrent_unordered_map_free(p_map);
+    }
+    
+    free(keys);
+    free(values);
+}
+
+static void test_concurrent_unordered_map_performance()
+{
+    const size_t TOTAL_OPERATIONS = 2000000;
+    const size_t KEY_RANGE = 1 << 16;
+    concurrent_unordered_map* p_map = 
+            concurrent_unordered_map_alloc(0, 
+                                           0.75f, 
+                                           0, 
+                                           mixing_hash_function, 
+                                           equals_function);
+    unordered_map* p_locked_map = unordered_map_alloc(0, 
+                                                      0.75f, 
+                                                      mixing_hash_function, 
+                                                      equals_function);
+    concurrent_map_task tasks[64];
+    mtx_t lock;
+    double t;
+    double duration1;
+    double duration2;
+    size_t threads;
+    size_t i;
+    
+    puts("--- concurrent_unordered_map VS. unordered_map with one mutex ---");
+    
+    mtx_init(&lock, mtx_plain);
+    
+    for (i = 0; i < KEY_RANGE; i += 2)
+    {
+        concurrent_unordered_map_put(p_map, (void*) i, (void*) 1);
+        unordered_map_put(p_locked_map, (void*) i, (void*) 1);
+    }
+    
+    for (threads = 1; threads <= 64; threads *= 2)
+    {
+        for (i = 0; i < threads; ++i)
+        {
+            tasks[i].map        = p_map;
+            tasks[i].locked_map = NULL;
+            tasks[i].lock       = &lock;
+            tasks[i].operations = TOTAL_OPERATIONS / threads;
+            tasks[i].key_range  = KEY_RANGE;
+            tasks[i].seed       = (unsigned) i * 2654435761u + 1;
+        }
+        
+        t = wall_clock_seconds();
+        run_tasks(run_mixed_operations, tasks, threads);
+        duration1 = wall_clock_seconds() - t;
+        
+        for (i = 0; i < threads; ++i)
+        {
+            tasks[i].locked_map = p_locked_map;
+        }
+        
+        t = wall_clock_seconds();
+        run_tasks(run_mixed_operations, tasks, threads);
+        duration2 = wall_clock_seconds() - t;
+        
+        printf("%2zu threads: striped %6.2f Mops/s, one mutex %6.2f Mops/s.\n",
+               threads,
+               TOTAL_OPERATIONS / duration1 / 1e6,
+               TOTAL_OPERATIONS / duration2 / 1e6);
+    }
+    
+    ASSERT(concurrent_unordered_map_is_healthy(p_map));
+    ASSERT(unordered_map_is_healthy(p_locked_map));
+    
+    mtx_destroy(&lock);
+    concurrent_unordered_map_free(p_map);
+    unordered_map_free(p_locked_map);
 }
 
 int main(int argc, char** argv) {
@@ -1328,6 +4221,19 @@ int main(int argc, char** argv) {
     
     test_unordered_map_correctness();
     test_unordered_map_performance();
+    test_unordered_map_incremental_rehash();
+    test_unordered_map_put_all();
+    test_unordered_map_get_batch();
+    test_unordered_map_get_or_insert();
+    test_unordered_map_shrink();
+    test_unordered_map_cached_hashes();
+    test_unordered_map_entry_reuse();
+    
+    test_flat_unordered_map_correctness();
+    test_flat_unordered_map_performance();
+    
+    test_concurrent_unordered_map_correctness();
+    test_concurrent_unordered_map_performance();
     
     test_unordered_set_correctness();
     test_unordered_set_performance();
@@ -1345,5 +4251,20 @@ int main(int argc, char** argv) {
     test_fibonacci_heap_performance();
     
     test_stable_sort();
+    test_stable_sort_wide_records();
+    test_stable_sort_with_buffer();
+    test_typed_stable_sort();
+    test_primitive_sort();
+    test_primitive_sort_edge_cases();
+    test_stable_argsort();
+    test_stable_sort_low_memory();
+    test_stable_sort_k_way();
+    test_external_sort();
+    test_partial_stable_sort();
+    test_string_sort();
+    test_segmented_stable_sort();
+    test_parallel_stable_sort();
+    test_integer_sort();
+    test_parallel_integer_sort();
     return (EXIT_SUCCESS);
 }
@@ -35,13 +35,24 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/concurrent_unordered_map.o \
+	${OBJECTDIR}/external_sort.o \
 	${OBJECTDIR}/fibonacci_heap.o \
+	${OBJECTDIR}/flat_unordered_map.o \
 	${OBJECTDIR}/heap.o \
+	${OBJECTDIR}/integer_sort.o \
 	${OBJECTDIR}/list.o \
 	${OBJECTDIR}/main.o \
 	${OBJECTDIR}/map.o \
+	${OBJECTDIR}/parallel_integer_sort.o \
+	${OBJECTDIR}/parallel_stable_sort.o \
+	${OBJECTDIR}/partial_sort.o \
+	${OBJECTDIR}/primitive_sort.o \
+	${OBJECTDIR}/segmented_sort.o \
 	${OBJECTDIR}/set.o \
+	${OBJECTDIR}/sort_utils.o \
 	${OBJECTDIR}/stable_sort.o \
+	${OBJECTDIR}/string_sort.o \
 	${OBJECTDIR}/unordered_map.o \
 	${OBJECTDIR}/unordered_set.o
 
@@ -70,16 +81,36 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/crtreemap: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
 	${LINK.c} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/crtreemap ${OBJECTFILES} ${LDLIBSOPTIONS}
 
+${OBJECTDIR}/concurrent_unordered_map.o: concurrent_unordered_map.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/concurrent_unordered_map.o concurrent_unordered_map.c
+
+${OBJECTDIR}/external_sort.o: external_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/external_sort.o external_sort.c
+
 ${OBJECTDIR}/fibonacci_heap.o: fibonacci_heap.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/fibonacci_heap.o fibonacci_heap.c
 
+${OBJECTDIR}/flat_unordered_map.o: flat_unordered_map.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/flat_unordered_map.o flat_unordered_map.c
+
 ${OBJECTDIR}/heap.o: heap.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/heap.o heap.c
 
+${OBJECTDIR}/integer_sort.o: integer_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/integer_sort.o integer_sort.c
+
 ${OBJECTDIR}/list.o: list.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -95,16 +126,51 @@ ${OBJECTDIR}/map.o: map.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/map.o map.c
 
+${OBJECTDIR}/parallel_integer_sort.o: parallel_integer_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/parallel_integer_sort.o parallel_integer_sort.c
+
+${OBJECTDIR}/parallel_stable_sort.o: parallel_stable_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/parallel_stable_sort.o parallel_stable_sort.c
+
+${OBJECTDIR}/partial_sort.o: partial_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/partial_sort.o partial_sort.c
+
+${OBJECTDIR}/primitive_sort.o: primitive_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/primitive_sort.o primitive_sort.c
+
+${OBJECTDIR}/segmented_sort.o: segmented_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/segmented_sort.o segmented_sort.c
+
 ${OBJECTDIR}/set.o: set.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/set.o set.c
 
+${OBJECTDIR}/sort_utils.o: sort_utils.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sort_utils.o sort_utils.c
+
 ${OBJECTDIR}/stable_sort.o: stable_sort.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/stable_sort.o stable_sort.c
 
+${OBJECTDIR}/string_sort.o: string_sort.c 
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/string_sort.o string_sort.c
+
 ${OBJECTDIR}/unordered_map.o: unordered_map.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
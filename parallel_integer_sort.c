@@ -0,0 +1,304 @@
+#include "parallel_integer_sort.h"
+#include "integer_sort.h"
+#include "sort_utils.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXIMUM_KEY_SIZE 8
+#define BUCKETS (UCHAR_MAX + 1)
+
+// Chunks shorter than this are not worth a thread of their own:
+static const size_t MINIMUM_CHUNK_LENGTH = 1 << 16;
+
+// The number of bytes each thread buffers per bucket before writing them out:
+static const size_t WRITE_COMBINING_BYTES = 256;
+
+typedef struct radix_task
+{
+    const char* source;
+    char* target;
+    size_t num;
+    size_t size;
+    size_t key_offset;
+    size_t key_size;
+    size_t digit_offset;
+    size_t histograms[MAXIMUM_KEY_SIZE][BUCKETS];
+    size_t bucket_offsets[BUCKETS];
+    size_t write_counts[BUCKETS];
+    size_t write_buffer_capacity;
+    char* write_buffer;
+}
+radix_task;
+
+static size_t min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+static size_t max(const size_t a, const size_t b)
+{
+    return a > b ? a : b;
+}
+
+static void count_all_digits(void* arg)
+{
+    radix_task* task = arg;
+    const unsigned char* key = (const unsigned char*) task->source
+                             + task->key_offset;
+    const unsigned char* last = key + task->num * task->size;
+    
+    memset(task->histograms, 0, sizeof(task->histograms));
+    
+    for (; key != last; key += task->size)
+    {
+        for (size_t i = 0; i < task->key_size; ++i)
+        {
+            task->histograms[i][key[i]]++;
+        }
+    }
+}
+
+static void count_digit(void* arg)
+{
+    radix_task* task = arg;
+    const unsigned char* digit = (const unsigned char*) task->source
+                               + task->digit_offset;
+    const unsigned char* last = digit + task->num * task->size;
+    size_t* histogram = task->histograms[task->digit_offset - task->key_offset];
+    
+    memset(histogram, 0, sizeof(size_t) * BUCKETS);
+    
+    for (; digit != last; digit += task->size)
+    {
+        histogram[*digit]++;
+    }
+}
+
+static void flush_bucket(radix_task *const task, const size_t bucket)
+{
+    const size_t count = task->write_counts[bucket];
+    const size_t bytes = count * task->size;
+    
+    memcpy(task->target + task->bucket_offsets[bucket] * task->size,
+           task->write_buffer + bucket * task->write_buffer_capacity 
+                                       * task->size,
+           bytes);
+    
+    task->bucket_offsets[bucket] += count;
+    task->write_counts[bucket] = 0;
+}
+
+static void scatter(void* arg)
+{
+    radix_task* task = arg;
+    const size_t size = task->size;
+    const size_t capacity = task->write_buffer_capacity;
+    const char* source = task->source;
+    const char* last = source + task->num * size;
+    
+    memset(task->write_counts, 0, sizeof(task->write_counts));
+    
+    for (; source != last; source += size)
+    {
+        const unsigned char bucket = 
+                (unsigned char) source[task->digit_offset];
+        
+        memcpy(task->write_buffer + (bucket * capacity 
+                                   + task->write_counts[bucket]) * size,
+               source,
+               size);
+        
+        if (++task->write_counts[bucket] == capacity)
+        {
+            flush_bucket(task, bucket);
+        }
+    }
+    
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket)
+    {
+        flush_bucket(task, bucket);
+    }
+}
+
+/*******************************************************************************
+* Assigns each thread its starting index within each bucket. Buckets are laid  *
+* out in ascending digit order (with the sign bit flipped if 'flip_sign' is    *
+* set), and within a bucket the threads are laid out in chunk order, which is  *
+* what keeps the sort stable.                                                  *
+*******************************************************************************/
+static void compute_bucket_offsets(radix_task* tasks,
+                                   const size_t task_count,
+                                   const size_t histogram_index,
+                                   const bool flip_sign)
+{
+    size_t sum = 0;
+    
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        const size_t bucket = flip_sign ? (i ^ (BUCKETS >> 1)) : i;
+        
+        for (size_t t = 0; t < task_count; ++t)
+        {
+            tasks[t].bucket_offsets[bucket] = sum;
+            sum += tasks[t].histograms[histogram_index][bucket];
+        }
+    }
+}
+
+void parallel_integer_sort(void* base,
+                           const size_t num,
+                           const size_t size,
+                           const size_t key_offset,
+                           const size_t key_size,
+                           const bool key_is_signed,
+                           const size_t threads)
+{
+    if (!base || num < 2)
+    {
+        return;
+    }
+    
+    if (key_size == 0
+            || key_size > MAXIMUM_KEY_SIZE 
+            || key_offset + key_size > size)
+    {
+        return;
+    }
+    
+    const size_t chunks = min(threads, num / MINIMUM_CHUNK_LENGTH);
+    
+    if (chunks < 2)
+    {
+        integer_sort(base, num, size, key_offset, key_size, key_is_signed);
+        return;
+    }
+    
+    const bool little_endian = is_little_endian();
+    const size_t write_buffer_capacity = max(1, WRITE_COMBINING_BYTES / size);
+    
+    radix_task* tasks = malloc(sizeof(radix_task) * chunks);
+    char* write_buffers = malloc(chunks * BUCKETS * write_buffer_capacity 
+                                        * size);
+    
+    if (!tasks || !write_buffers)
+    {
+        fputs("Could not allocate memory for the radix sort tasks.\n", stderr);
+        abort();
+    }
+    
+    for (size_t t = 0; t < chunks; ++t)
+    {
+        const size_t first = num * t / chunks;
+        
+        tasks[t].num        = num * (t + 1) / chunks - first;
+        tasks[t].source     = ((char*) base) + first * size;
+        tasks[t].size       = size;
+        tasks[t].key_offset = key_offset;
+        tasks[t].key_size   = key_size;
+        tasks[t].write_buffer_capacity = write_buffer_capacity;
+        tasks[t].write_buffer = write_buffers + t * BUCKETS 
+                                                  * write_buffer_capacity 
+                                                  * size;
+    }
+    
+    // Count all the digits of the original array in one parallel pass:
+    run_in_parallel(tasks,
+                    sizeof(radix_task),
+                    chunks,
+                    count_all_digits,
+                    chunks);
+    
+    size_t totals[MAXIMUM_KEY_SIZE][BUCKETS] = { { 0 } };
+    
+    for (size_t t = 0; t < chunks; ++t)
+    {
+        for (size_t i = 0; i < key_size; ++i)
+        {
+            for (size_t bucket = 0; bucket < BUCKETS; ++bucket)
+            {
+                totals[i][bucket] += tasks[t].histograms[i][bucket];
+            }
+        }
+    }
+    
+    char* buffer = NULL;
+    char* source = base;
+    char* target = NULL;
+    bool counts_are_current = true;
+    
+    for (size_t digit = 0; digit < key_size; ++digit)
+    {
+        const size_t digit_offset = get_digit_offset(key_offset,
+                                                     key_size,
+                                                     digit,
+                                                     little_endian);
+        const size_t histogram_index = digit_offset - key_offset;
+        const unsigned char first_digit = (unsigned char) source[digit_offset];
+        
+        if (totals[histogram_index][first_digit] == num)
+        {
+            // All keys share this digit; the pass would not move anything:
+            continue;
+        }
+        
+        if (!buffer)
+        {
+            buffer = malloc(num * size);
+            
+            if (!buffer)
+            {
+                fputs("Could not allocate memory for the buffer array.\n", 
+                      stderr);
+                abort();
+            }
+            
+            target = buffer;
+        }
+        
+        for (size_t t = 0; t < chunks; ++t)
+        {
+            tasks[t].source = source + (num * t / chunks) * size;
+            tasks[t].target = target;
+            tasks[t].digit_offset = digit_offset;
+        }
+        
+        if (!counts_are_current)
+        {
+            // The previous scatter shuffled the elements between the chunks:
+            run_in_parallel(tasks,
+                            sizeof(radix_task),
+                            chunks,
+                            count_digit,
+                            chunks);
+        }
+        
+        compute_bucket_offsets(tasks,
+                               chunks,
+                               histogram_index,
+                               key_is_signed && digit == key_size - 1);
+        
+        run_in_parallel(tasks,
+                        sizeof(radix_task),
+                        chunks,
+                        scatter,
+                        chunks);
+        counts_are_current = false;
+        
+        // Swap the roles of the arrays:
+        char* tmp = source;
+        source = target;
+        target = tmp;
+    }
+    
+    if (source != base)
+    {
+        memcpy(base, source, num * size);
+    }
+    
+    free(buffer);
+    free(write_buffers);
+    free(tasks);
+}
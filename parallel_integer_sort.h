@@ -0,0 +1,29 @@
+#ifndef PARALLEL_INTEGER_SORT_H
+#define PARALLEL_INTEGER_SORT_H
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Sorts the array just like 'integer_sort', but uses at most 'threads'     *
+    * threads. Each thread counts the digits in its own chunk of the array,    *
+    * after which a global prefix sum assigns every thread a private range     *
+    * within each bucket, so that all threads may scatter concurrently. This   *
+    * sort is stable and produces exactly the same result as 'integer_sort'.   *
+    ***************************************************************************/
+    void parallel_integer_sort(void* base,
+                               const size_t num,
+                               const size_t size,
+                               const size_t key_offset,
+                               const size_t key_size,
+                               const bool key_is_signed,
+                               const size_t threads);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* PARALLEL_INTEGER_SORT_H */
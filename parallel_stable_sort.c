@@ -0,0 +1,336 @@
+#include "parallel_stable_sort.h"
+#include "sort_utils.h"
+#include "stable_sort.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Chunks shorter than this are not worth a thread of their own:
+static const size_t MINIMUM_CHUNK_LENGTH = 1 << 14;
+
+typedef struct sort_task
+{
+    char* base;
+    size_t num;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+    char* scratch;
+    size_t scratch_size;
+}
+sort_task;
+
+typedef struct merge_task
+{
+    const char* left;
+    const char* right;
+    char* target;
+    size_t left_run_length;
+    size_t right_run_length;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+}
+merge_task;
+
+static size_t min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+static size_t max(const size_t a, const size_t b)
+{
+    return a > b ? a : b;
+}
+
+static void run_sort_task(void* arg)
+{
+    sort_task* task = arg;
+    stable_sort_with_buffer(task->base,
+                            task->num,
+                            task->size,
+                            task->cmp,
+                            task->scratch,
+                            task->scratch_size);
+}
+
+static void run_merge_task(void* arg)
+{
+    merge_task* task = arg;
+
+    const char* left  = task->left;
+    const char* right = task->right;
+    const char* left_upper_bound  = left  + task->left_run_length  * task->size;
+    const char* right_upper_bound = right + task->right_run_length * task->size;
+    const size_t size = task->size;
+    char* target = task->target;
+
+    while (left != left_upper_bound && right != right_upper_bound)
+    {
+        if (task->cmp(right, left) < 0)
+        {
+            memcpy(target, right, size);
+            right += size;
+        }
+        else
+        {
+            memcpy(target, left, size);
+            left += size;
+        }
+
+        target += size;
+    }
+
+    memcpy(target, left, left_upper_bound - left);
+    target += left_upper_bound - left;
+    memcpy(target, right, right_upper_bound - right);
+}
+
+/*******************************************************************************
+* Returns the number of elements the left run contributes to the first 'rank'  *
+* elements of the stable merge of the two runs. Ties are resolved in favour of *
+* the left run, just like in the merge routine.                                *
+*******************************************************************************/
+static size_t co_rank(const char* left,
+                      const size_t left_run_length,
+                      const char* right,
+                      const size_t right_run_length,
+                      const size_t rank,
+                      const size_t size,
+                      const int (*cmp)(const void*, const void*))
+{
+    size_t lo = rank > right_run_length ? rank - right_run_length : 0;
+    size_t hi = min(rank, left_run_length);
+
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (cmp(left + mid * size, right + (rank - mid - 1) * size) <= 0)
+        {
+            // left[mid] precedes right[rank - mid - 1], so take more from left:
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*******************************************************************************
+* Splits the merge of two adjacent runs into 'pieces' independent merge tasks  *
+* of roughly equal output length. Returns the number of tasks written.         *
+*******************************************************************************/
+static size_t split_merge(merge_task* tasks,
+                          const char* left,
+                          const size_t left_run_length,
+                          const char* right,
+                          const size_t right_run_length,
+                          char* target,
+                          const size_t pieces,
+                          const size_t size,
+                          const int (*cmp)(const void*, const void*))
+{
+    const size_t total = left_run_length + right_run_length;
+    size_t previous_rank = 0;
+    size_t previous_left = 0;
+
+    for (size_t piece = 0; piece < pieces; ++piece)
+    {
+        const size_t rank = total * (piece + 1) / pieces;
+        const size_t left_count = co_rank(left,
+                                          left_run_length,
+                                          right,
+                                          right_run_length,
+                                          rank,
+                                          size,
+                                          cmp);
+
+        const size_t previous_right = previous_rank - previous_left;
+
+        tasks[piece].left             = left + previous_left * size;
+        tasks[piece].right            = right + previous_right * size;
+        tasks[piece].target           = target + previous_rank * size;
+        tasks[piece].left_run_length  = left_count - previous_left;
+        tasks[piece].right_run_length = rank - left_count - previous_right;
+        tasks[piece].size             = size;
+        tasks[piece].cmp              = cmp;
+
+        previous_rank = rank;
+        previous_left = left_count;
+    }
+
+    return pieces;
+}
+
+void parallel_stable_sort(void* base,
+                          const size_t num,
+                          const size_t size,
+                          const int (*cmp)(const void*, const void*),
+                          const size_t threads)
+{
+    if (!base || !cmp)
+    {
+        return;
+    }
+
+    // Each thread sorts one chunk, and more threads than chunks would only
+    // split the merges into pieces too short to pay for a thread:
+    const size_t chunks = min(threads, num / MINIMUM_CHUNK_LENGTH);
+    const size_t thread_count = chunks;
+
+    if (chunks < 2)
+    {
+        stable_sort(base, num, size, cmp);
+        return;
+    }
+
+    size_t*     bounds = malloc(sizeof(size_t) * (chunks + 1));
+    sort_task*  sort_tasks  = malloc(sizeof(sort_task) * chunks);
+    merge_task* merge_tasks = malloc(sizeof(merge_task)
+                                     * (chunks + thread_count));
+
+    if (!bounds || !sort_tasks || !merge_tasks)
+    {
+        fputs("Could not allocate memory for the sorting tasks.\n", stderr);
+        abort();
+    }
+
+    for (size_t i = 0; i <= chunks; ++i)
+    {
+        bounds[i] = num * i / chunks;
+    }
+
+    // The chunks get their scratch memory from the buffer later used for
+    // merging the chunks, so that only one allocation is needed:
+    size_t buffer_size = 0;
+
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        sort_tasks[i].base = ((char*) base) + bounds[i] * size;
+        sort_tasks[i].num  = bounds[i + 1] - bounds[i];
+        sort_tasks[i].size = size;
+        sort_tasks[i].cmp  = cmp;
+        sort_tasks[i].scratch_size =
+                align_to_max_align(stable_sort_scratch_size(sort_tasks[i].num,
+                                                            size));
+        buffer_size += sort_tasks[i].scratch_size;
+    }
+
+    char* buffer = malloc(max(buffer_size, num * size));
+
+    if (!buffer)
+    {
+        fputs("Could not allocate memory for the buffer array.\n", stderr);
+        abort();
+    }
+
+    for (size_t i = 0, offset = 0; i < chunks; ++i)
+    {
+        sort_tasks[i].scratch = buffer + offset;
+        offset += sort_tasks[i].scratch_size;
+    }
+
+    // Sort the chunks concurrently. Each call does its own run detection and
+    // merge passes:
+    run_in_parallel(sort_tasks,
+                    sizeof(sort_task),
+                    chunks,
+                    run_sort_task,
+                    thread_count);
+
+    // Merge the sorted chunks pairwise until only one run remains:
+    char* source = base;
+    char* target = buffer;
+    size_t runs = chunks;
+
+    while (runs > 1)
+    {
+        const size_t merges = runs / 2;
+        const size_t pieces = max(1, thread_count / merges);
+        size_t task_count = 0;
+        size_t run;
+
+        for (run = 0; run + 1 < runs; run += 2)
+        {
+            const size_t offset = bounds[run] * size;
+            const size_t left_run_length  = bounds[run + 1] - bounds[run];
+            const size_t right_run_length = bounds[run + 2] - bounds[run + 1];
+
+            task_count += split_merge(merge_tasks + task_count,
+                                      source + offset,
+                                      left_run_length,
+                                      source + offset + left_run_length * size,
+                                      right_run_length,
+                                      target + offset,
+                                      pieces,
+                                      size,
+                                      cmp);
+        }
+
+        if (run < runs)
+        {
+            // The last run has no pair; just copy it to the target array:
+            const size_t offset = bounds[run] * size;
+
+            const size_t run_length = bounds[run + 1] - bounds[run];
+
+            task_count += split_merge(merge_tasks + task_count,
+                                      source + offset,
+                                      run_length,
+                                      source + offset + run_length * size,
+                                      0,
+                                      target + offset,
+                                      1,
+                                      size,
+                                      cmp);
+        }
+
+        run_in_parallel(merge_tasks,
+                        sizeof(merge_task),
+                        task_count,
+                        run_merge_task,
+                        thread_count);
+
+        // Drop every other bound, since the adjacent runs are now merged:
+        size_t new_runs = 0;
+
+        for (size_t i = 0; i < runs; i += 2)
+        {
+            bounds[new_runs++] = bounds[i];
+        }
+
+        bounds[new_runs] = num;
+        runs = new_runs;
+
+        char* tmp = source;
+        source = target;
+        target = tmp;
+    }
+
+    if (source != base)
+    {
+        // The result ended up in the buffer; copy it back in parallel:
+        const size_t task_count = split_merge(merge_tasks,
+                                              source,
+                                              num,
+                                              source + num * size,
+                                              0,
+                                              base,
+                                              thread_count,
+                                              size,
+                                              cmp);
+        run_in_parallel(merge_tasks,
+                        sizeof(merge_task),
+                        task_count,
+                        run_merge_task,
+                        thread_count);
+    }
+
+    free(merge_tasks);
+    free(sort_tasks);
+    free(bounds);
+    free(buffer);
+}
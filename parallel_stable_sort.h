@@ -0,0 +1,30 @@
+#ifndef PARALLEL_STABLE_SORT_H
+#define PARALLEL_STABLE_SORT_H
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Sorts an array starting from 'base' of 'num' elements each 'size' bytes  *
+    * long using comparator 'comparator' and at most 'threads' threads, but    *
+    * no more than one thread per 16384 elements. The array is split into one  *
+    * contiguous chunk per thread and the chunks are sorted concurrently by    *
+    * 'stable_sort', after which the chunks are merged pairwise in parallel.   *
+    * When there are fewer merges than threads, each merge is split further    *
+    * into independent pieces. This sort is stable and produces exactly the    *
+    * same result as 'stable_sort'.                                            *
+    ***************************************************************************/
+    void parallel_stable_sort(void* base,
+                              const size_t num,
+                              const size_t size,
+                              const int (*comparator)(const void*,
+                                                      const void*),
+                              const size_t threads);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* PARALLEL_STABLE_SORT_H */
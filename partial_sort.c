@@ -0,0 +1,391 @@
+#include "partial_sort.h"
+#include "stable_sort.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ranges at most this long are finished by insertion sort in 'select_nth':
+static const size_t INSERTION_SORT_THRESHOLD = 16;
+
+/*******************************************************************************
+* The bounded heap of 'partial_stable_sort'. Each slot holds a copy of an      *
+* element and the index it came from; the heap itself only moves slot numbers. *
+* The root holds the greatest element, where equal elements are ordered by     *
+* their original index.                                                        *
+*******************************************************************************/
+typedef struct bounded_heap
+{
+    char* records;
+    size_t* indices;
+    size_t* slots;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+}
+bounded_heap;
+
+static size_t min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+static void swap(char* a, char* b, char* swap_buffer, const size_t size)
+{
+    memcpy(swap_buffer, a, size);
+    memcpy(a, b, size);
+    memcpy(b, swap_buffer, size);
+}
+
+static inline bool slot_precedes(const bounded_heap *const heap,
+                                 const size_t a,
+                                 const size_t b)
+{
+    const int c = heap->cmp(heap->records + a * heap->size,
+                            heap->records + b * heap->size);
+    return c < 0 || (c == 0 && heap->indices[a] < heap->indices[b]);
+}
+
+static void sift_down(bounded_heap *const heap,
+                      size_t index,
+                      const size_t heap_size)
+{
+    size_t* slots = heap->slots;
+    const size_t slot = slots[index];
+
+    for (;;)
+    {
+        size_t child = 2 * index + 1;
+
+        if (child >= heap_size)
+        {
+            break;
+        }
+
+        if (child + 1 < heap_size
+                && slot_precedes(heap, slots[child], slots[child + 1]))
+        {
+            child++;
+        }
+
+        if (!slot_precedes(heap, slot, slots[child]))
+        {
+            break;
+        }
+
+        slots[index] = slots[child];
+        index = child;
+    }
+
+    slots[index] = slot;
+}
+
+void partial_stable_sort(void* base,
+                         const size_t num,
+                         size_t k,
+                         const size_t size,
+                         const int (*cmp)(const void*, const void*))
+{
+    if (!base || !cmp || k == 0 || num < 2)
+    {
+        return;
+    }
+
+    if (k > num / 8)
+    {
+        stable_sort(base, num, size, cmp);
+        return;
+    }
+
+    bounded_heap heap;
+    heap.records = malloc(size * k);
+    heap.indices = malloc(sizeof(size_t) * k);
+    heap.slots   = malloc(sizeof(size_t) * k);
+    heap.size    = size;
+    heap.cmp     = cmp;
+
+    bool* in_prefix = calloc(k, sizeof(bool));
+
+    if (!heap.records || !heap.indices || !heap.slots || !in_prefix)
+    {
+        fputs("Could not allocate memory for the heap.\n", stderr);
+        abort();
+    }
+
+    char* array = base;
+
+    // The first 'k' elements fill the heap:
+    memcpy(heap.records, array, k * size);
+
+    for (size_t i = 0; i < k; ++i)
+    {
+        heap.indices[i] = i;
+        heap.slots[i] = i;
+    }
+
+    for (size_t i = k / 2; i > 0; --i)
+    {
+        sift_down(&heap, i - 1, k);
+    }
+
+    // Every later element that goes before the greatest element in the heap
+    // replaces it. A later element never goes before an equal one, so ties
+    // keep the earlier element, just like 'stable_sort' would:
+    for (size_t i = k; i < num; ++i)
+    {
+        const size_t top = heap.slots[0];
+        char* element = array + i * size;
+
+        if (cmp(element, heap.records + top * size) < 0)
+        {
+            memcpy(heap.records + top * size, element, size);
+            heap.indices[top] = i;
+            sift_down(&heap, 0, k);
+        }
+    }
+
+    // Sort the slots by heapsort; they end up in ascending order:
+    for (size_t heap_size = k; heap_size > 1; --heap_size)
+    {
+        const size_t tmp = heap.slots[0];
+        heap.slots[0] = heap.slots[heap_size - 1];
+        heap.slots[heap_size - 1] = tmp;
+        sift_down(&heap, 0, heap_size - 1);
+    }
+
+    // The elements of the prefix that were not selected move into the places
+    // the selected elements from the rest of the array left behind:
+    for (size_t i = 0; i < k; ++i)
+    {
+        if (heap.indices[i] < k)
+        {
+            in_prefix[heap.indices[i]] = true;
+        }
+    }
+
+    size_t prefix_index = 0;
+
+    for (size_t i = 0; i < k; ++i)
+    {
+        const size_t index = heap.indices[i];
+
+        if (index >= k)
+        {
+            while (in_prefix[prefix_index])
+            {
+                prefix_index++;
+            }
+
+            memcpy(array + index * size, array + prefix_index * size, size);
+            prefix_index++;
+        }
+    }
+
+    for (size_t i = 0; i < k; ++i)
+    {
+        memcpy(array + i * size, heap.records + heap.slots[i] * size, size);
+    }
+
+    free(in_prefix);
+    free(heap.slots);
+    free(heap.indices);
+    free(heap.records);
+}
+
+static void insertion_sort(char* base,
+                           const size_t num,
+                           const size_t size,
+                           const int (*cmp)(const void*, const void*),
+                           char* swap_buffer)
+{
+    for (size_t i = 1; i < num; ++i)
+    {
+        for (size_t j = i; j > 0; --j)
+        {
+            char* current = base + j * size;
+
+            if (cmp(current - size, current) <= 0)
+            {
+                break;
+            }
+
+            swap(current - size, current, swap_buffer, size);
+        }
+    }
+}
+
+static void select_recursive(char* base,
+                             size_t num,
+                             size_t n,
+                             const size_t size,
+                             const int (*cmp)(const void*, const void*),
+                             char* pivot,
+                             char* swap_buffer,
+                             size_t depth_limit);
+
+/*******************************************************************************
+* Copies the median of the first, the middle and the last element to 'pivot'.  *
+*******************************************************************************/
+static void median_of_three(char* base,
+                            const size_t num,
+                            const size_t size,
+                            const int (*cmp)(const void*, const void*),
+                            char* pivot)
+{
+    char* a = base;
+    char* b = base + (num / 2) * size;
+    char* c = base + (num - 1) * size;
+    char* median;
+
+    if (cmp(a, b) < 0)
+    {
+        median = cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a);
+    }
+    else
+    {
+        median = cmp(a, c) < 0 ? a : (cmp(b, c) < 0 ? c : b);
+    }
+
+    memcpy(pivot, median, size);
+}
+
+/*******************************************************************************
+* Copies the median of the medians of the groups of five elements to 'pivot'.  *
+* At least 30% of the elements are not greater and at least 30% are not less   *
+* than it, which guarantees the linear running time of the selection.          *
+*******************************************************************************/
+static void median_of_medians(char* base,
+                              const size_t num,
+                              const size_t size,
+                              const int (*cmp)(const void*, const void*),
+                              char* pivot,
+                              char* swap_buffer)
+{
+    size_t medians = 0;
+
+    for (size_t i = 0; i < num; i += 5)
+    {
+        const size_t group_length = min(5, num - i);
+        char* group = base + i * size;
+
+        insertion_sort(group, group_length, size, cmp, swap_buffer);
+
+        // Gather the medians at the front of the array:
+        swap(base + medians * size,
+             group + (group_length / 2) * size,
+             swap_buffer,
+             size);
+        medians++;
+    }
+
+    select_recursive(base,
+                     medians,
+                     medians / 2,
+                     size,
+                     cmp,
+                     pivot,
+                     swap_buffer,
+                     0);
+
+    memcpy(pivot, base + (medians / 2) * size, size);
+}
+
+static void select_recursive(char* base,
+                             size_t num,
+                             size_t n,
+                             const size_t size,
+                             const int (*cmp)(const void*, const void*),
+                             char* pivot,
+                             char* swap_buffer,
+                             size_t depth_limit)
+{
+    while (num > INSERTION_SORT_THRESHOLD)
+    {
+        if (depth_limit > 0)
+        {
+            median_of_three(base, num, size, cmp, pivot);
+            depth_limit--;
+        }
+        else
+        {
+            median_of_medians(base, num, size, cmp, pivot, swap_buffer);
+        }
+
+        // Partition into the elements less than, equal to and greater than
+        // the pivot:
+        size_t less = 0;
+        size_t greater = num;
+        size_t i = 0;
+
+        while (i < greater)
+        {
+            char* element = base + i * size;
+            const int c = cmp(element, pivot);
+
+            if (c < 0)
+            {
+                swap(base + less * size, element, swap_buffer, size);
+                less++;
+                i++;
+            }
+            else if (c > 0)
+            {
+                greater--;
+                swap(element, base + greater * size, swap_buffer, size);
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        if (n < less)
+        {
+            num = less;
+        }
+        else if (n >= greater)
+        {
+            base += greater * size;
+            num -= greater;
+            n -= greater;
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    insertion_sort(base, num, size, cmp, swap_buffer);
+}
+
+void select_nth(void* base,
+                const size_t num,
+                const size_t n,
+                const size_t size,
+                const int (*cmp)(const void*, const void*))
+{
+    if (!base || !cmp || n >= num)
+    {
+        return;
+    }
+
+    char* buffer = malloc(2 * size);
+
+    if (!buffer)
+    {
+        fputs("Could not allocate memory for the pivot.\n", stderr);
+        abort();
+    }
+
+    // Quickselect gets about twice the number of partitioning rounds a
+    // balanced run would take before it switches to median-of-medians:
+    size_t depth_limit = 0;
+
+    for (size_t length = num; length > 1; length >>= 1)
+    {
+        depth_limit += 2;
+    }
+
+    select_recursive(base, num, n, size, cmp, buffer, buffer + size,
+                     depth_limit);
+    free(buffer);
+}
@@ -0,0 +1,45 @@
+#ifndef PARTIAL_SORT_H
+#define PARTIAL_SORT_H
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Rearranges an array starting from 'base' of 'num' elements each 'size'   *
+    * bytes long so that its first 'k' elements are the first 'k' elements of  *
+    * the array sorted by 'stable_sort' using comparator 'comparator', in the  *
+    * same order. The remaining elements are left in unspecified order. The    *
+    * 'k' smallest elements are kept in a bounded heap, so the running time is *
+    * O(num log k) and only O(k) extra memory is used. If 'k' is not small     *
+    * compared to 'num', the whole array is sorted by 'stable_sort' instead.   *
+    ***************************************************************************/
+    void partial_stable_sort(void* base,
+                             const size_t num,
+                             const size_t k,
+                             const size_t size,
+                             const int (*comparator)(const void*,
+                                                     const void*));
+
+    /***************************************************************************
+    * Rearranges an array starting from 'base' of 'num' elements each 'size'   *
+    * bytes long so that the element at index 'n' is the element that would    *
+    * be there if the array was sorted, no element before it is greater, and   *
+    * no element after it is smaller. Uses introselect: quickselect with       *
+    * median-of-three pivots that falls back to median-of-medians pivots when  *
+    * the partitions turn out unbalanced too often, which bounds the running   *
+    * time to O(num). This function is not stable. Does nothing if 'n' is not  *
+    * less than 'num'.                                                         *
+    ***************************************************************************/
+    void select_nth(void* base,
+                    const size_t num,
+                    const size_t n,
+                    const size_t size,
+                    const int (*comparator)(const void*, const void*));
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* PARTIAL_SORT_H */
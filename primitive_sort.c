@@ -0,0 +1,354 @@
+#include "primitive_sort.h"
+#include "typed_stable_sort.h"
+#include <stdint.h>
+
+/*******************************************************************************
+* If nonzero, the blocks are sorted by AVX2 code where the compiler and the    *
+* processor support it. With 0, only the portable merge sorts are built.       *
+*******************************************************************************/
+#ifndef PRIMITIVE_SORT_USE_AVX2
+#define PRIMITIVE_SORT_USE_AVX2 1
+#endif
+
+#if PRIMITIVE_SORT_USE_AVX2 \
+        && (defined(__GNUC__) || defined(__clang__)) \
+        && (defined(__x86_64__) || defined(__i386__))
+#define PRIMITIVE_SORT_AVX2
+#include <immintrin.h>
+#define AVX2_FUNCTION static inline __attribute__((target("avx2")))
+#endif
+
+STABLE_SORT_DEFINE(merge_sort_int32, int32_t, a < b)
+STABLE_SORT_DEFINE(merge_sort_int64, int64_t, a < b)
+STABLE_SORT_DEFINE(merge_sort_float, float, a < b)
+STABLE_SORT_DEFINE(merge_sort_double, double, a < b)
+
+#ifdef PRIMITIVE_SORT_AVX2
+
+// Each block is held in this many vector registers:
+#define BLOCK_REGISTERS 8
+
+static const size_t INT32_BLOCK_LENGTH = 8 * BLOCK_REGISTERS;
+static const size_t INT64_BLOCK_LENGTH = 4 * BLOCK_REGISTERS;
+
+/*******************************************************************************
+* The operations the bitonic block sort needs from a vector of 8 32-bit keys.  *
+* 'clean' sorts a vector holding a bitonic sequence.                           *
+*******************************************************************************/
+AVX2_FUNCTION __m256i int32_min(const __m256i a, const __m256i b)
+{
+    return _mm256_min_epi32(a, b);
+}
+
+AVX2_FUNCTION __m256i int32_max(const __m256i a, const __m256i b)
+{
+    return _mm256_max_epi32(a, b);
+}
+
+AVX2_FUNCTION __m256i int32_reverse(const __m256i v)
+{
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4,
+                                                            3, 2, 1, 0));
+}
+
+AVX2_FUNCTION __m256i int32_clean(__m256i v)
+{
+    __m256i p = _mm256_permute2x128_si256(v, v, 0x01);
+    v = _mm256_blend_epi32(int32_min(v, p), int32_max(v, p), 0xF0);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(int32_min(v, p), int32_max(v, p), 0xCC);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(int32_min(v, p), int32_max(v, p), 0xAA);
+}
+
+/*******************************************************************************
+* The same operations for a vector of 4 64-bit keys. AVX2 has no 64-bit        *
+* minimum and maximum, so they are made of a comparison and a blend.           *
+*******************************************************************************/
+AVX2_FUNCTION __m256i int64_min(const __m256i a, const __m256i b)
+{
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+AVX2_FUNCTION __m256i int64_max(const __m256i a, const __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+AVX2_FUNCTION __m256i int64_reverse(const __m256i v)
+{
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+AVX2_FUNCTION __m256i int64_clean(__m256i v)
+{
+    __m256i p = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(int64_min(v, p), int64_max(v, p), 0xF0);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_blend_epi32(int64_min(v, p), int64_max(v, p), 0xCC);
+}
+
+/*******************************************************************************
+* Defines the parts of the block sort that do not depend on the lane count:    *
+*                                                                              *
+* name##_sort_columns sorts each lane across the 8 registers with the optimal  *
+*     19-comparator sorting network for 8 inputs.                              *
+* name##_merge_runs merges each pair of adjacent sorted runs of                *
+*     'run_registers' registers by reversing the right run and running the     *
+*     bitonic merge network over both.                                         *
+*******************************************************************************/
+#define DEFINE_BITONIC_BLOCK_SORT(name)                                        \
+                                                                               \
+AVX2_FUNCTION void name##_exchange(__m256i* a, __m256i* b)                     \
+{                                                                              \
+    const __m256i lo = name##_min(*a, *b);                                     \
+    *b = name##_max(*a, *b);                                                   \
+    *a = lo;                                                                   \
+}                                                                              \
+                                                                               \
+AVX2_FUNCTION void name##_sort_columns(__m256i* v)                             \
+{                                                                              \
+    static const int network[19][2] = {                                        \
+        { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },                                \
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },                                \
+        { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },                                \
+        { 2, 4 }, { 3, 5 }, { 1, 4 }, { 3, 6 },                                \
+        { 1, 2 }, { 3, 4 }, { 5, 6 }                                           \
+    };                                                                         \
+                                                                               \
+    for (int i = 0; i < 19; ++i)                                               \
+    {                                                                          \
+        name##_exchange(&v[network[i][0]], &v[network[i][1]]);                 \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+AVX2_FUNCTION void name##_merge_runs(__m256i* v, const int run_registers)      \
+{                                                                              \
+    for (int start = 0; start < BLOCK_REGISTERS; start += 2 * run_registers)   \
+    {                                                                          \
+        __m256i* run = v + start;                                              \
+                                                                               \
+        for (int i = 0; i < run_registers / 2; ++i)                            \
+        {                                                                      \
+            const __m256i tmp = run[run_registers + i];                        \
+            run[run_registers + i] = run[2 * run_registers - 1 - i];           \
+            run[2 * run_registers - 1 - i] = tmp;                              \
+        }                                                                      \
+                                                                               \
+        for (int i = run_registers; i < 2 * run_registers; ++i)                \
+        {                                                                      \
+            run[i] = name##_reverse(run[i]);                                   \
+        }                                                                      \
+                                                                               \
+        for (int stride = run_registers; stride > 0; stride /= 2)              \
+        {                                                                      \
+            for (int i = 0; i < 2 * run_registers; ++i)                        \
+            {                                                                  \
+                if ((i & stride) == 0)                                         \
+                {                                                              \
+                    name##_exchange(&run[i], &run[i + stride]);                \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        for (int i = 0; i < 2 * run_registers; ++i)                            \
+        {                                                                      \
+            run[i] = name##_clean(run[i]);                                     \
+        }                                                                      \
+    }                                                                          \
+}
+
+DEFINE_BITONIC_BLOCK_SORT(int32)
+DEFINE_BITONIC_BLOCK_SORT(int64)
+
+/*******************************************************************************
+* Sorts 64 32-bit keys. After the columns are sorted, the 8x8 transpose turns  *
+* each register into a sorted run, and three bitonic merge passes follow.      *
+*******************************************************************************/
+AVX2_FUNCTION void int32_sort_block(int32_t* block)
+{
+    __m256i v[BLOCK_REGISTERS];
+
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        v[i] = _mm256_loadu_si256((const __m256i*)(block + 8 * i));
+    }
+
+    int32_sort_columns(v);
+
+    __m256i t[BLOCK_REGISTERS];
+    __m256i u[BLOCK_REGISTERS];
+
+    for (int i = 0; i < BLOCK_REGISTERS; i += 2)
+    {
+        t[i]     = _mm256_unpacklo_epi32(v[i], v[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(v[i], v[i + 1]);
+    }
+
+    for (int i = 0; i < BLOCK_REGISTERS; i += 4)
+    {
+        u[i]     = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        v[i]     = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        v[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+
+    int32_merge_runs(v, 1);
+    int32_merge_runs(v, 2);
+    int32_merge_runs(v, 4);
+
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        _mm256_storeu_si256((__m256i*)(block + 8 * i), v[i]);
+    }
+}
+
+/*******************************************************************************
+* Sorts 32 64-bit keys. After the columns are sorted, the upper and the lower  *
+* half are transposed separately, so that column 'c' lands in the registers    *
+* '2c' and '2c + 1', which together hold a sorted run of 8 keys. Two bitonic   *
+* merge passes follow.                                                         *
+*******************************************************************************/
+AVX2_FUNCTION void int64_sort_block(int64_t* block)
+{
+    __m256i v[BLOCK_REGISTERS];
+
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        v[i] = _mm256_loadu_si256((const __m256i*)(block + 4 * i));
+    }
+
+    int64_sort_columns(v);
+
+    __m256i w[BLOCK_REGISTERS];
+
+    for (int half = 0; half < 2; ++half)
+    {
+        const __m256i* r = v + 4 * half;
+        const __m256i t0 = _mm256_unpacklo_epi64(r[0], r[1]);
+        const __m256i t1 = _mm256_unpackhi_epi64(r[0], r[1]);
+        const __m256i t2 = _mm256_unpacklo_epi64(r[2], r[3]);
+        const __m256i t3 = _mm256_unpackhi_epi64(r[2], r[3]);
+
+        w[half]     = _mm256_permute2x128_si256(t0, t2, 0x20);
+        w[half + 2] = _mm256_permute2x128_si256(t1, t3, 0x20);
+        w[half + 4] = _mm256_permute2x128_si256(t0, t2, 0x31);
+        w[half + 6] = _mm256_permute2x128_si256(t1, t3, 0x31);
+    }
+
+    int64_merge_runs(w, 2);
+    int64_merge_runs(w, 4);
+
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        _mm256_storeu_si256((__m256i*)(block + 4 * i), w[i]);
+    }
+}
+
+/*******************************************************************************
+* Maps the bits of a float or double to an integer of the same width so that   *
+* the integers compare like the floating point values. The mapping is its own  *
+* inverse. It puts -0.0 before +0.0, which compare equal as floats.            *
+*******************************************************************************/
+AVX2_FUNCTION __m256i float_to_sortable(const __m256i v)
+{
+    return _mm256_xor_si256(v,
+                            _mm256_and_si256(_mm256_srai_epi32(v, 31),
+                                             _mm256_set1_epi32(INT32_MAX)));
+}
+
+AVX2_FUNCTION __m256i double_to_sortable(const __m256i v)
+{
+    const __m256i sign = _mm256_cmpgt_epi64(_mm256_setzero_si256(), v);
+    return _mm256_xor_si256(v,
+                            _mm256_and_si256(sign,
+                                             _mm256_set1_epi64x(INT64_MAX)));
+}
+
+AVX2_FUNCTION void float_sort_block(float* block)
+{
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        __m256i* p = (__m256i*)(block + 8 * i);
+        _mm256_storeu_si256(p, float_to_sortable(_mm256_loadu_si256(p)));
+    }
+
+    int32_sort_block((int32_t*) block);
+
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        __m256i* p = (__m256i*)(block + 8 * i);
+        _mm256_storeu_si256(p, float_to_sortable(_mm256_loadu_si256(p)));
+    }
+}
+
+AVX2_FUNCTION void double_sort_block(double* block)
+{
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        __m256i* p = (__m256i*)(block + 4 * i);
+        _mm256_storeu_si256(p, double_to_sortable(_mm256_loadu_si256(p)));
+    }
+
+    int64_sort_block((int64_t*) block);
+
+    for (int i = 0; i < BLOCK_REGISTERS; ++i)
+    {
+        __m256i* p = (__m256i*)(block + 4 * i);
+        _mm256_storeu_si256(p, double_to_sortable(_mm256_loadu_si256(p)));
+    }
+}
+
+// Dispatched separately so that the blocks are sorted by AVX2 code:
+#define DEFINE_SORT_BLOCKS(name, type, block_length)                           \
+__attribute__((target("avx2")))                                                \
+static void name##_sort_blocks(type* base, const size_t num)                   \
+{                                                                              \
+    for (size_t i = 0; i + block_length <= num; i += block_length)             \
+    {                                                                          \
+        name##_sort_block(base + i);                                           \
+    }                                                                          \
+}
+
+DEFINE_SORT_BLOCKS(int32, int32_t, INT32_BLOCK_LENGTH)
+DEFINE_SORT_BLOCKS(int64, int64_t, INT64_BLOCK_LENGTH)
+DEFINE_SORT_BLOCKS(float, float, INT32_BLOCK_LENGTH)
+DEFINE_SORT_BLOCKS(double, double, INT64_BLOCK_LENGTH)
+
+static int has_avx2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif /* PRIMITIVE_SORT_AVX2 */
+
+// The merge sort finds the sorted blocks as runs and merges them:
+#ifdef PRIMITIVE_SORT_AVX2
+#define DEFINE_PRIMITIVE_SORT(name, type, block_length)                        \
+void stable_sort_##name(type* base, const size_t num)                          \
+{                                                                              \
+    if (base && num >= block_length && has_avx2())                             \
+    {                                                                          \
+        name##_sort_blocks(base, num);                                         \
+    }                                                                          \
+                                                                               \
+    merge_sort_##name(base, num);                                              \
+}
+#else
+#define DEFINE_PRIMITIVE_SORT(name, type, block_length)                        \
+void stable_sort_##name(type* base, const size_t num)                          \
+{                                                                              \
+    merge_sort_##name(base, num);                                              \
+}
+#endif
+
+DEFINE_PRIMITIVE_SORT(int32, int32_t, INT32_BLOCK_LENGTH)
+DEFINE_PRIMITIVE_SORT(int64, int64_t, INT64_BLOCK_LENGTH)
+DEFINE_PRIMITIVE_SORT(float, float, INT32_BLOCK_LENGTH)
+DEFINE_PRIMITIVE_SORT(double, double, INT64_BLOCK_LENGTH)
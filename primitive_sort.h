@@ -0,0 +1,31 @@
+#ifndef PRIMITIVE_SORT_H
+#define PRIMITIVE_SORT_H
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Sorts an array of 'num' primitive keys starting from 'base' into         *
+    * ascending order. On x86 processors supporting AVX2 (detected at run      *
+    * time), blocks of 64 32-bit or 32 64-bit keys are first sorted in vector  *
+    * registers by a sorting network followed by bitonic merges; the sorted    *
+    * blocks are then merged like in 'stable_sort'. Elsewhere, a natural merge *
+    * sort specialized by 'STABLE_SORT_DEFINE' is used. Since equal keys are   *
+    * indistinguishable, the result is the same as that of 'stable_sort'. The  *
+    * only exception is that the relative order of -0.0 and +0.0 in floating   *
+    * point arrays is unspecified. Floating point arrays must not contain      *
+    * NaNs. These functions abort if they cannot allocate their buffer.        *
+    ***************************************************************************/
+    void stable_sort_int32(int32_t* base, const size_t num);
+    void stable_sort_int64(int64_t* base, const size_t num);
+    void stable_sort_float(float* base, const size_t num);
+    void stable_sort_double(double* base, const size_t num);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* PRIMITIVE_SORT_H */
@@ -0,0 +1,176 @@
+#include "segmented_sort.h"
+#include "sort_utils.h"
+#include "stable_sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Segments at most this long are sorted by insertion sort:
+static const size_t INSERTION_SORT_THRESHOLD = 16;
+
+// Fewer elements than this per thread are not worth a thread of their own:
+static const size_t MINIMUM_ELEMENTS_PER_THREAD = 1 << 14;
+
+typedef struct segment_task
+{
+    char* base;
+    const size_t* offsets;
+    size_t first_segment;
+    size_t last_segment;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+    char* scratch;
+    size_t scratch_size;
+    char* swap_buffer;
+}
+segment_task;
+
+static size_t min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+static void insertion_sort(char* base,
+                           const size_t num,
+                           const size_t size,
+                           const int (*cmp)(const void*, const void*),
+                           char* swap_buffer)
+{
+    for (size_t i = 1; i < num; ++i)
+    {
+        char* element = base + i * size;
+        size_t j = i;
+
+        while (j > 0 && cmp(element, base + (j - 1) * size) < 0)
+        {
+            j--;
+        }
+
+        if (j < i)
+        {
+            memcpy(swap_buffer, element, size);
+            memmove(base + (j + 1) * size, base + j * size, (i - j) * size);
+            memcpy(base + j * size, swap_buffer, size);
+        }
+    }
+}
+
+static void run_segment_task(void* arg)
+{
+    segment_task* task = arg;
+
+    for (size_t i = task->first_segment; i < task->last_segment; ++i)
+    {
+        char* segment = task->base + task->offsets[i] * task->size;
+        const size_t num = task->offsets[i + 1] - task->offsets[i];
+
+        if (num <= INSERTION_SORT_THRESHOLD)
+        {
+            insertion_sort(segment,
+                           num,
+                           task->size,
+                           task->cmp,
+                           task->swap_buffer);
+        }
+        else
+        {
+            stable_sort_with_buffer(segment,
+                                    num,
+                                    task->size,
+                                    task->cmp,
+                                    task->scratch,
+                                    task->scratch_size);
+        }
+    }
+}
+
+void segmented_stable_sort(void* base,
+                           const size_t* offsets,
+                           const size_t segments,
+                           const size_t size,
+                           const int (*cmp)(const void*, const void*),
+                           size_t threads)
+{
+    if (!base || !offsets || !cmp || segments == 0)
+    {
+        return;
+    }
+
+    const size_t total = offsets[segments] - offsets[0];
+
+    threads = min(threads, segments);
+    threads = min(threads, total / MINIMUM_ELEMENTS_PER_THREAD);
+
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+
+    segment_task* tasks = malloc(sizeof(segment_task) * threads);
+
+    if (!tasks)
+    {
+        fputs("Could not allocate memory for the sorting tasks.\n", stderr);
+        abort();
+    }
+
+    // Split the segments into contiguous groups of about equal element
+    // counts, and size the scratch of each group by its longest segment:
+    size_t buffer_size = 0;
+    size_t segment = 0;
+
+    for (size_t t = 0; t < threads; ++t)
+    {
+        const size_t bound = offsets[0] + total / threads * (t + 1);
+        size_t longest = 0;
+
+        tasks[t].first_segment = segment;
+
+        while (segment < segments
+                && (t == threads - 1 || offsets[segment + 1] <= bound))
+        {
+            const size_t num = offsets[segment + 1] - offsets[segment];
+
+            if (num > longest)
+            {
+                longest = num;
+            }
+
+            segment++;
+        }
+
+        tasks[t].last_segment = segment;
+        tasks[t].base         = base;
+        tasks[t].offsets      = offsets;
+        tasks[t].size         = size;
+        tasks[t].cmp          = cmp;
+        tasks[t].scratch_size = stable_sort_scratch_size(longest, size);
+
+        // The swap buffer of the insertion sort goes after the scratch:
+        buffer_size += align_to_max_align(tasks[t].scratch_size + size);
+    }
+
+    char* buffer = malloc(buffer_size);
+
+    if (buffer_size > 0 && !buffer)
+    {
+        fputs("Could not allocate memory for the buffer array.\n", stderr);
+        abort();
+    }
+
+    for (size_t t = 0, offset = 0; t < threads; ++t)
+    {
+        tasks[t].scratch = buffer + offset;
+        tasks[t].swap_buffer = tasks[t].scratch + tasks[t].scratch_size;
+        offset += align_to_max_align(tasks[t].scratch_size + size);
+    }
+
+    run_in_parallel(tasks,
+                    sizeof(segment_task),
+                    threads,
+                    run_segment_task,
+                    threads);
+
+    free(buffer);
+    free(tasks);
+}
@@ -0,0 +1,33 @@
+#ifndef SEGMENTED_SORT_H
+#define SEGMENTED_SORT_H
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Sorts each of the 'segments' consecutive segments of the array starting  *
+    * from 'base' on its own, using comparator 'comparator'. Segment 'i'       *
+    * consists of the elements from index 'offsets[i]' up to, but excluding,   *
+    * index 'offsets[i + 1]', so 'offsets' holds 'segments + 1' nondecreasing  *
+    * indices. Each element is 'size' bytes long. Segments of at most 16       *
+    * elements are sorted by insertion sort and longer ones by                 *
+    * 'stable_sort_with_buffer', all sharing one scratch buffer per thread.    *
+    * The segments are spread over at most 'threads' threads in contiguous     *
+    * groups of about equal element counts. This sort is stable. It aborts if  *
+    * it cannot allocate its buffers.                                          *
+    ***************************************************************************/
+    void segmented_stable_sort(void* base,
+                               const size_t* offsets,
+                               const size_t segments,
+                               const size_t size,
+                               const int (*comparator)(const void*,
+                                                       const void*),
+                               const size_t threads);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* SEGMENTED_SORT_H */
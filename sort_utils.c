@@ -0,0 +1,121 @@
+#include "sort_utils.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+typedef struct worker
+{
+    char* tasks;
+    size_t task_size;
+    size_t task_count;
+    size_t first_task;
+    size_t stride;
+    void (*run)(void*);
+}
+worker;
+
+static size_t min(const size_t a, const size_t b)
+{
+    return a < b ? a : b;
+}
+
+static size_t max(const size_t a, const size_t b)
+{
+    return a > b ? a : b;
+}
+
+size_t align_to_max_align(const size_t bytes)
+{
+    const size_t alignment = _Alignof(max_align_t);
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+bool is_little_endian(void)
+{
+    const uint16_t word = 1;
+    return *((const unsigned char*) &word) == 1;
+}
+
+size_t get_digit_offset(const size_t key_offset,
+                        const size_t key_size,
+                        const size_t digit,
+                        const bool little_endian)
+{
+    return key_offset + (little_endian ? digit : key_size - 1 - digit);
+}
+
+static int worker_main(void* arg)
+{
+    worker* w = arg;
+
+    for (size_t i = w->first_task; i < w->task_count; i += w->stride)
+    {
+        w->run(w->tasks + i * w->task_size);
+    }
+
+    return 0;
+}
+
+void run_in_parallel(void* tasks,
+                     const size_t task_size,
+                     const size_t task_count,
+                     void (*run)(void*),
+                     size_t threads)
+{
+    if (task_count == 0)
+    {
+        return;
+    }
+
+    // With 0 threads requested, the calling thread still does the work:
+    threads = max(min(threads, task_count), 1);
+
+    worker* workers  = malloc(sizeof(worker) * threads);
+    thrd_t* handles  = malloc(sizeof(thrd_t) * threads);
+    bool*   launched = malloc(sizeof(bool) * threads);
+
+    if (!workers || !handles || !launched)
+    {
+        fputs("Could not allocate memory for the worker threads.\n", stderr);
+        abort();
+    }
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers[i].tasks      = tasks;
+        workers[i].task_size  = task_size;
+        workers[i].task_count = task_count;
+        workers[i].first_task = i;
+        workers[i].stride     = threads;
+        workers[i].run        = run;
+    }
+
+    // Worker 0 is served by the calling thread:
+    for (size_t i = 1; i < threads; ++i)
+    {
+        launched[i] = thrd_create(&handles[i],
+                                  worker_main,
+                                  &workers[i]) == thrd_success;
+    }
+
+    worker_main(&workers[0]);
+
+    for (size_t i = 1; i < threads; ++i)
+    {
+        if (launched[i])
+        {
+            thrd_join(handles[i], NULL);
+        }
+        else
+        {
+            worker_main(&workers[i]);
+        }
+    }
+
+    free(launched);
+    free(handles);
+    free(workers);
+}
@@ -0,0 +1,52 @@
+#ifndef SORT_UTILS_H
+#define SORT_UTILS_H
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Helpers shared by the sorts. They are not part of the public interface.  *
+    ***************************************************************************/
+
+    /***************************************************************************
+    * Rounds 'bytes' up so that a scratch area starting right after them is    *
+    * aligned for any element.                                                 *
+    ***************************************************************************/
+    size_t align_to_max_align(const size_t bytes);
+
+    /***************************************************************************
+    * Returns true if the least significant byte of an integer is stored       *
+    * first.                                                                   *
+    ***************************************************************************/
+    bool is_little_endian(void);
+
+    /***************************************************************************
+    * Returns the offset of the 'digit'th least significant byte of a          *
+    * 'key_size' bytes long key at 'key_offset' within an element.             *
+    ***************************************************************************/
+    size_t get_digit_offset(const size_t key_offset,
+                            const size_t key_size,
+                            const size_t digit,
+                            const bool little_endian);
+
+    /***************************************************************************
+    * Runs 'run' on each of the 'task_count' tasks, which are 'task_size'      *
+    * bytes apart starting from 'tasks', using at most 'threads' threads. The  *
+    * calling thread takes part in the work as well, so 0 threads means 1. If  *
+    * a thread cannot be started, its share of the tasks is run by the calling *
+    * thread.                                                                  *
+    ***************************************************************************/
+    void run_in_parallel(void* tasks,
+                         const size_t task_size,
+                         const size_t task_count,
+                         void (*run)(void*),
+                         size_t threads);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* SORT_UTILS_H */
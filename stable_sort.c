@@ -1,6 +1,7 @@
 #include "stable_sort.h"
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,26 +29,16 @@ static size_t fix_capacity_to_power_of_two(const size_t capacity)
     return ret; // Now 'ret' is a power of two no less than 'capacity'.
 }
 
-static size_t max(const size_t a, const size_t b)
+static size_t min(const size_t a, const size_t b)
 {
-    return a > b ? a : b;
+    return a < b ? a : b;
 }
 
 static void run_length_queue_init(run_length_queue *const queue,
-                                  size_t capacity)
+                                  size_t* storage,
+                                  const size_t capacity)
 {
-    capacity = max(capacity, fix_capacity_to_power_of_two(capacity));
-    queue->storage = malloc(sizeof(size_t) * capacity);
-    
-    if (!queue->storage)
-    {
-        fputs("Could not allocate memory for the storage array of the run "
-              "length queue\n",
-              stderr);
-        
-        abort();
-    }
-    
+    queue->storage = storage;
     queue->capacity = capacity;
     queue->mask = capacity - 1;
     queue->head = 0;
@@ -82,11 +73,6 @@ static inline size_t run_length_queue_size(const run_length_queue *const queue)
     return queue->size;
 }
 
-void run_length_queue_free(const run_length_queue *const queue)
-{
-    free(queue->storage);
-}
-
 static inline void reverse_run(char* base,
                                size_t num,
                                size_t size,
@@ -106,156 +92,218 @@ static inline void reverse_run(char* base,
     }
 }
 
-static run_length_queue*
-build_run_length_queue(void* base,
-                       size_t num,
-                       size_t size,
-                       const int (*cmp)(const void*, const void*))
+/*******************************************************************************
+* Runs shorter than this are extended by binary insertion sort before merging, *
+* so that the merge passes start from cache-sized blocks instead of runs of    *
+* length 1 or 2 on random data. Define at compile time to tune.                *
+*******************************************************************************/
+#ifndef STABLE_SORT_MINIMUM_RUN_LENGTH
+#define STABLE_SORT_MINIMUM_RUN_LENGTH 32
+#endif
+
+static const size_t MINIMUM_RUN_LENGTH = STABLE_SORT_MINIMUM_RUN_LENGTH;
+
+/*******************************************************************************
+* Finds the longest run starting from 'head' within the 'num' remaining        *
+* elements and returns its length. A strictly descending run is reversed, so   *
+* that on return the run is ascending. Reversing only strictly descending runs *
+* keeps the sort stable.                                                       *
+*******************************************************************************/
+static size_t scan_run(char* head,
+                       const size_t num,
+                       const size_t size,
+                       const int (*cmp)(const void*, const void*),
+                       char* swap_buffer)
 {
-    run_length_queue* queue = malloc(sizeof(run_length_queue));
-    
-    if (!queue)
+    if (num == 1)
     {
-        fputs("Could not allocate memory for the actual run length queue.\n",
-              stderr);
-        
-        abort();
-    }
-    
-    run_length_queue_init(queue, (num + 1) / 2);
-    
-    // The buffer for doing the run reversals:
-    char* swap_buffer = malloc(size);
-    
-    if (!swap_buffer)
-    {
-        fputs("Could not allocate memory for the swap buffer.\n", stderr);
-        abort();
+        return 1;
     }
     
-    char* head  = (char*) base;
     char* left  = head;
-    char* right = ((char*) base) + size;
-    char* last  = ((char*) base) + size * (num - 1);
-    
-    size_t run_length;
-    bool previous_run_was_descending;
+    char* right = head + size;
+    size_t run_length = 2;
     
-    // Find the very first run:
     if (cmp(left, right) <= 0)
     {
-        // Once here, the first run is ascending.
-        left  += size;
-        right += size;
-        
-        while (left < last && cmp(left, right) <= 0)
+        // Once here, the run is ascending.
+        while (run_length < num && cmp(right, right + size) <= 0)
         {
-            left  += size;
             right += size;
+            run_length++;
         }
-        
-        run_length = (right - head) / size;
-        run_length_queue_enqueue(queue, run_length);
-        previous_run_was_descending = false;
     }
     else
     {
-        left  += size;
-        right += size;
-        
-        while (left < last && cmp(left, right) > 0)
+        while (run_length < num && cmp(right, right + size) > 0)
         {
-            left  += size;
             right += size;
+            run_length++;
         }
         
-        run_length = (right - head) / size;
-        run_length_queue_enqueue(queue, run_length);
         reverse_run(head, run_length, size, swap_buffer);
-        previous_run_was_descending = true;
     }
     
-    left  += size;
-    right += size;
-    
-    // Scan all other runs:
-    while (left < last)
+    return run_length;
+}
+
+/*******************************************************************************
+* Given that the first 'sorted_length' elements starting from 'head' are       *
+* sorted, inserts the elements up to 'num' one by one at the positions found   *
+* by binary search. Each element is inserted after all the elements equal to   *
+* it, which keeps the sort stable.                                             *
+*******************************************************************************/
+static void binary_insertion_sort(char* head,
+                                  const size_t sorted_length,
+                                  const size_t num,
+                                  const size_t size,
+                                  const int (*cmp)(const void*, const void*),
+                                  char* swap_buffer)
+{
+    for (size_t i = sorted_length; i < num; ++i)
     {
-        head = left;
+        char* element = head + i * size;
+        size_t lo = 0;
+        size_t hi = i;
         
-        // Decide the direction of the current run:
-        if (cmp(left, right) <= 0)
+        while (lo < hi)
         {
-            // Once here, the current run is ascending.
-            left  += size;
-            right += size;
+            const size_t mid = lo + (hi - lo) / 2;
             
-            while (left < last && cmp(left, right) <= 0)
+            if (cmp(element, head + mid * size) < 0)
             {
-                left  += size;
-                right += size;
-            }
-            
-            run_length = (right - head) / size;
-            
-            if (previous_run_was_descending
-                && cmp(head - size, head) <= 0)
-            {
-                // We can extend the size of the preceding run:
-                run_length_queue_add_to_last(queue, run_length);
+                hi = mid;
             }
             else
             {
-                run_length_queue_enqueue(queue, run_length);
+                lo = mid + 1;
             }
+        }
+        
+        if (lo < i)
+        {
+            memcpy(swap_buffer, element, size);
+            memmove(head + (lo + 1) * size, head + lo * size, (i - lo) * size);
+            memcpy(head + lo * size, swap_buffer, size);
+        }
+    }
+}
+
+/*******************************************************************************
+* Returns the capacity of the run length queue for an array of 'num' elements. *
+* All runs but the last one are at least 'MINIMUM_RUN_LENGTH' long.            *
+*******************************************************************************/
+static size_t get_run_length_queue_capacity(const size_t num)
+{
+    return fix_capacity_to_power_of_two(num / MINIMUM_RUN_LENGTH + 1);
+}
+
+static void build_run_length_queue(run_length_queue *const queue,
+                                   void* base,
+                                   size_t num,
+                                   size_t size,
+                                   const int (*cmp)(const void*, const void*),
+                                   char* swap_buffer)
+{
+    char* head = (char*) base;
+    size_t remaining = num;
+    
+    while (remaining)
+    {
+        size_t run_length = scan_run(head, remaining, size, cmp, swap_buffer);
+        
+        if (run_length < MINIMUM_RUN_LENGTH)
+        {
+            const size_t extended_run_length = min(MINIMUM_RUN_LENGTH,
+                                                   remaining);
+            binary_insertion_sort(head,
+                                  run_length,
+                                  extended_run_length,
+                                  size,
+                                  cmp,
+                                  swap_buffer);
             
-            previous_run_was_descending = false;
+            run_length = extended_run_length;
+        }
+        
+        if (run_length_queue_size(queue) > 0 && cmp(head - size, head) <= 0)
+        {
+            // We can extend the size of the preceding run:
+            run_length_queue_add_to_last(queue, run_length);
         }
         else
         {
-            // Once here, the current run is descending.
-            left  += size;
-            right += size;
-            
-            while (left < last && cmp(left, right) > 0)
-            {
-                left  += size;
-                right += size;
-            }
-            
-            run_length = (right - head) / size;
-            reverse_run(head, run_length, size, swap_buffer);
-            
-            if (previous_run_was_descending && cmp(head - size, head) <= 0)
-            {
-                run_length_queue_add_to_last(queue, run_length);
-            }
-            else
-            {
-                run_length_queue_enqueue(queue, run_length);
-            }
-            
-            previous_run_was_descending = true;
+            run_length_queue_enqueue(queue, run_length);
         }
         
-        left  += size;
-        right += size;
+        head      += run_length * size;
+        remaining -= run_length;
+    }
+}
+
+// After this many consecutive wins of one run, 'merge' switches to galloping:
+static const size_t MINIMUM_GALLOP = 7;
+
+/*******************************************************************************
+* If nonzero, the element-by-element phase of 'merge' is branch-free. Element  *
+* sizes of 4, 8 and 16 bytes get merge routines of their own, in which the     *
+* element copies compile down to plain loads and stores.                       *
+*******************************************************************************/
+#ifndef STABLE_SORT_BRANCHLESS_MERGE
+#define STABLE_SORT_BRANCHLESS_MERGE 1
+#endif
+
+/*******************************************************************************
+* Returns the number of leading elements of the sorted run 'run' of 'num'      *
+* elements that go before 'key' in a stable merge. If 'run' is the left run,   *
+* elements equal to 'key' go before it, otherwise they go after it. The        *
+* search probes the indices 0, 1, 3, 7, 15, ... and then narrows the found     *
+* range by binary search, so it costs O(log k) comparisons for an answer k.    *
+*******************************************************************************/
+static size_t gallop(const char* key,
+                     const char* run,
+                     const size_t num,
+                     const size_t size,
+                     const bool run_is_left,
+                     const int (*cmp)(const void*, const void*))
+{
+    const int threshold = run_is_left ? 1 : 0;
+    
+    if (num == 0 || cmp(run, key) >= threshold)
+    {
+        return 0;
+    }
+    
+    // Invariant: all elements before 'lo' go before 'key':
+    size_t lo = 1;
+    size_t hi = 1;
+    
+    while (hi < num && cmp(run + hi * size, key) < threshold)
+    {
+        lo = hi + 1;
+        hi = 2 * hi + 1;
+    }
+    
+    if (hi > num)
+    {
+        hi = num;
     }
     
-    if (left == last)
+    while (lo < hi)
     {
-        if (cmp(last - size, last) <= 0)
+        const size_t mid = lo + (hi - lo) / 2;
+        
+        if (cmp(run + mid * size, key) < threshold)
         {
-            run_length_queue_add_to_last(queue, 1);
+            lo = mid + 1;
         }
         else
         {
-            run_length_queue_enqueue(queue, 1);
+            hi = mid;
         }
     }
     
-    free(swap_buffer);
-    return queue;
+    return lo;
 }
 
 static inline void merge(char *const source,
@@ -268,29 +316,139 @@ static inline void merge(char *const source,
     const char* left_upper_bound  = source + left_run_length * size;
     const char* right_upper_bound = left_upper_bound + right_run_length * size;
     
-    char* left  = source;
-    char* right = left_upper_bound;
+    const char* left  = source;
+    const char* right = left_upper_bound;
+    
+    size_t left_wins  = 0;
+    size_t right_wins = 0;
     
     while (left != left_upper_bound && right != right_upper_bound)
     {
+#if STABLE_SORT_BRANCHLESS_MERGE
+        // On random data the outcome of the comparison is a coin flip, so the
+        // source is selected by arithmetic instead of a mispredicted branch:
+        const size_t take_right = cmp(right, left) < 0;
+        const size_t take_left  = 1 - take_right;
+        
+        memcpy(target, take_right ? right : left, size);
+        right += take_right * size;
+        left  += take_left  * size;
+        right_wins = (right_wins + 1) * take_right;
+        left_wins  = (left_wins  + 1) * take_left;
+#else
         if (cmp(right, left) < 0)
         {
             memcpy(target, right, size);
             right += size;
+            right_wins++;
+            left_wins = 0;
         }
         else
         {
             memcpy(target, left, size);
             left += size;
+            left_wins++;
+            right_wins = 0;
         }
+#endif
         
         target += size;
+        
+        if (left == left_upper_bound || right == right_upper_bound)
+        {
+            break;
+        }
+        
+        if (left_wins < MINIMUM_GALLOP && right_wins < MINIMUM_GALLOP)
+        {
+            continue;
+        }
+        
+        // One run keeps winning; copy whole blocks instead of single elements
+        // for as long as the blocks stay long:
+        size_t left_count;
+        size_t right_count;
+        
+        do
+        {
+            left_count = gallop(right,
+                                left,
+                                (left_upper_bound - left) / size,
+                                size,
+                                true,
+                                cmp);
+            
+            memcpy(target, left, left_count * size);
+            target += left_count * size;
+            left   += left_count * size;
+            
+            if (left == left_upper_bound)
+            {
+                break;
+            }
+            
+            right_count = gallop(left,
+                                 right,
+                                 (right_upper_bound - right) / size,
+                                 size,
+                                 false,
+                                 cmp);
+            
+            memcpy(target, right, right_count * size);
+            target += right_count * size;
+            right  += right_count * size;
+            
+            if (right == right_upper_bound)
+            {
+                break;
+            }
+        }
+        while (left_count >= MINIMUM_GALLOP || right_count >= MINIMUM_GALLOP);
+        
+        left_wins  = 0;
+        right_wins = 0;
     }
     
     memcpy(target, left,  left_upper_bound - left);
+    target += left_upper_bound - left;
     memcpy(target, right, right_upper_bound - right);
 }
 
+/*******************************************************************************
+* Calls 'merge' with a constant element size for the common sizes, so that     *
+* each gets a specialized copy of it.                                          *
+*******************************************************************************/
+static void merge_runs(char *const source,
+                       char* target,
+                       const size_t left_run_length,
+                       const size_t right_run_length,
+                       const size_t size,
+                       const int (*cmp)(const void*, const void*))
+{
+    switch (size)
+    {
+        case 4:
+            merge(source, target, left_run_length, right_run_length, 4, cmp);
+            break;
+            
+        case 8:
+            merge(source, target, left_run_length, right_run_length, 8, cmp);
+            break;
+            
+        case 16:
+            merge(source, target, left_run_length, right_run_length, 16, cmp);
+            break;
+            
+        default:
+            merge(source, 
+                  target, 
+                  left_run_length, 
+                  right_run_length, 
+                  size, 
+                  cmp);
+    }
+}
+
 static size_t get_number_of_leading_zeros(const size_t number)
 {
     size_t mask = 1;
@@ -311,27 +469,84 @@ static size_t get_number_of_merge_passes(const size_t runs)
     return sizeof(size_t) * CHAR_BIT - get_number_of_leading_zeros(runs - 1);
 }
 
-void stable_sort(void* base,
-                 const size_t num,
-                 const size_t size,
-                 const int (*cmp)(const void*, const void*))
+/*******************************************************************************
+* Lays out the scratch memory as the merge buffer of 'num' elements, followed  *
+* by a swap buffer of one element and the storage of the run length queue,     *
+* which is aligned to 'size_t'.                                                *
+*******************************************************************************/
+static size_t* get_queue_storage(char* swap_buffer, const size_t size)
+{
+    const uintptr_t alignment = _Alignof(size_t);
+    const uintptr_t address = (uintptr_t)(swap_buffer + size);
+    return (size_t*)(swap_buffer + size + (alignment - address % alignment)
+                                          % alignment);
+}
+
+/*******************************************************************************
+* Builds the run length queue of the array using the scratch memory laid out   *
+* as described above. The merge buffer part of the scratch is left untouched.  *
+*******************************************************************************/
+static void build_run_length_queue_in_scratch(
+                        run_length_queue *const queue,
+                        void* base,
+                        const size_t num,
+                        const size_t size,
+                        const int (*cmp)(const void*, const void*),
+                        char* scratch)
+{
+    char* swap_buffer = scratch + num * size;
+    
+    run_length_queue_init(queue,
+                          get_queue_storage(swap_buffer, size),
+                          get_run_length_queue_capacity(num));
+    
+    build_run_length_queue(queue, base, num, size, cmp, swap_buffer);
+}
+
+size_t stable_sort_scratch_size(const size_t num, const size_t size)
+{
+    if (num < 2)
+    {
+        return 0;
+    }
+    
+    return num * size 
+         + size
+         + _Alignof(size_t) - 1
+         + sizeof(size_t) * get_run_length_queue_capacity(num);
+}
+
+stable_sort_status stable_sort_with_buffer(
+                        void* base,
+                        const size_t num,
+                        const size_t size,
+                        const int (*cmp)(const void*, const void*),
+                        void* scratch,
+                        const size_t scratch_size)
 {
     if (!base || !cmp)
     {
-        return;
+        return STABLE_SORT_INVALID_ARGUMENT;
     }
     
-    char* buffer = malloc(num * size);
+    if (num < 2)
+    {
+        return STABLE_SORT_SUCCESS;
+    }
     
-    if (!buffer)
+    if (!scratch || scratch_size < stable_sort_scratch_size(num, size))
     {
-        fputs("Could not allocate memory for the buffer array.\n", stderr);
-        abort();
+        return STABLE_SORT_BUFFER_TOO_SMALL;
     }
     
-    run_length_queue* queue = build_run_length_queue(base, num, size, cmp);
+    char* buffer = scratch;
+    run_length_queue queue_storage;
+    run_length_queue* queue = &queue_storage;
+    
+    build_run_length_queue_in_scratch(queue, base, num, size, cmp, buffer);
+    
     const size_t merge_passes = get_number_of_merge_passes(
-                                                           run_length_queue_size(queue));
+                                        run_length_queue_size(queue));
     char* source;
     char* target;
     
@@ -356,12 +571,12 @@ void stable_sort(void* base,
         const size_t left_run_length  = run_length_queue_dequeue(queue);
         const size_t right_run_length = run_length_queue_dequeue(queue);
         
-        merge(source_pointer,
-              target_pointer,
-              left_run_length,
-              right_run_length,
-              size,
-              cmp);
+        merge_runs(source_pointer,
+                   target_pointer,
+                   left_run_length,
+                   right_run_length,
+                   size,
+                   cmp);
         
         run_length_queue_enqueue(queue, left_run_length + right_run_length);
         
@@ -396,6 +611,743 @@ void stable_sort(void* base,
         }
     }
     
-    run_length_queue_free(queue);
+    return STABLE_SORT_SUCCESS;
+}
+
+void stable_sort(void* base,
+                 const size_t num,
+                 const size_t size,
+                 const int (*cmp)(const void*, const void*))
+{
+    if (!base || !cmp || num < 2)
+    {
+        return;
+    }
+    
+    const size_t scratch_size = stable_sort_scratch_size(num, size);
+    void* scratch = malloc(scratch_size);
+    
+    if (!scratch)
+    {
+        fputs("Could not allocate memory for the buffer array.\n", stderr);
+        abort();
+    }
+    
+    stable_sort_with_buffer(base, num, size, cmp, scratch, scratch_size);
+    free(scratch);
+}
+
+/*******************************************************************************
+* Swaps the contents of the two non-overlapping ranges of 'bytes' bytes at 'a' *
+* and 'b', going through the buffer of 'buffer_bytes' bytes in chunks.         *
+*******************************************************************************/
+static void swap_ranges(char* a,
+                        char* b,
+                        size_t bytes,
+                        char* buffer,
+                        const size_t buffer_bytes)
+{
+    while (bytes > 0)
+    {
+        const size_t chunk = min(bytes, buffer_bytes);
+        
+        memcpy(buffer, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, buffer, chunk);
+        
+        a += chunk;
+        b += chunk;
+        bytes -= chunk;
+    }
+}
+
+/*******************************************************************************
+* Swaps the adjacent blocks of 'left_length' and 'right_length' elements       *
+* starting from 'base'. Once the shorter block fits in the buffer of           *
+* 'buffer_capacity' elements, it is moved through the buffer. Until then, the  *
+* shorter block is swapped with the far end of the longer one, which puts one  *
+* block in its final place and leaves a smaller rotation.                      *
+*******************************************************************************/
+static void rotate(char* base,
+                   size_t left_length,
+                   size_t right_length,
+                   const size_t size,
+                   char* buffer,
+                   const size_t buffer_capacity)
+{
+    while (left_length > 0 && right_length > 0)
+    {
+        char* middle = base + left_length * size;
+        
+        if (left_length <= right_length && left_length <= buffer_capacity)
+        {
+            memcpy(buffer, base, left_length * size);
+            memmove(base, middle, right_length * size);
+            memcpy(base + right_length * size, buffer, left_length * size);
+            return;
+        }
+        
+        if (right_length <= buffer_capacity)
+        {
+            memcpy(buffer, middle, right_length * size);
+            memmove(base + right_length * size, base, left_length * size);
+            memcpy(base, buffer, right_length * size);
+            return;
+        }
+        
+        if (left_length <= right_length)
+        {
+            swap_ranges(base,
+                        middle,
+                        left_length * size,
+                        buffer,
+                        buffer_capacity * size);
+            base += left_length * size;
+            right_length -= left_length;
+        }
+        else
+        {
+            swap_ranges(middle - right_length * size,
+                        middle,
+                        right_length * size,
+                        buffer,
+                        buffer_capacity * size);
+            left_length -= right_length;
+        }
+    }
+}
+
+/*******************************************************************************
+* Merges the adjacent sorted runs of 'left_run_length' and 'right_run_length'  *
+* elements starting from 'base' in place. If the shorter run fits in the       *
+* buffer of 'buffer_capacity' elements, it is moved there and merged back.     *
+* Otherwise the runs are split around the median of the longer one, the two    *
+* middle parts are rotated past each other, and both halves are merged on      *
+* their own. The smaller half is merged by recursion and the larger one by     *
+* iteration, so the recursion depth stays logarithmic.                         *
+*******************************************************************************/
+static void merge_with_bounded_buffer(
+                        char* base,
+                        size_t left_run_length,
+                        size_t right_run_length,
+                        const size_t size,
+                        const int (*cmp)(const void*, const void*),
+                        char* buffer,
+                        const size_t buffer_capacity)
+{
+    while (left_run_length > 0 && right_run_length > 0)
+    {
+        char* middle = base + left_run_length * size;
+        
+        if (cmp(middle - size, middle) <= 0)
+        {
+            // The runs are already in order:
+            return;
+        }
+        
+        // Leave out the head of the left run and the tail of the right run
+        // that are already in their final places:
+        const size_t left_skip = gallop(middle,
+                                        base,
+                                        left_run_length,
+                                        size,
+                                        true,
+                                        cmp);
+        base += left_skip * size;
+        left_run_length -= left_skip;
+        right_run_length = gallop(middle - size,
+                                  middle,
+                                  right_run_length,
+                                  size,
+                                  false,
+                                  cmp);
+        
+        if (left_run_length <= right_run_length 
+                && left_run_length <= buffer_capacity)
+        {
+            // Merge forwards from the buffer and the right run:
+            memcpy(buffer, base, left_run_length * size);
+            
+            const char* left = buffer;
+            const char* left_upper_bound = buffer + left_run_length * size;
+            const char* right = middle;
+            const char* right_upper_bound = middle + right_run_length * size;
+            char* target = base;
+            
+            while (left != left_upper_bound && right != right_upper_bound)
+            {
+                if (cmp(right, left) < 0)
+                {
+                    memcpy(target, right, size);
+                    right += size;
+                }
+                else
+                {
+                    memcpy(target, left, size);
+                    left += size;
+                }
+                
+                target += size;
+            }
+            
+            // Whatever remains of the right run is already in place:
+            memcpy(target, left, left_upper_bound - left);
+            return;
+        }
+        
+        if (right_run_length <= buffer_capacity)
+        {
+            // Merge backwards from the left run and the buffer:
+            memcpy(buffer, middle, right_run_length * size);
+            
+            const char* left = middle;
+            const char* right = buffer + right_run_length * size;
+            char* target = middle + right_run_length * size;
+            
+            while (left != base && right != buffer)
+            {
+                target -= size;
+                
+                if (cmp(right - size, left - size) < 0)
+                {
+                    left -= size;
+                    memcpy(target, left, size);
+                }
+                else
+                {
+                    right -= size;
+                    memcpy(target, right, size);
+                }
+            }
+            
+            // Whatever remains of the left run is already in place:
+            memcpy(base, buffer, right - buffer);
+            return;
+        }
+        
+        size_t left_cut;
+        size_t right_cut;
+        
+        if (left_run_length > right_run_length)
+        {
+            left_cut = left_run_length / 2;
+            right_cut = gallop(base + left_cut * size,
+                               middle,
+                               right_run_length,
+                               size,
+                               false,
+                               cmp);
+        }
+        else
+        {
+            right_cut = right_run_length / 2;
+            left_cut = gallop(middle + right_cut * size,
+                              base,
+                              left_run_length,
+                              size,
+                              true,
+                              cmp);
+        }
+        
+        rotate(base + left_cut * size,
+               left_run_length - left_cut,
+               right_cut,
+               size,
+               buffer,
+               buffer_capacity);
+        
+        // Now [base, base + left_cut + right_cut) holds the first half of the
+        // merge and the rest holds the second half:
+        char* second_half = base + (left_cut + right_cut) * size;
+        const size_t second_left_run_length  = left_run_length - left_cut;
+        const size_t second_right_run_length = right_run_length - right_cut;
+        
+        if (left_cut + right_cut 
+                < second_left_run_length + second_right_run_length)
+        {
+            merge_with_bounded_buffer(base,
+                                      left_cut,
+                                      right_cut,
+                                      size,
+                                      cmp,
+                                      buffer,
+                                      buffer_capacity);
+            base = second_half;
+            left_run_length  = second_left_run_length;
+            right_run_length = second_right_run_length;
+        }
+        else
+        {
+            merge_with_bounded_buffer(second_half,
+                                      second_left_run_length,
+                                      second_right_run_length,
+                                      size,
+                                      cmp,
+                                      buffer,
+                                      buffer_capacity);
+            left_run_length  = left_cut;
+            right_run_length = right_cut;
+        }
+    }
+}
+
+// Returns the smallest integer whose square is at least 'number':
+static size_t get_square_root_ceiling(const size_t number)
+{
+    size_t lo = 0;
+    size_t hi = (size_t) 1 << (sizeof(size_t) * CHAR_BIT / 2);
+    
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        
+        if (mid * mid < number)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    
+    return lo;
+}
+
+void stable_sort_low_memory(void* base,
+                            const size_t num,
+                            const size_t size,
+                            const int (*cmp)(const void*, const void*))
+{
+    if (!base || !cmp || num < 2)
+    {
+        return;
+    }
+    
+    const size_t buffer_capacity = get_square_root_ceiling(num);
+    
+    // One more element serves as the swap buffer:
+    char* buffer = malloc((buffer_capacity + 1) * size);
+    
+    if (!buffer)
+    {
+        fputs("Could not allocate memory for the buffer array.\n", stderr);
+        abort();
+    }
+    
+    char* swap_buffer = buffer + buffer_capacity * size;
+    char* array = base;
+    
+    // No run length queue here, since it would need memory linear in 'num'.
+    // Sort fixed blocks instead, starting each from its natural run:
+    for (size_t i = 0; i < num; i += MINIMUM_RUN_LENGTH)
+    {
+        char* head = array + i * size;
+        const size_t block_length = min(MINIMUM_RUN_LENGTH, num - i);
+        const size_t run_length = scan_run(head,
+                                           block_length,
+                                           size,
+                                           cmp,
+                                           swap_buffer);
+        
+        binary_insertion_sort(head,
+                              run_length,
+                              block_length,
+                              size,
+                              cmp,
+                              swap_buffer);
+    }
+    
+    for (size_t width = MINIMUM_RUN_LENGTH; width < num; width *= 2)
+    {
+        for (size_t i = 0; i + width < num; i += 2 * width)
+        {
+            merge_with_bounded_buffer(array + i * size,
+                                      width,
+                                      min(width, num - i - width),
+                                      size,
+                                      cmp,
+                                      buffer,
+                                      buffer_capacity);
+        }
+    }
+    
     free(buffer);
 }
+
+typedef struct loser_tree
+{
+    const char** heads;
+    const char** upper_bounds;
+    size_t* nodes; // nodes[0] is the winner, the rest hold the losers.
+    size_t leaves;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+}
+loser_tree;
+
+/*******************************************************************************
+* Returns true if the head of run 'a' goes before the head of run 'b' in a     *
+* stable merge. Exhausted runs lose to every other run, and ties go to the run *
+* that comes first in the array.                                               *
+*******************************************************************************/
+static inline bool loser_tree_beats(const loser_tree *const tree,
+                                    const size_t a,
+                                    const size_t b)
+{
+    if (tree->heads[a] == tree->upper_bounds[a])
+    {
+        return false;
+    }
+    
+    if (tree->heads[b] == tree->upper_bounds[b])
+    {
+        return true;
+    }
+    
+    const int c = tree->cmp(tree->heads[a], tree->heads[b]);
+    return c < 0 || (c == 0 && a < b);
+}
+
+/*******************************************************************************
+* Plays the initial tournament. Leaf i sits at the implicit node 'leaves + i', *
+* and the parent of node n is n / 2.                                           *
+*******************************************************************************/
+static void loser_tree_build(loser_tree *const tree, size_t* winners)
+{
+    const size_t leaves = tree->leaves;
+    
+    for (size_t i = 0; i < leaves; ++i)
+    {
+        winners[leaves + i] = i;
+    }
+    
+    for (size_t node = leaves - 1; node > 0; --node)
+    {
+        const size_t a = winners[2 * node];
+        const size_t b = winners[2 * node + 1];
+        
+        if (loser_tree_beats(tree, a, b))
+        {
+            winners[node] = a;
+            tree->nodes[node] = b;
+        }
+        else
+        {
+            winners[node] = b;
+            tree->nodes[node] = a;
+        }
+    }
+    
+    tree->nodes[0] = winners[1];
+}
+
+/*******************************************************************************
+* Replays the matches on the path from the leaf of run 'run' to the root after *
+* the head of the run has advanced.                                            *
+*******************************************************************************/
+static inline void loser_tree_replay(loser_tree *const tree, size_t run)
+{
+    for (size_t node = (tree->leaves + run) / 2; node > 0; node /= 2)
+    {
+        if (loser_tree_beats(tree, tree->nodes[node], run))
+        {
+            const size_t tmp = tree->nodes[node];
+            tree->nodes[node] = run;
+            run = tmp;
+        }
+    }
+    
+    tree->nodes[0] = run;
+}
+
+/*******************************************************************************
+* Moves the 'total' remaining elements of the runs of the tree to 'target' in  *
+* merged order.                                                                *
+*******************************************************************************/
+static inline void k_way_drain(loser_tree *const tree,
+                               char* target,
+                               const size_t total,
+                               const size_t size)
+{
+    for (size_t i = 0; i < total; ++i)
+    {
+        const size_t winner = tree->nodes[0];
+        
+        memcpy(target, tree->heads[winner], size);
+        target += size;
+        tree->heads[winner] += size;
+        
+        loser_tree_replay(tree, winner);
+    }
+}
+
+/*******************************************************************************
+* Merges the 'runs' adjacent runs starting from 'source' whose lengths are in  *
+* 'run_lengths' into 'target'.                                                 *
+*******************************************************************************/
+static void k_way_merge(const char* source,
+                        char* target,
+                        const size_t* run_lengths,
+                        const size_t runs,
+                        loser_tree *const tree,
+                        size_t* winners)
+{
+    const size_t size = tree->size;
+    size_t total = 0;
+    
+    for (size_t i = 0; i < runs; ++i)
+    {
+        tree->heads[i] = source + total * size;
+        total += run_lengths[i];
+        tree->upper_bounds[i] = source + total * size;
+    }
+    
+    if (runs == 1)
+    {
+        memcpy(target, source, total * size);
+        return;
+    }
+    
+    tree->leaves = runs;
+    loser_tree_build(tree, winners);
+    
+    // Like in 'merge_runs', the common sizes get specialized copies:
+    switch (size)
+    {
+        case 4:
+            k_way_drain(tree, target, total, 4);
+            break;
+            
+        case 8:
+            k_way_drain(tree, target, total, 8);
+            break;
+            
+        case 16:
+            k_way_drain(tree, target, total, 16);
+            break;
+            
+        default:
+            k_way_drain(tree, target, total, size);
+    }
+}
+
+void stable_sort_k_way(void* base,
+                       const size_t num,
+                       const size_t size,
+                       const int (*cmp)(const void*, const void*),
+                       size_t ways)
+{
+    if (!base || !cmp || num < 2)
+    {
+        return;
+    }
+    
+    if (ways <= 2)
+    {
+        stable_sort(base, num, size, cmp);
+        return;
+    }
+    
+    char* scratch = malloc(stable_sort_scratch_size(num, size));
+    
+    if (!scratch)
+    {
+        fputs("Could not allocate memory for the buffer array.\n", stderr);
+        abort();
+    }
+    
+    run_length_queue queue_storage;
+    run_length_queue* queue = &queue_storage;
+    
+    build_run_length_queue_in_scratch(queue, base, num, size, cmp, scratch);
+    
+    const size_t initial_runs = run_length_queue_size(queue);
+    
+    if (ways > initial_runs)
+    {
+        ways = initial_runs;
+    }
+    
+    size_t merge_passes = 0;
+    
+    for (size_t runs = initial_runs; runs > 1; runs = (runs + ways - 1) / ways)
+    {
+        merge_passes++;
+    }
+    
+    loser_tree tree;
+    tree.heads        = malloc(sizeof(char*) * ways);
+    tree.upper_bounds = malloc(sizeof(char*) * ways);
+    tree.nodes        = malloc(sizeof(size_t) * ways);
+    tree.size         = size;
+    tree.cmp          = cmp;
+    
+    size_t* run_lengths = malloc(sizeof(size_t) * ways);
+    size_t* winners     = malloc(sizeof(size_t) * 2 * ways);
+    
+    if (!tree.heads || !tree.upper_bounds || !tree.nodes 
+            || !run_lengths || !winners)
+    {
+        fputs("Could not allocate memory for the loser tree.\n", stderr);
+        abort();
+    }
+    
+    char* source;
+    char* target;
+    
+    if ((merge_passes & 1) == 1)
+    {
+        source = scratch;
+        target = base;
+        memcpy(scratch, base, num * size);
+    }
+    else
+    {
+        source = base;
+        target = scratch;
+    }
+    
+    while (run_length_queue_size(queue) > 1)
+    {
+        size_t remaining_runs = run_length_queue_size(queue);
+        size_t offset = 0;
+        
+        while (remaining_runs > 0)
+        {
+            const size_t runs = min(ways, remaining_runs);
+            size_t run_length = 0;
+            
+            for (size_t i = 0; i < runs; ++i)
+            {
+                run_lengths[i] = run_length_queue_dequeue(queue);
+                run_length += run_lengths[i];
+            }
+            
+            k_way_merge(source + offset,
+                        target + offset,
+                        run_lengths,
+                        runs,
+                        &tree,
+                        winners);
+            
+            run_length_queue_enqueue(queue, run_length);
+            offset += run_length * size;
+            remaining_runs -= runs;
+        }
+        
+        // Swap the roles of the arrays:
+        char* tmp = source;
+        source = target;
+        target = tmp;
+    }
+    
+    free(winners);
+    free(run_lengths);
+    free(tree.nodes);
+    free(tree.upper_bounds);
+    free(tree.heads);
+    free(scratch);
+}
+
+typedef struct indirect_comparison
+{
+    const char* base;
+    size_t size;
+    const int (*cmp)(const void*, const void*);
+}
+indirect_comparison;
+
+// The comparator has no context argument, so the array being argsorted is
+// passed to 'compare_indices' through this per-thread variable:
+static _Thread_local indirect_comparison current_indirect_comparison;
+
+static int compare_indices(const void* a, const void* b)
+{
+    const indirect_comparison* comparison = &current_indirect_comparison;
+    
+    return comparison->cmp(
+            comparison->base + *((const size_t*) a) * comparison->size,
+            comparison->base + *((const size_t*) b) * comparison->size);
+}
+
+void stable_argsort(const void* base,
+                    const size_t num,
+                    const size_t size,
+                    const int (*cmp)(const void*, const void*),
+                    size_t* permutation)
+{
+    if (!base || !cmp || !permutation)
+    {
+        return;
+    }
+    
+    for (size_t i = 0; i < num; ++i)
+    {
+        permutation[i] = i;
+    }
+    
+    // Save the context of an argsort possibly running in a comparator:
+    const indirect_comparison saved_comparison = current_indirect_comparison;
+    
+    current_indirect_comparison.base = base;
+    current_indirect_comparison.size = size;
+    current_indirect_comparison.cmp  = cmp;
+    
+    stable_sort(permutation, num, sizeof(size_t), compare_indices);
+    
+    current_indirect_comparison = saved_comparison;
+}
+
+void apply_permutation(void* base,
+                       const size_t num,
+                       const size_t size,
+                       const size_t* permutation)
+{
+    if (!base || !permutation)
+    {
+        return;
+    }
+    
+    const size_t bits_per_word = sizeof(size_t) * CHAR_BIT;
+    const size_t words = (num + bits_per_word - 1) / bits_per_word;
+    size_t* done = calloc(words + 1, sizeof(size_t));
+    char* swap_buffer = malloc(size);
+    
+    if (!done || !swap_buffer)
+    {
+        fputs("Could not allocate memory for applying the permutation.\n",
+              stderr);
+        abort();
+    }
+    
+    char* array = base;
+    
+    for (size_t i = 0; i < num; ++i)
+    {
+        if ((done[i / bits_per_word] >> (i % bits_per_word)) & 1)
+        {
+            continue;
+        }
+        
+        // Follow the cycle through 'i', pulling each element to its place:
+        memcpy(swap_buffer, array + i * size, size);
+        size_t current = i;
+        
+        while (permutation[current] != i)
+        {
+            const size_t next = permutation[current];
+            memcpy(array + current * size, array + next * size, size);
+            done[current / bits_per_word] |= (size_t) 1 << (current 
+                                                            % bits_per_word);
+            current = next;
+        }
+        
+        memcpy(array + current * size, swap_buffer, size);
+        done[current / bits_per_word] |= (size_t) 1 << (current 
+                                                        % bits_per_word);
+    }
+    
+    free(swap_buffer);
+    free(done);
+}
@@ -16,6 +16,96 @@ extern "C" {
                      const size_t size,
                      const int (*comparator)(const void*, const void*));
     
+    typedef enum stable_sort_status
+    {
+        STABLE_SORT_SUCCESS = 0,
+        STABLE_SORT_INVALID_ARGUMENT,
+        STABLE_SORT_BUFFER_TOO_SMALL
+    }
+    stable_sort_status;
+    
+    /***************************************************************************
+    * Returns the number of bytes of scratch memory 'stable_sort_with_buffer'  *
+    * needs for sorting 'num' elements each 'size' bytes long.                 *
+    ***************************************************************************/
+    size_t stable_sort_scratch_size(const size_t num, const size_t size);
+    
+    /***************************************************************************
+    * Sorts the array just like 'stable_sort', but uses the 'scratch_size'     *
+    * bytes at 'scratch' instead of allocating memory, and never aborts.       *
+    * Returns STABLE_SORT_BUFFER_TOO_SMALL without touching the array if the   *
+    * scratch memory is smaller than 'stable_sort_scratch_size' requires, and  *
+    * STABLE_SORT_INVALID_ARGUMENT if 'base' or 'comparator' is NULL. Since    *
+    * the comparator is also called on elements in the scratch memory, the     *
+    * scratch memory must be aligned for the element type (memory returned by  *
+    * 'malloc' always is). It may be reused between calls.                     *
+    ***************************************************************************/
+    stable_sort_status stable_sort_with_buffer(
+                            void* base,
+                            const size_t num,
+                            const size_t size,
+                            const int (*comparator)(const void*, const void*),
+                            void* scratch,
+                            const size_t scratch_size);
+    
+    /***************************************************************************
+    * Sorts the array just like 'stable_sort', but with a buffer of about      *
+    * sqrt(num) elements instead of 'num' elements, for arrays too large to    *
+    * have their size in extra memory. Runs that do not fit in the buffer are  *
+    * merged in place by splitting them with binary search and rotating the    *
+    * middle parts, which moves each element O(log num) times per merge pass.  *
+    * This sort is stable. It aborts if it cannot allocate its buffer.         *
+    ***************************************************************************/
+    void stable_sort_low_memory(void* base,
+                                const size_t num,
+                                const size_t size,
+                                const int (*comparator)(const void*,
+                                                        const void*));
+    
+    /***************************************************************************
+    * Sorts the array just like 'stable_sort', but merges up to 'ways' runs at *
+    * a time using a tournament (loser) tree instead of merging pairs of runs. *
+    * This reduces the number of passes over the array from log2(runs) to      *
+    * log_ways(runs) at the cost of no galloping and of log2(ways)             *
+    * comparisons per element. It pays off when moving the elements costs      *
+    * more than comparing them, such as with elements of 256 bytes and more;   *
+    * for small elements 'stable_sort' is about twice as fast. With 'ways' of  *
+    * 2 or less this is 'stable_sort'. With 'ways' of at least the number of   *
+    * runs, such as SIZE_MAX, all runs are merged in a single pass.            *
+    ***************************************************************************/
+    void stable_sort_k_way(void* base,
+                           const size_t num,
+                           const size_t size,
+                           const int (*comparator)(const void*, const void*),
+                           size_t ways);
+    
+    /***************************************************************************
+    * Stores in 'permutation' the indices of the 'num' elements starting from  *
+    * 'base' in the order in which the elements would appear after a stable    *
+    * sort. The array itself is not modified; only the indices are moved.      *
+    * Each comparison reads two elements from scattered places in the array,   *
+    * so together with 'apply_permutation' this beats 'stable_sort' only for   *
+    * elements of about 1 KiB and more, or 512 bytes with many equal keys.     *
+    * For smaller ones it is several times slower. 'permutation' must have     *
+    * room for 'num' indices.                                                  *
+    ***************************************************************************/
+    void stable_argsort(const void* base,
+                        const size_t num,
+                        const size_t size,
+                        const int (*comparator)(const void*, const void*),
+                        size_t* permutation);
+    
+    /***************************************************************************
+    * Rearranges the 'num' elements starting from 'base' in place so that the  *
+    * element at index i moves to index j such that permutation[j] == i. This  *
+    * is the order computed by 'stable_argsort'. The cycles of the             *
+    * permutation are followed so that each element is moved only once.        *
+    ***************************************************************************/
+    void apply_permutation(void* base,
+                           const size_t num,
+                           const size_t size,
+                           const size_t* permutation);
+    
 #ifdef	__cplusplus
 }
 #endif
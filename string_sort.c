@@ -0,0 +1,172 @@
+#include "string_sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Buckets at most this large are finished by insertion sort:
+static const size_t INSERTION_SORT_THRESHOLD = 32;
+
+// The number of distinct byte values:
+#define ALPHABET_SIZE 256
+
+typedef struct bucket
+{
+    size_t begin;
+    size_t end;
+    size_t depth;
+}
+bucket;
+
+typedef struct bucket_stack
+{
+    bucket* storage;
+    size_t size;
+    size_t capacity;
+}
+bucket_stack;
+
+static void bucket_stack_push(bucket_stack *const stack,
+                              const size_t begin,
+                              const size_t end,
+                              const size_t depth)
+{
+    if (stack->size == stack->capacity)
+    {
+        stack->capacity *= 2;
+        stack->storage = realloc(stack->storage,
+                                 sizeof(bucket) * stack->capacity);
+
+        if (!stack->storage)
+        {
+            fputs("Could not allocate memory for the bucket stack.\n",
+                  stderr);
+            abort();
+        }
+    }
+
+    stack->storage[stack->size].begin = begin;
+    stack->storage[stack->size].end   = end;
+    stack->storage[stack->size].depth = depth;
+    stack->size++;
+}
+
+/*******************************************************************************
+* Sorts the 'num' strings starting from 'strings' that share their first       *
+* 'depth' bytes. Each string is inserted after the strings equal to it.        *
+*******************************************************************************/
+static void insertion_sort(const char** strings,
+                           const size_t num,
+                           const size_t depth)
+{
+    for (size_t i = 1; i < num; ++i)
+    {
+        const char* string = strings[i];
+        size_t j = i;
+
+        while (j > 0 && strcmp(string + depth, strings[j - 1] + depth) < 0)
+        {
+            strings[j] = strings[j - 1];
+            j--;
+        }
+
+        strings[j] = string;
+    }
+}
+
+void string_sort(const char** strings, const size_t num)
+{
+    if (!strings || num < 2)
+    {
+        return;
+    }
+
+    const char** buffer = malloc(sizeof(const char*) * num);
+    unsigned char* bytes = malloc(num);
+    bucket_stack stack;
+    stack.capacity = 64;
+    stack.size = 0;
+    stack.storage = malloc(sizeof(bucket) * stack.capacity);
+
+    if (!buffer || !bytes || !stack.storage)
+    {
+        fputs("Could not allocate memory for the buffer array.\n", stderr);
+        abort();
+    }
+
+    size_t counts[ALPHABET_SIZE];
+    size_t offsets[ALPHABET_SIZE];
+
+    bucket_stack_push(&stack, 0, num, 0);
+
+    while (stack.size > 0)
+    {
+        const bucket current = stack.storage[--stack.size];
+        const char** bucket_strings = strings + current.begin;
+        const size_t bucket_length = current.end - current.begin;
+        const size_t depth = current.depth;
+
+        if (bucket_length <= INSERTION_SORT_THRESHOLD)
+        {
+            insertion_sort(bucket_strings, bucket_length, depth);
+            continue;
+        }
+
+        memset(counts, 0, sizeof(counts));
+
+        for (size_t i = 0; i < bucket_length; ++i)
+        {
+            bytes[i] = (unsigned char) bucket_strings[i][depth];
+            counts[bytes[i]]++;
+        }
+
+        // If all strings share the byte, there is nothing to distribute. The
+        // bucket is done if the byte ends the strings, and goes on to the next
+        // byte otherwise:
+        if (counts[bytes[0]] == bucket_length)
+        {
+            if (bytes[0] != '\0')
+            {
+                bucket_stack_push(&stack,
+                                  current.begin,
+                                  current.end,
+                                  depth + 1);
+            }
+
+            continue;
+        }
+
+        size_t offset = 0;
+
+        for (size_t c = 0; c < ALPHABET_SIZE; ++c)
+        {
+            offsets[c] = offset;
+            offset += counts[c];
+        }
+
+        // Distribute stably into the buffer and copy back:
+        for (size_t i = 0; i < bucket_length; ++i)
+        {
+            buffer[offsets[bytes[i]]++] = bucket_strings[i];
+        }
+
+        memcpy(bucket_strings, buffer, sizeof(const char*) * bucket_length);
+
+        // The strings that ended at this byte are sorted. The other buckets
+        // continue from the next byte:
+        size_t begin = current.begin + counts[0];
+
+        for (size_t c = 1; c < ALPHABET_SIZE; ++c)
+        {
+            if (counts[c] > 1)
+            {
+                bucket_stack_push(&stack, begin, begin + counts[c], depth + 1);
+            }
+
+            begin += counts[c];
+        }
+    }
+
+    free(stack.storage);
+    free(bytes);
+    free(buffer);
+}
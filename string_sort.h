@@ -0,0 +1,23 @@
+#ifndef STRING_SORT_H
+#define STRING_SORT_H
+#include <stdlib.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    /***************************************************************************
+    * Sorts an array of 'num' null-terminated strings starting from 'strings'  *
+    * into the order of 'strcmp'. The array is sorted by MSD radix sort, one   *
+    * byte at a time, so common prefixes are examined once per bucket instead  *
+    * of once per comparison. Buckets of at most 32 strings are finished by    *
+    * insertion sort. This sort is stable, i.e., equal strings keep their      *
+    * relative order. Aborts if it cannot allocate its buffers.                *
+    ***************************************************************************/
+    void string_sort(const char** strings, const size_t num);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* STRING_SORT_H */
@@ -0,0 +1,324 @@
+#ifndef TYPED_STABLE_SORT_H
+#define TYPED_STABLE_SORT_H
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+* STABLE_SORT_DEFINE(name, type, less) defines the function                    *
+*                                                                              *
+*     static void name(type* base, size_t num);                                *
+*                                                                              *
+* which sorts 'num' elements starting from 'base' with the same natural merge  *
+* sort as 'stable_sort', but with the comparisons and element moves inlined    *
+* for the concrete element type. 'less' is an expression over the two          *
+* elements 'a' and 'b' (of type 'type') that is true if 'a' must precede 'b'.  *
+* For example:                                                                 *
+*                                                                              *
+*     STABLE_SORT_DEFINE(sort_int64, int64_t, a < b)                           *
+*     STABLE_SORT_DEFINE(sort_by_key, record, a.key < b.key)                   *
+*                                                                              *
+* The sort is stable. It aborts if it cannot allocate its buffer.              *
+*******************************************************************************/
+
+#ifndef TYPED_STABLE_SORT_MINIMUM_RUN_LENGTH
+#define TYPED_STABLE_SORT_MINIMUM_RUN_LENGTH 32
+#endif
+
+typedef struct typed_run_length_queue
+{
+    size_t* storage;
+    size_t head;
+    size_t tail;
+    size_t size;
+    size_t mask;
+}
+typed_run_length_queue;
+
+/*******************************************************************************
+* Returns the capacity of the run length queue for an array of 'num' elements. *
+* All runs but the last one are at least the minimum run length long.          *
+*******************************************************************************/
+static inline size_t typed_run_length_queue_capacity(const size_t num)
+{
+    const size_t capacity = num / TYPED_STABLE_SORT_MINIMUM_RUN_LENGTH + 1;
+    size_t ret = 1;
+
+    while (ret < capacity)
+    {
+        ret <<= 1;
+    }
+
+    return ret;
+}
+
+static inline void typed_run_length_queue_init(
+                        typed_run_length_queue *const queue,
+                        size_t* storage,
+                        const size_t capacity)
+{
+    queue->storage = storage;
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->size = 0;
+}
+
+static inline void typed_run_length_queue_add_to_last(
+                        typed_run_length_queue *const queue,
+                        const size_t run_length)
+{
+    queue->storage[(queue->tail - 1) & queue->mask] += run_length;
+}
+
+static inline void typed_run_length_queue_enqueue(
+                        typed_run_length_queue *const queue,
+                        const size_t run_length)
+{
+    queue->storage[queue->tail] = run_length;
+    queue->tail = (queue->tail + 1) & queue->mask;
+    queue->size++;
+}
+
+static inline size_t typed_run_length_queue_dequeue(
+                        typed_run_length_queue *const queue)
+{
+    const size_t run_length = queue->storage[queue->head];
+    queue->head = (queue->head + 1) & queue->mask;
+    queue->size--;
+    return run_length;
+}
+
+static inline size_t typed_stable_sort_merge_passes(size_t runs)
+{
+    size_t passes = 0;
+
+    while (runs > 1)
+    {
+        runs = (runs + 1) / 2;
+        passes++;
+    }
+
+    return passes;
+}
+
+static inline size_t typed_stable_sort_align(const size_t bytes,
+                                             const size_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+#define STABLE_SORT_DEFINE(name, type, less)                                   \
+                                                                               \
+static inline bool name##_is_less(const type a, const type b)                  \
+{                                                                              \
+    return (less);                                                             \
+}                                                                              \
+                                                                               \
+/* Finds the run starting from 'head' and reverses it if strictly            */\
+/* descending. Returns the length of the run.                                */\
+static inline size_t name##_scan_run(type* head, const size_t num)             \
+{                                                                              \
+    size_t run_length = 2;                                                     \
+                                                                               \
+    if (num == 1)                                                              \
+    {                                                                          \
+        return 1;                                                              \
+    }                                                                          \
+                                                                               \
+    if (!name##_is_less(head[1], head[0]))                                     \
+    {                                                                          \
+        while (run_length < num                                                \
+                && !name##_is_less(head[run_length], head[run_length - 1]))    \
+        {                                                                      \
+            run_length++;                                                      \
+        }                                                                      \
+    }                                                                          \
+    else                                                                       \
+    {                                                                          \
+        while (run_length < num                                                \
+                && name##_is_less(head[run_length], head[run_length - 1]))     \
+        {                                                                      \
+            run_length++;                                                      \
+        }                                                                      \
+                                                                               \
+        type* left  = head;                                                    \
+        type* right = head + run_length - 1;                                   \
+                                                                               \
+        while (left < right)                                                   \
+        {                                                                      \
+            type tmp = *left;                                                  \
+            *left++  = *right;                                                 \
+            *right-- = tmp;                                                    \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    return run_length;                                                         \
+}                                                                              \
+                                                                               \
+/* Extends the sorted prefix of 'sorted_length' elements to 'num' elements   */\
+/* by stable binary insertion.                                               */\
+static inline void name##_insertion_sort(type* head,                           \
+                                         const size_t sorted_length,           \
+                                         const size_t num)                     \
+{                                                                              \
+    for (size_t i = sorted_length; i < num; ++i)                               \
+    {                                                                          \
+        const type element = head[i];                                          \
+        size_t lo = 0;                                                         \
+        size_t hi = i;                                                         \
+                                                                               \
+        while (lo < hi)                                                        \
+        {                                                                      \
+            const size_t mid = lo + (hi - lo) / 2;                             \
+                                                                               \
+            if (name##_is_less(element, head[mid]))                            \
+            {                                                                  \
+                hi = mid;                                                      \
+            }                                                                  \
+            else                                                               \
+            {                                                                  \
+                lo = mid + 1;                                                  \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        memmove(head + lo + 1, head + lo, (i - lo) * sizeof(type));            \
+        head[lo] = element;                                                    \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static inline void name##_merge(const type* left,                              \
+                                const type* right,                             \
+                                const type *const right_upper_bound,           \
+                                type* target)                                  \
+{                                                                              \
+    const type *const left_upper_bound = right;                                \
+                                                                               \
+    while (left != left_upper_bound && right != right_upper_bound)             \
+    {                                                                          \
+        if (name##_is_less(*right, *left))                                     \
+        {                                                                      \
+            *target++ = *right++;                                              \
+        }                                                                      \
+        else                                                                   \
+        {                                                                      \
+            *target++ = *left++;                                               \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    memcpy(target, left, (left_upper_bound - left) * sizeof(type));            \
+    target += left_upper_bound - left;                                         \
+    memcpy(target, right, (right_upper_bound - right) * sizeof(type));         \
+}                                                                              \
+                                                                               \
+static void name(type* base, const size_t num)                                 \
+{                                                                              \
+    if (!base || num < 2)                                                      \
+    {                                                                          \
+        return;                                                                \
+    }                                                                          \
+                                                                               \
+    const size_t capacity = typed_run_length_queue_capacity(num);              \
+    const size_t queue_bytes = typed_stable_sort_align(sizeof(size_t)          \
+                                                       * capacity,             \
+                                                       _Alignof(type));        \
+    char* scratch = malloc(queue_bytes + sizeof(type) * num);                  \
+                                                                               \
+    if (!scratch)                                                              \
+    {                                                                          \
+        fputs("Could not allocate memory for the buffer array.\n", stderr);    \
+        abort();                                                               \
+    }                                                                          \
+                                                                               \
+    typed_run_length_queue queue;                                              \
+    typed_run_length_queue_init(&queue, (size_t*) scratch, capacity);          \
+    type* buffer = (type*)(scratch + queue_bytes);                             \
+                                                                               \
+    /* Build the runs, extending the short ones by insertion sort: */          \
+    type* head = base;                                                         \
+    size_t remaining = num;                                                    \
+                                                                               \
+    while (remaining)                                                          \
+    {                                                                          \
+        size_t run_length = name##_scan_run(head, remaining);                  \
+                                                                               \
+        if (run_length < TYPED_STABLE_SORT_MINIMUM_RUN_LENGTH)                 \
+        {                                                                      \
+            const size_t extended_run_length =                                 \
+                    remaining < TYPED_STABLE_SORT_MINIMUM_RUN_LENGTH ?         \
+                    remaining : TYPED_STABLE_SORT_MINIMUM_RUN_LENGTH;          \
+                                                                               \
+            name##_insertion_sort(head, run_length, extended_run_length);      \
+            run_length = extended_run_length;                                  \
+        }                                                                      \
+                                                                               \
+        if (queue.size > 0 && !name##_is_less(head[0], head[-1]))              \
+        {                                                                      \
+            typed_run_length_queue_add_to_last(&queue, run_length);            \
+        }                                                                      \
+        else                                                                   \
+        {                                                                      \
+            typed_run_length_queue_enqueue(&queue, run_length);                \
+        }                                                                      \
+                                                                               \
+        head      += run_length;                                               \
+        remaining -= run_length;                                               \
+    }                                                                          \
+                                                                               \
+    /* Choose the roles so that the last pass writes into 'base': */           \
+    type* source;                                                              \
+    type* target;                                                              \
+                                                                               \
+    if (typed_stable_sort_merge_passes(queue.size) & 1)                        \
+    {                                                                          \
+        source = buffer;                                                       \
+        target = base;                                                         \
+        memcpy(buffer, base, sizeof(type) * num);                              \
+    }                                                                          \
+    else                                                                       \
+    {                                                                          \
+        source = base;                                                         \
+        target = buffer;                                                       \
+    }                                                                          \
+                                                                               \
+    while (queue.size > 1)                                                     \
+    {                                                                          \
+        size_t runs = queue.size;                                              \
+        size_t offset = 0;                                                     \
+                                                                               \
+        for (; runs > 1; runs -= 2)                                            \
+        {                                                                      \
+            const size_t left_run_length =                                     \
+                    typed_run_length_queue_dequeue(&queue);                    \
+            const size_t right_run_length =                                    \
+                    typed_run_length_queue_dequeue(&queue);                    \
+            const size_t run_length = left_run_length + right_run_length;      \
+                                                                               \
+            name##_merge(source + offset,                                      \
+                         source + offset + left_run_length,                    \
+                         source + offset + run_length,                         \
+                         target + offset);                                     \
+                                                                               \
+            typed_run_length_queue_enqueue(&queue, run_length);                \
+            offset += run_length;                                              \
+        }                                                                      \
+                                                                               \
+        if (runs == 1)                                                         \
+        {                                                                      \
+            const size_t run_length = typed_run_length_queue_dequeue(&queue);  \
+            memcpy(target + offset,                                            \
+                   source + offset,                                            \
+                   sizeof(type) * run_length);                                 \
+            typed_run_length_queue_enqueue(&queue, run_length);                \
+        }                                                                      \
+                                                                               \
+        type* tmp = source;                                                    \
+        source = target;                                                       \
+        target = tmp;                                                          \
+    }                                                                          \
+                                                                               \
+    free(scratch);                                                             \
+}
+
+#endif /* TYPED_STABLE_SORT_H */
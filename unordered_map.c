@@ -1,17 +1,36 @@
 #include "unordered_map.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct unordered_map_entry {
     void*                       key;
     void*                       value;
+    size_t                      hash;
     struct unordered_map_entry* chain_next;
     struct unordered_map_entry* prev;
     struct unordered_map_entry* next;
 } unordered_map_entry;
 
+/*******************************************************************************
+* Entries are carved out of slabs owned by the map instead of being allocated  *
+* one by one. Removed entries go to a free list, linked through 'chain_next',  *
+* and are reused before the newest slab is bumped.                             *
+*******************************************************************************/
+typedef struct unordered_map_slab {
+    struct unordered_map_slab* next;
+    size_t                     capacity;
+    size_t                     used;
+    unordered_map_entry        entries[];
+} unordered_map_slab;
+
 struct unordered_map {
     unordered_map_entry** table;
+    unordered_map_entry** old_table; /* Non-NULL while migrating. */
+    unordered_map_slab*   slabs;
+    unordered_map_entry*  free_entries;
     unordered_map_entry*  head;
     unordered_map_entry*  tail;
     size_t              (*hash_function)(void*);
@@ -20,8 +39,14 @@ struct unordered_map {
     size_t                table_capacity;
     size_t                size;
     size_t                max_allowed_size;
+    size_t                min_allowed_size;
     size_t                mask;
+    size_t                old_table_capacity;
+    size_t                old_mask;
+    size_t                migration_index;
+    size_t                rehash_step;
     float                 load_factor;
+    float                 low_water_mark;
 };
 
 struct unordered_map_iterator {
@@ -31,9 +56,94 @@ struct unordered_map_iterator {
     size_t               expected_mod_count;
 };
 
-static unordered_map_entry* unordered_map_entry_alloc(void* key, void* value)
+static const size_t MINIMUM_SLAB_CAPACITY = 16;
+static const size_t MAXIMUM_SLAB_CAPACITY = 1 << 16;
+
+/* How many keys ahead 'unordered_map_put_all' prefetches the buckets. */
+static const size_t PREFETCH_DISTANCE = 8;
+
+/* How many keys 'unordered_map_get_batch' keeps in flight. */
+#define BATCH_GROUP_SIZE 32
+
+/*******************************************************************************
+* Returns a fresh entry from the free list or the newest slab, allocating a    *
+* new slab twice as large as the previous one if both are exhausted. Returns   *
+* NULL if out of memory.                                                       *
+*******************************************************************************/
+static unordered_map_entry* unordered_map_entry_take(unordered_map* map)
 {
-    unordered_map_entry* entry = malloc(sizeof(*entry));
+    unordered_map_entry* entry;
+    unordered_map_slab*  slab;
+    size_t capacity;
+
+    if (map->free_entries)
+    {
+        entry = map->free_entries;
+        map->free_entries = entry->chain_next;
+        return entry;
+    }
+
+    slab = map->slabs;
+
+    if (!slab || slab->used == slab->capacity)
+    {
+        capacity = slab ? 2 * slab->capacity : MINIMUM_SLAB_CAPACITY;
+
+        if (capacity > MAXIMUM_SLAB_CAPACITY)
+        {
+            capacity = MAXIMUM_SLAB_CAPACITY;
+        }
+
+        slab = malloc(sizeof(*slab) + capacity * sizeof(unordered_map_entry));
+
+        if (!slab)
+        {
+            return NULL;
+        }
+
+        slab->capacity = capacity;
+        slab->used     = 0;
+        slab->next     = map->slabs;
+        map->slabs     = slab;
+    }
+
+    return &slab->entries[slab->used++];
+}
+
+/*******************************************************************************
+* Returns an entry to the free list of its map.                                *
+*******************************************************************************/
+static void unordered_map_entry_release(unordered_map* map,
+                                        unordered_map_entry* entry)
+{
+    entry->chain_next = map->free_entries;
+    map->free_entries = entry;
+}
+
+/*******************************************************************************
+* Deallocates all the slabs of the map, and with them all the entries.         *
+*******************************************************************************/
+static void free_slabs(unordered_map* map)
+{
+    unordered_map_slab* slab;
+    unordered_map_slab* next_slab;
+
+    for (slab = map->slabs; slab; slab = next_slab)
+    {
+        next_slab = slab->next;
+        free(slab);
+    }
+
+    map->slabs        = NULL;
+    map->free_entries = NULL;
+}
+
+static unordered_map_entry* unordered_map_entry_alloc(unordered_map* map,
+                                                      void* key, 
+                                                      void* value,
+                                                      size_t hash)
+{
+    unordered_map_entry* entry = unordered_map_entry_take(map);
 
     if (!entry) 
     {
@@ -42,6 +152,7 @@ static unordered_map_entry* unordered_map_entry_alloc(void* key, void* value)
     
     entry->key        = key;
     entry->value      = value;
+    entry->hash       = hash;
     entry->chain_next = NULL;
     entry->next       = NULL;
     entry->prev       = NULL;
@@ -117,88 +228,367 @@ unordered_map* unordered_map_alloc(size_t initial_capacity,
     map->mod_count        = 0;
     map->head             = NULL;
     map->tail             = NULL;
+    map->slabs            = NULL;
+    map->free_entries     = NULL;
     map->table            = calloc(initial_capacity, 
                                    sizeof(unordered_map_entry*));
+    map->old_table        = NULL;
+    map->migration_index  = 0;
+    map->rehash_step      = 0;
     map->hash_function    = hash_function;
     map->equals_function  = equals_function;
     map->mask             = initial_capacity - 1;
     map->max_allowed_size = (size_t)(initial_capacity * load_factor);
+    map->min_allowed_size = 0;
+    map->low_water_mark   = 0.0f;
 
     return map;
 }
 
-static void ensure_capacity(unordered_map* map) 
+/*******************************************************************************
+* Moves the chains of at most 'buckets' buckets of the old table to the        *
+* current table, and frees the old table once it has been emptied.             *
+*******************************************************************************/
+static void migrate_buckets(unordered_map* map, size_t buckets)
 {
-    size_t new_capacity;
-    size_t new_mask;
     size_t index;
     unordered_map_entry* entry;
-    unordered_map_entry** new_table;
+    unordered_map_entry* next_entry;
 
-    if (map->size < map->max_allowed_size) 
+    for (; map->old_table && buckets > 0; --buckets)
+    {
+        entry = map->old_table[map->migration_index];
+
+        while (entry)
+        {
+            next_entry = entry->chain_next;
+            index = entry->hash & map->mask;
+            entry->chain_next = map->table[index];
+            map->table[index] = entry;
+            entry = next_entry;
+        }
+
+        if (++map->migration_index == map->old_table_capacity)
+        {
+            free(map->old_table);
+            map->old_table = NULL;
+        }
+    }
+}
+
+/*******************************************************************************
+* Runs the migration step of one insertion or removal. The step is raised      *
+* above 'rehash_step' whenever needed to empty the old table before the map    *
+* can next grow or shrink, so that 'ensure_capacity' and 'shrink_if_sparse'    *
+* never find a migration still running and no operation pays for more than     *
+* its share of the rehash.                                                     *
+*******************************************************************************/
+static void migrate_step(unordered_map* map)
+{
+    size_t remaining;
+    size_t operations;
+    size_t shrink_operations;
+    size_t step;
+
+    if (!map->old_table)
     {
         return;
     }
-    
-    new_capacity = 2 * map->table_capacity;
-    new_mask     = new_capacity - 1;
-    new_table    = calloc(new_capacity, sizeof(unordered_map_entry*));
+
+    /* The number of insertions or removals left before the next resize. */
+    remaining  = map->old_table_capacity - map->migration_index;
+    operations = map->size < map->max_allowed_size 
+               ? map->max_allowed_size - map->size 
+               : 1;
+
+    /* With a low-water mark, removals may shrink the table sooner. */
+    if (map->min_allowed_size > 0)
+    {
+        shrink_operations = map->size >= map->min_allowed_size 
+                          ? map->size - map->min_allowed_size + 1 
+                          : 1;
+
+        if (shrink_operations < operations)
+        {
+            operations = shrink_operations;
+        }
+    }
+
+    step = (remaining + operations - 1) / operations;
+    migrate_buckets(map, step > map->rehash_step ? step : map->rehash_step);
+}
+
+/*******************************************************************************
+* Returns the bucket that holds, or would hold, the keys with hash value       *
+* 'hash_value'. While migrating, a key stays in its old bucket until that      *
+* bucket is migrated, so that every key has exactly one bucket to look in.     *
+*******************************************************************************/
+static unordered_map_entry** get_bucket(unordered_map* map, size_t hash_value)
+{
+    size_t index;
+
+    if (map->old_table)
+    {
+        index = hash_value & map->old_mask;
+
+        if (index >= map->migration_index)
+        {
+            return &map->old_table[index];
+        }
+    }
+
+    return &map->table[hash_value & map->mask];
+}
+
+/*******************************************************************************
+* Replaces the table with an empty one of 'new_capacity' buckets. If           *
+* 'incremental' is true, the current table is kept as the old table to be      *
+* migrated gradually. Otherwise the entries are relinked into the new table    *
+* right away. Returns false and leaves the map intact if out of memory.        *
+*******************************************************************************/
+static bool resize_table(unordered_map* map, 
+                         size_t new_capacity, 
+                         bool incremental)
+{
+    size_t new_mask;
+    size_t index;
+    unordered_map_entry* entry;
+    unordered_map_entry** new_table;
+
+    new_mask  = new_capacity - 1;
+    new_table = calloc(new_capacity, sizeof(unordered_map_entry*));
     
     if (!new_table)
     {
-        return;
+        return false;
     }
     
-    /* Rehash the entries. */
-    for (entry = map->head; entry; entry = entry->next)
+    if (incremental)
     {
-        index = map->hash_function(entry->key) & new_mask;
-        entry->chain_next = new_table[index];
-        new_table[index] = entry;
+        map->old_table          = map->table;
+        map->old_table_capacity = map->table_capacity;
+        map->old_mask           = map->mask;
+        map->migration_index    = 0;
     }
+    else
+    {
+        /* Relink the entries using their cached hash values. */
+        for (entry = map->head; entry; entry = entry->next)
+        {
+            index = entry->hash & new_mask;
+            entry->chain_next = new_table[index];
+            new_table[index] = entry;
+        }
 
-    free(map->table);
+        free(map->table);
+    }
     
     map->table            = new_table;
     map->table_capacity   = new_capacity;
     map->mask             = new_mask;
     map->max_allowed_size = (size_t)(new_capacity * map->load_factor);
+    map->min_allowed_size = (size_t)(new_capacity * map->low_water_mark);
+    return true;
 }
 
-void* unordered_map_put(unordered_map* map, void* key, void* value)
+static void ensure_capacity(unordered_map* map) 
 {
-    size_t index;
-    size_t hash_value;
-    void* old_value;
-    unordered_map_entry* entry;
-
-    if (!map) 
+    if (map->size < map->max_allowed_size) 
     {
-        return NULL;
+        return;
     }
     
-    hash_value = map->hash_function(key);
-    index = hash_value & map->mask;
+    migrate_buckets(map, map->old_table_capacity);
+    resize_table(map, 2 * map->table_capacity, map->rehash_step > 0);
+}
+
+/*******************************************************************************
+* Makes sure that the newest slab has room for 'count' more entries. The rest  *
+* of a too small newest slab goes to the free list, since only the newest      *
+* slab is bumped. Returns false if out of memory.                              *
+*******************************************************************************/
+static bool reserve_entries(unordered_map* map, size_t count)
+{
+    unordered_map_slab* slab = map->slabs;
+
+    if (count == 0 || (slab && slab->capacity - slab->used >= count))
+    {
+        return true;
+    }
 
-    for (entry = map->table[index]; entry; entry = entry->chain_next)
+    if (count > (SIZE_MAX - sizeof(*slab)) / sizeof(unordered_map_entry))
+    {
+        return false;
+    }
+
+    while (slab && slab->used < slab->capacity)
+    {
+        unordered_map_entry_release(map, &slab->entries[slab->used++]);
+    }
+
+    slab = malloc(sizeof(*slab) + count * sizeof(unordered_map_entry));
+
+    if (!slab)
+    {
+        return false;
+    }
+
+    slab->capacity = count;
+    slab->used     = 0;
+    slab->next     = map->slabs;
+    map->slabs     = slab;
+    return true;
+}
+
+bool unordered_map_reserve(unordered_map* map, size_t n)
+{
+    size_t new_capacity;
+
+    if (!map)
     {
-        if (map->equals_function(entry->key, key))
+        return false;
+    }
+
+    migrate_buckets(map, map->old_table_capacity);
+    new_capacity = map->table_capacity;
+
+    while ((size_t)(new_capacity * map->load_factor) < n)
+    {
+        /* No table can hold 'n' mappings within the load factor. */
+        if (new_capacity > SIZE_MAX / 2)
         {
-            old_value = entry->value;
-            entry->value = value;
-            return old_value;
+            return false;
         }
+
+        new_capacity <<= 1;
     }
 
-    ensure_capacity(map);
+    if (new_capacity > map->table_capacity 
+            && !resize_table(map, new_capacity, false))
+    {
+        return false;
+    }
+
+    return reserve_entries(map, n > map->size ? n - map->size : 0);
+}
+
+/*******************************************************************************
+* Halves the table once the map has become sparser than its low-water mark.    *
+*******************************************************************************/
+static void shrink_if_sparse(unordered_map* map)
+{
+    if (map->size >= map->min_allowed_size
+            || map->table_capacity <= MINIMUM_INITIAL_CAPACITY)
+    {
+        return;
+    }
+
+    migrate_buckets(map, map->old_table_capacity);
+    resize_table(map, map->table_capacity / 2, map->rehash_step > 0);
+}
+
+void unordered_map_set_low_water_mark(unordered_map* map, 
+                                      float low_water_mark)
+{
+    if (!map)
+    {
+        return;
+    }
 
-    /* Recompute the index since it is possibly changed by 'ensure_capacity' */
-    index             = hash_value & map->mask;
-    entry             = unordered_map_entry_alloc(key, value);
-    entry->chain_next = map->table[index];
-    map->table[index] = entry;
+    /* The halved table must stay well below the load factor, or the next few
+       insertions would grow it right back. */
+    if (low_water_mark < 0.0f)
+    {
+        low_water_mark = 0.0f;
+    }
+    else if (low_water_mark > map->load_factor / 4)
+    {
+        low_water_mark = map->load_factor / 4;
+    }
+
+    map->low_water_mark   = low_water_mark;
+    map->min_allowed_size = (size_t)(map->table_capacity * low_water_mark);
+}
+
+bool unordered_map_shrink_to_fit(unordered_map* map)
+{
+    size_t new_capacity = MINIMUM_INITIAL_CAPACITY;
+
+    if (!map)
+    {
+        return false;
+    }
+
+    migrate_buckets(map, map->old_table_capacity);
+
+    if (map->size == 0)
+    {
+        free_slabs(map);
+    }
+
+    while ((size_t)(new_capacity * map->load_factor) < map->size)
+    {
+        new_capacity <<= 1;
+    }
+
+    if (new_capacity >= map->table_capacity)
+    {
+        return true;
+    }
+
+    return resize_table(map, new_capacity, false);
+}
+
+void unordered_map_set_incremental_rehash(unordered_map* map,
+                                          size_t buckets_per_operation)
+{
+    if (!map)
+    {
+        return;
+    }
+
+    map->rehash_step = buckets_per_operation;
+
+    if (buckets_per_operation == 0)
+    {
+        migrate_buckets(map, map->old_table_capacity);
+    }
+}
+
+/*******************************************************************************
+* Returns the entry of 'key', whose hash value is 'hash_value', or NULL if     *
+* the key is not mapped in the map.                                            *
+*******************************************************************************/
+static unordered_map_entry* find_entry(unordered_map* map, 
+                                       void* key, 
+                                       size_t hash_value)
+{
+    unordered_map_entry* entry;
+
+    for (entry = *get_bucket(map, hash_value); 
+         entry; 
+         entry = entry->chain_next)
+    {
+        /* Compare the cached hash first, since equality may be costly. */
+        if (entry->hash == hash_value && map->equals_function(entry->key, key))
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+* Links a new entry into its bucket and to the tail of the iteration list.     *
+*******************************************************************************/
+static void link_entry(unordered_map* map, unordered_map_entry* entry)
+{
+    unordered_map_entry** bucket = get_bucket(map, entry->hash);
+
+    entry->chain_next = *bucket;
+    *bucket           = entry;
 
-    /* Link the new entry to the tail of the list. */
     if (!map->tail)
     {
         map->head = entry;
@@ -213,25 +603,267 @@ void* unordered_map_put(unordered_map* map, void* key, void* value)
 
     map->size++;
     map->mod_count++;
+}
+
+void* unordered_map_put(unordered_map* map, void* key, void* value)
+{
+    if (!map) 
+    {
+        return NULL;
+    }
+
+    return unordered_map_put_hashed(map, key, map->hash_function(key), value);
+}
+
+void* unordered_map_put_hashed(unordered_map* map, 
+                               void* key, 
+                               size_t hash_value, 
+                               void* value)
+{
+    void* old_value;
+    unordered_map_entry* entry;
+
+    if (!map) 
+    {
+        return NULL;
+    }
     
+    migrate_step(map);
+
+    entry = find_entry(map, key, hash_value);
+
+    if (entry)
+    {
+        old_value = entry->value;
+        entry->value = value;
+        return old_value;
+    }
+
+    ensure_capacity(map);
+
+    entry = unordered_map_entry_alloc(map, key, value, hash_value);
+
+    /* NULL already means that the key was new, so the failure cannot be
+       returned. */
+    if (!entry)
+    {
+        fputs("Could not allocate memory for the map entry.\n", stderr);
+        abort();
+    }
+
+    link_entry(map, entry);
     return NULL;
 }
 
+void** unordered_map_get_or_insert(unordered_map* map, 
+                                   void* key, 
+                                   void* default_value, 
+                                   bool* inserted)
+{
+    if (!map) 
+    {
+        return NULL;
+    }
+
+    return unordered_map_get_or_insert_hashed(map, 
+                                              key, 
+                                              map->hash_function(key), 
+                                              default_value, 
+                                              inserted);
+}
+
+void** unordered_map_get_or_insert_hashed(unordered_map* map, 
+                                          void* key, 
+                                          size_t hash_value, 
+                                          void* default_value, 
+                                          bool* inserted)
+{
+    unordered_map_entry* entry;
+
+    if (!map) 
+    {
+        return NULL;
+    }
+    
+    migrate_step(map);
+
+    entry = find_entry(map, key, hash_value);
+
+    if (inserted)
+    {
+        *inserted = !entry;
+    }
+
+    if (entry)
+    {
+        return &entry->value;
+    }
+
+    ensure_capacity(map);
+
+    entry = unordered_map_entry_alloc(map, key, default_value, hash_value);
+
+    if (!entry)
+    {
+        if (inserted)
+        {
+            *inserted = false;
+        }
+
+        return NULL;
+    }
+
+    link_entry(map, entry);
+    return &entry->value;
+}
+
+bool unordered_map_compute(unordered_map* map,
+                           void* key,
+                           void* (*function)(void*, void*, void*),
+                           void* context)
+{
+    if (!map)
+    {
+        return false;
+    }
+
+    return unordered_map_compute_hashed(map, 
+                                        key, 
+                                        map->hash_function(key), 
+                                        function, 
+                                        context);
+}
+
+bool unordered_map_compute_hashed(unordered_map* map,
+                                  void* key,
+                                  size_t hash_value,
+                                  void* (*function)(void*, void*, void*),
+                                  void* context)
+{
+    void** value_slot;
+
+    if (!function)
+    {
+        return false;
+    }
+
+    value_slot = unordered_map_get_or_insert_hashed(map, 
+                                                    key, 
+                                                    hash_value, 
+                                                    NULL, 
+                                                    NULL);
+
+    if (!value_slot)
+    {
+        return false;
+    }
+
+    *value_slot = function(key, *value_slot, context);
+    return true;
+}
+
+bool unordered_map_put_all(unordered_map* map, 
+                           void** keys, 
+                           void** values, 
+                           size_t n)
+{
+    size_t* hash_values;
+    size_t i;
+    unordered_map_entry* entry;
+
+    if (!map || (n > 0 && (!keys || !values)))
+    {
+        return false;
+    }
+
+    if (n == 0)
+    {
+        return true;
+    }
+
+    if (n > SIZE_MAX / sizeof(size_t) || n > SIZE_MAX - map->size)
+    {
+        return false;
+    }
+
+    hash_values = malloc(sizeof(size_t) * n);
+
+    if (!hash_values)
+    {
+        return false;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        hash_values[i] = map->hash_function(keys[i]);
+    }
+
+    /* Size the table and the entry storage for the worst case, where all the
+       keys are new. This also finishes any migration, so 'table' is the only
+       table below. */
+    if (!unordered_map_reserve(map, map->size + n))
+    {
+        free(hash_values);
+        return false;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+#ifdef __GNUC__
+        if (i + PREFETCH_DISTANCE < n)
+        {
+            __builtin_prefetch(
+                    &map->table[hash_values[i + PREFETCH_DISTANCE] 
+                                & map->mask]);
+        }
+#endif
+        entry = find_entry(map, keys[i], hash_values[i]);
+
+        if (entry)
+        {
+            entry->value = values[i];
+        }
+        else
+        {
+            link_entry(map, unordered_map_entry_alloc(map, 
+                                                      keys[i], 
+                                                      values[i], 
+                                                      hash_values[i]));
+        }
+    }
+
+    free(hash_values);
+    return true;
+}
+
 bool unordered_map_contains_key(unordered_map* map, void* key)
 {
-    size_t index;
+    if (!map) 
+    {
+        return false;
+    }
+
+    return unordered_map_contains_key_hashed(map, 
+                                             key, 
+                                             map->hash_function(key));
+}
+
+bool unordered_map_contains_key_hashed(unordered_map* map, 
+                                       void* key, 
+                                       size_t hash_value)
+{
     unordered_map_entry* entry;
 
     if (!map) 
     {
         return false;
     }
-    
-    index = map->hash_function(key) & map->mask;
 
-    for (entry = map->table[index]; entry; entry = entry->chain_next) 
+    for (entry = *get_bucket(map, hash_value); 
+         entry; 
+         entry = entry->chain_next) 
     {
-        if (map->equals_function(key, entry->key))
+        if (entry->hash == hash_value && map->equals_function(key, entry->key))
         {
             return true;
         }
@@ -242,19 +874,31 @@ bool unordered_map_contains_key(unordered_map* map, void* key)
 
 void* unordered_map_get(unordered_map* map, void* key)
 {
-    size_t index;
+    if (!map) 
+    {
+        return NULL;
+    }
+
+    return unordered_map_get_hashed(map, key, map->hash_function(key));
+}
+
+void* unordered_map_get_hashed(unordered_map* map, 
+                               void* key, 
+                               size_t hash_value)
+{
     unordered_map_entry* p_entry;
 
     if (!map) 
     {
         return NULL;
     }
-    
-    index = map->hash_function(key) & map->mask;
 
-    for (p_entry = map->table[index]; p_entry; p_entry = p_entry->chain_next)
+    for (p_entry = *get_bucket(map, hash_value); 
+         p_entry; 
+         p_entry = p_entry->chain_next)
     {
-        if (map->equals_function(key, p_entry->key))
+        if (p_entry->hash == hash_value 
+                && map->equals_function(key, p_entry->key))
         {
             return p_entry->value;
         }
@@ -263,27 +907,106 @@ void* unordered_map_get(unordered_map* map, void* key)
     return NULL;
 }
 
+void unordered_map_get_batch(unordered_map* map, 
+                             void** keys, 
+                             size_t n, 
+                             void** out_values)
+{
+    size_t hash_values[BATCH_GROUP_SIZE];
+    unordered_map_entry** buckets[BATCH_GROUP_SIZE];
+    unordered_map_entry* entries[BATCH_GROUP_SIZE];
+    unordered_map_entry* entry;
+    size_t group_begin;
+    size_t group_size;
+    size_t i;
+
+    if (!map || !keys || !out_values)
+    {
+        return;
+    }
+
+    for (group_begin = 0; group_begin < n; group_begin += group_size)
+    {
+        group_size = n - group_begin < BATCH_GROUP_SIZE ? 
+                     n - group_begin : 
+                     BATCH_GROUP_SIZE;
+
+        /* Stage 1: hash the keys and prefetch their bucket heads. */
+        for (i = 0; i < group_size; ++i)
+        {
+            hash_values[i] = map->hash_function(keys[group_begin + i]);
+            buckets[i] = get_bucket(map, hash_values[i]);
+#ifdef __GNUC__
+            __builtin_prefetch(buckets[i]);
+#endif
+        }
+
+        /* Stage 2: load the bucket heads and prefetch the first nodes. */
+        for (i = 0; i < group_size; ++i)
+        {
+            entries[i] = *buckets[i];
+#ifdef __GNUC__
+            if (entries[i])
+            {
+                __builtin_prefetch(entries[i]);
+            }
+#endif
+        }
+
+        /* Stage 3: compare. Only the rest of a chain may still miss. */
+        for (i = 0; i < group_size; ++i)
+        {
+            out_values[group_begin + i] = NULL;
+
+            for (entry = entries[i]; entry; entry = entry->chain_next)
+            {
+                if (entry->hash == hash_values[i] 
+                        && map->equals_function(keys[group_begin + i], 
+                                                entry->key))
+                {
+                    out_values[group_begin + i] = entry->value;
+                    break;
+                }
+            }
+        }
+    }
+}
+
 void* unordered_map_remove(unordered_map* map, void* key)
+{
+    if (!map) 
+    {
+        return NULL;
+    }
+
+    return unordered_map_remove_hashed(map, key, map->hash_function(key));
+}
+
+void* unordered_map_remove_hashed(unordered_map* map, 
+                                  void* key, 
+                                  size_t hash_value)
 {
     void*  value;
-    size_t index;
     unordered_map_entry* prev_entry;
     unordered_map_entry* current_entry;
+    unordered_map_entry** bucket;
 
     if (!map) 
     {
         return NULL;
     }
     
-    index = map->hash_function(key) & map->mask;
+    migrate_step(map);
 
+    bucket     = get_bucket(map, hash_value);
     prev_entry = NULL;
 
-    for (current_entry = map->table[index];
+    for (current_entry = *bucket;
          current_entry;
          current_entry = current_entry->chain_next)
     {
-        if (map->equals_function(key, current_entry->key)) 
+        if (current_entry->hash == hash_value 
+                && map->equals_function(key, current_entry->key)) 
         {
             if (prev_entry)
             {
@@ -292,7 +1015,7 @@ void* unordered_map_remove(unordered_map* map, void* key)
             }
             else
             {
-                map->table[index] = current_entry->chain_next;
+                *bucket = current_entry->chain_next;
             }
 
             /* Unlink from the global iteration chain. */
@@ -317,7 +1040,8 @@ void* unordered_map_remove(unordered_map* map, void* key)
             value = current_entry->value;
             map->size--;
             map->mod_count++;
-            free(current_entry);
+            unordered_map_entry_release(map, current_entry);
+            shrink_if_sparse(map);
             return value;
         }
 
@@ -329,30 +1053,29 @@ void* unordered_map_remove(unordered_map* map, void* key)
 
 void unordered_map_clear(unordered_map* map)
 {
-    unordered_map_entry* entry;
-    unordered_map_entry* next_entry;
-    size_t index;
-
     if (!map)
     {
         return;
     }
     
-    entry = map->head;
-
-    while (entry)
-    {
-        index = map->hash_function(entry->key) & map->mask;
-        next_entry = entry->next;
-        free(entry);
-        entry = next_entry;
-        map->table[index] = NULL;
-    }
+    free_slabs(map);
+    free(map->old_table);
 
+    map->old_table = NULL;
     map->mod_count += map->size;
     map->size = 0;
     map->head = NULL;
     map->tail = NULL;
+
+    /* With a low-water mark, an emptied map also gives up its large table. */
+    if (map->low_water_mark == 0.0f
+            || map->table_capacity <= MINIMUM_INITIAL_CAPACITY
+            || !resize_table(map, MINIMUM_INITIAL_CAPACITY, false))
+    {
+        memset(map->table, 
+               0, 
+               map->table_capacity * sizeof(unordered_map_entry*));
+    }
 }
 
 size_t unordered_map_size(unordered_map* map)
@@ -360,9 +1083,46 @@ size_t unordered_map_size(unordered_map* map)
     return map ? map->size : 0;
 }
 
+size_t unordered_map_bucket_count(unordered_map* map)
+{
+    return map ? map->table_capacity : 0;
+}
+
+/*******************************************************************************
+* Returns the number of entries chained in the buckets 'begin' up to, but      *
+* excluding, 'end' of 'table', or 'SIZE_MAX' if some entry is chained in       *
+* another bucket than 'get_bucket' would look in.                              *
+*******************************************************************************/
+static size_t count_chained_entries(unordered_map* map,
+                                    unordered_map_entry** table,
+                                    size_t begin,
+                                    size_t end)
+{
+    size_t counter = 0;
+    size_t i;
+    unordered_map_entry* entry;
+
+    for (i = begin; i < end; ++i)
+    {
+        for (entry = table[i]; entry; entry = entry->chain_next)
+        {
+            if (get_bucket(map, entry->hash) != &table[i])
+            {
+                return SIZE_MAX;
+            }
+
+            counter++;
+        }
+    }
+
+    return counter;
+}
+
 bool unordered_map_is_healthy(unordered_map* map)
 {
     size_t counter;
+    size_t chained;
+    size_t old_chained;
     unordered_map_entry* entry;
 
     if (!map)
@@ -383,7 +1143,21 @@ bool unordered_map_is_healthy(unordered_map* map)
         counter++;
     }
 
-    return counter == map->size;
+    chained = count_chained_entries(map, map->table, 0, map->table_capacity);
+    old_chained = 0;
+
+    if (map->old_table)
+    {
+        old_chained = count_chained_entries(map,
+                                            map->old_table,
+                                            map->migration_index,
+                                            map->old_table_capacity);
+    }
+
+    return counter == map->size 
+        && chained != SIZE_MAX
+        && old_chained != SIZE_MAX
+        && chained + old_chained == map->size;
 }
 
 void unordered_map_free(unordered_map* map)
@@ -393,7 +1167,8 @@ void unordered_map_free(unordered_map* map)
         return;
     }
     
-    unordered_map_clear(map);
+    free_slabs(map);
+    free(map->old_table);
     free(map->table);
     free(map);
 }
@@ -24,10 +24,52 @@ extern "C" {
     /***************************************************************************
     * If p_map does not contain the key p_key, inserts it in the map,          *
     * associates p_value with it and return NULL. Otherwise updates the value  *
-    * and returns the old value.                                               * 
+    * and returns the old value. Aborts if it cannot allocate the new mapping, *
+    * since NULL is taken; 'unordered_map_get_or_insert' reports that case.    *
     ***************************************************************************/ 
     void* unordered_map_put (unordered_map* map, void* key, void* value);
 
+    /***************************************************************************
+    * Returns a pointer to the value slot of the key, inserting the key with   *
+    * 'default_value' first if it is not mapped in the map, after a single     *
+    * hash and a single chain walk. If 'inserted' is not NULL, it is set to    *
+    * whether the key was inserted. The slot stays valid until the key is      *
+    * removed or the map is cleared or freed. Returns NULL if out of memory.   *
+    ***************************************************************************/
+    void** unordered_map_get_or_insert (unordered_map* map,
+                                        void* key,
+                                        void* default_value,
+                                        bool* inserted);
+
+    /***************************************************************************
+    * Maps the key to 'function(key, value, context)', where 'value' is the    *
+    * value currently associated with the key, or NULL if the key is not       *
+    * mapped. Does a single hash and a single chain walk. Returns false if     *
+    * out of memory.                                                           *
+    ***************************************************************************/
+    bool unordered_map_compute (unordered_map* map,
+                                void* key,
+                                void* (*function)(void*, void*, void*),
+                                void* context);
+
+    /***************************************************************************
+    * Grows the table, at once, so that the map holds 'n' mappings without     *
+    * further rehashing, and preallocates the entries for the missing ones.    *
+    * Returns false if out of memory.                                          *
+    ***************************************************************************/
+    bool unordered_map_reserve (unordered_map* map, size_t n);
+
+    /***************************************************************************
+    * Maps each 'keys[i]' to 'values[i]' for 'i' from 0 to 'n - 1', like 'n'   *
+    * calls to 'unordered_map_put'. All the keys are hashed first, then the    *
+    * table is resized once and the new entries are taken from one block.      *
+    * Returns false, without changing the map, if out of memory.               *
+    ***************************************************************************/
+    bool unordered_map_put_all (unordered_map* map,
+                                void** keys,
+                                void** values,
+                                size_t n);
+
     /***************************************************************************
     * Returns a positive value if p_key is mapped to some value in this map.   *
     ***************************************************************************/
@@ -39,12 +81,59 @@ extern "C" {
     ***************************************************************************/
     void* unordered_map_get (unordered_map* map, void* key);
 
+    /***************************************************************************
+    * Stores in 'out_values[i]' the value associated with 'keys[i]', or NULL   *
+    * if that key is not mapped, for 'i' from 0 to 'n - 1'. The keys are       *
+    * looked up in groups of 32. Each group is hashed and its bucket heads     *
+    * prefetched, then the first chain nodes are prefetched and only then      *
+    * compared, so that the cache misses of a group overlap.                   *
+    ***************************************************************************/
+    void unordered_map_get_batch (unordered_map* map,
+                                  void** keys,
+                                  size_t n,
+                                  void** out_values);
+
     /***************************************************************************
     * If p_key is mapped in the map, removes the mapping and returns the value *
     * of that mapping. If the map did not contain the mapping, returns NULL.   *
     ***************************************************************************/ 
     void* unordered_map_remove (unordered_map* map, void* p_key);
 
+    /***************************************************************************
+    * Variants of the functions above for callers that have already hashed     *
+    * the key, such as a map that spreads its keys over several maps by their  *
+    * hash values. 'hash_value' must be what the hash function of the map      *
+    * returns for 'key'.                                                       *
+    ***************************************************************************/
+    void* unordered_map_put_hashed (unordered_map* map,
+                                    void* key,
+                                    size_t hash_value,
+                                    void* value);
+
+    void** unordered_map_get_or_insert_hashed (unordered_map* map,
+                                               void* key,
+                                               size_t hash_value,
+                                               void* default_value,
+                                               bool* inserted);
+
+    bool unordered_map_compute_hashed (unordered_map* map,
+                                       void* key,
+                                       size_t hash_value,
+                                       void* (*function)(void*, void*, void*),
+                                       void* context);
+
+    bool unordered_map_contains_key_hashed (unordered_map* map,
+                                            void* key,
+                                            size_t hash_value);
+
+    void* unordered_map_get_hashed (unordered_map* map,
+                                    void* key,
+                                    size_t hash_value);
+
+    void* unordered_map_remove_hashed (unordered_map* map,
+                                       void* key,
+                                       size_t hash_value);
+
     /***************************************************************************
     * Removes all the contents of the map.                                     * 
     ***************************************************************************/ 
@@ -56,6 +145,48 @@ extern "C" {
     ***************************************************************************/ 
     size_t unordered_map_size (unordered_map* map);
 
+    /***************************************************************************
+    * Returns the number of buckets in the table of the map. While an          *
+    * incremental rehash is running, this is the size of the new table.        *
+    ***************************************************************************/
+    size_t unordered_map_bucket_count (unordered_map* map);
+
+    /***************************************************************************
+    * Sets the number of buckets migrated per insertion or removal when the    *
+    * map grows. With 0, the default, a growth rehashes the whole table at     *
+    * once. Otherwise, the map keeps its old table next to the new one and     *
+    * moves 'buckets_per_operation' old buckets per 'unordered_map_put' and    *
+    * 'unordered_map_remove', so that no single insertion pays for the whole   *
+    * rehash. More buckets are moved per operation whenever needed to finish   *
+    * the migration before the table is due to grow or shrink again. Lookups   *
+    * stay read-only and check the one table that holds the key. Setting 0     *
+    * during a migration completes it at once, and so do                       *
+    * 'unordered_map_reserve', 'unordered_map_put_all' and                     *
+    * 'unordered_map_shrink_to_fit', as well as a removal that drops the map   *
+    * below a low-water mark raised during the migration.                      *
+    ***************************************************************************/
+    void unordered_map_set_incremental_rehash
+        (unordered_map* map, size_t buckets_per_operation);
+
+    /***************************************************************************
+    * Makes the map halve its table whenever a removal leaves fewer than       *
+    * 'low_water_mark' mappings per bucket, down to 16 buckets, and makes      *
+    * 'unordered_map_clear' fall back to 16 buckets. The mark is capped at a   *
+    * quarter of the load factor so that a halved table does not grow right    *
+    * back. With 0, the default, the table never shrinks by itself.            *
+    ***************************************************************************/
+    void unordered_map_set_low_water_mark(unordered_map* map,
+                                          float low_water_mark);
+
+    /***************************************************************************
+    * Shrinks the table, at once, to the smallest one that holds the current   *
+    * mappings under the load factor. The entries themselves are never moved,  *
+    * since the slots returned by 'unordered_map_get_or_insert' must stay      *
+    * valid, but an empty map releases all of its entry storage. Returns false *
+    * if out of memory.                                                        *
+    ***************************************************************************/
+    bool unordered_map_shrink_to_fit(unordered_map* map);
+
     /***************************************************************************
     * Checks that the map is in valid state.                                   *
     ***************************************************************************/  
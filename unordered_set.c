@@ -1,16 +1,33 @@
 #include "unordered_set.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct unordered_set_entry {
     void*                       key;
+    size_t                      hash;
     struct unordered_set_entry* chain_next;
     struct unordered_set_entry* prev;
     struct unordered_set_entry* next;
 } unordered_set_entry;
 
+/*******************************************************************************
+* Entries are carved out of slabs owned by the set instead of being allocated  *
+* one by one. Removed entries go to a free list, linked through 'chain_next',  *
+* and are reused before the newest slab is bumped.                             *
+*******************************************************************************/
+typedef struct unordered_set_slab {
+    struct unordered_set_slab* next;
+    size_t                     capacity;
+    size_t                     used;
+    unordered_set_entry        entries[];
+} unordered_set_slab;
+
 struct unordered_set {
     unordered_set_entry** table;
+    unordered_set_slab*   slabs;
+    unordered_set_entry*  free_entries;
     unordered_set_entry*  head;
     unordered_set_entry*  tail;
     size_t              (*hash_function)(void*);
@@ -20,7 +37,9 @@ struct unordered_set {
     size_t                size;
     size_t                mask;
     size_t                max_allowed_size;
+    size_t                min_allowed_size;
     float                 load_factor;
+    float                 low_water_mark;
 };
 
 struct unordered_set_iterator {
@@ -30,9 +49,90 @@ struct unordered_set_iterator {
     size_t               expected_mod_count;
 };
 
-static unordered_set_entry* unordered_set_entry_t_alloc(void* key)
+static const size_t MINIMUM_SLAB_CAPACITY = 16;
+static const size_t MAXIMUM_SLAB_CAPACITY = 1 << 16;
+
+/* How many elements ahead 'unordered_set_t_add_all' prefetches the buckets. */
+static const size_t PREFETCH_DISTANCE = 8;
+
+/*******************************************************************************
+* Returns a fresh entry from the free list or the newest slab, allocating a    *
+* new slab twice as large as the previous one if both are exhausted. Returns   *
+* NULL if out of memory.                                                       *
+*******************************************************************************/
+static unordered_set_entry* unordered_set_entry_take(unordered_set* set)
+{
+    unordered_set_entry* entry;
+    unordered_set_slab*  slab;
+    size_t capacity;
+
+    if (set->free_entries)
+    {
+        entry = set->free_entries;
+        set->free_entries = entry->chain_next;
+        return entry;
+    }
+
+    slab = set->slabs;
+
+    if (!slab || slab->used == slab->capacity)
+    {
+        capacity = slab ? 2 * slab->capacity : MINIMUM_SLAB_CAPACITY;
+
+        if (capacity > MAXIMUM_SLAB_CAPACITY)
+        {
+            capacity = MAXIMUM_SLAB_CAPACITY;
+        }
+
+        slab = malloc(sizeof(*slab) + capacity * sizeof(unordered_set_entry));
+
+        if (!slab)
+        {
+            return NULL;
+        }
+
+        slab->capacity = capacity;
+        slab->used     = 0;
+        slab->next     = set->slabs;
+        set->slabs     = slab;
+    }
+
+    return &slab->entries[slab->used++];
+}
+
+/*******************************************************************************
+* Returns an entry to the free list of its set.                                *
+*******************************************************************************/
+static void unordered_set_entry_release(unordered_set* set,
+                                        unordered_set_entry* entry)
+{
+    entry->chain_next = set->free_entries;
+    set->free_entries = entry;
+}
+
+/*******************************************************************************
+* Deallocates all the slabs of the set, and with them all the entries.         *
+*******************************************************************************/
+static void free_slabs(unordered_set* set)
+{
+    unordered_set_slab* slab;
+    unordered_set_slab* next_slab;
+
+    for (slab = set->slabs; slab; slab = next_slab)
+    {
+        next_slab = slab->next;
+        free(slab);
+    }
+
+    set->slabs        = NULL;
+    set->free_entries = NULL;
+}
+
+static unordered_set_entry* unordered_set_entry_t_alloc(unordered_set* set,
+                                                        void* key, 
+                                                        size_t hash)
 {
-    unordered_set_entry* entry = malloc(sizeof(*entry));
+    unordered_set_entry* entry = unordered_set_entry_take(set);
 
     if (!entry) 
     {
@@ -40,6 +140,7 @@ static unordered_set_entry* unordered_set_entry_t_alloc(void* key)
     }
     
     entry->key        = key;
+    entry->hash       = hash;
     entry->chain_next = NULL;
     entry->next       = NULL;
     entry->prev       = NULL;
@@ -115,42 +216,43 @@ unordered_set* unordered_set_t_alloc(size_t initial_capacity,
     set->mod_count        = 0;
     set->head             = NULL;
     set->tail             = NULL;
+    set->slabs            = NULL;
+    set->free_entries     = NULL;
     set->table            = calloc(initial_capacity, 
                                    sizeof(unordered_set_entry*));
     set->hash_function    = hash_function;
     set->equals_function  = equals_function;
     set->mask             = initial_capacity - 1;
     set->max_allowed_size = (size_t)(initial_capacity * load_factor);
+    set->min_allowed_size = 0;
+    set->low_water_mark   = 0.0f;
 
     return set;
 }
 
-static void ensure_capacity(unordered_set* set) 
+/*******************************************************************************
+* Relinks all the entries into a new table of 'new_capacity' buckets. Returns  *
+* false and leaves the set intact if out of memory.                            *
+*******************************************************************************/
+static bool resize_table(unordered_set* set, size_t new_capacity)
 {
-    size_t new_capacity;
     size_t new_mask;
     size_t index;
     unordered_set_entry*  entry;
     unordered_set_entry** new_table;
 
-    if (set->size < set->max_allowed_size) 
-    {
-        return;
-    }
-    
-    new_capacity = 2 * set->table_capacity;
     new_mask = new_capacity - 1;
     new_table = calloc(new_capacity, sizeof(unordered_set_entry*));
 
     if (!new_table)
     {
-        return;
+        return false;
     }
     
-    /* Rehash the entries. */
+    /* Relink the entries using their cached hash values. */
     for (entry = set->head; entry; entry = entry->next)
     {
-        index = set->hash_function(entry->key) & new_mask;
+        index = entry->hash & new_mask;
         entry->chain_next = new_table[index];
         new_table[index] = entry;
     }
@@ -161,39 +263,184 @@ static void ensure_capacity(unordered_set* set)
     set->table_capacity   = new_capacity;
     set->mask             = new_mask;
     set->max_allowed_size = (size_t)(new_capacity * set->load_factor);
+    set->min_allowed_size = (size_t)(new_capacity * set->low_water_mark);
+    return true;
 }
 
-bool unordered_set_t_add(unordered_set* set, void* key)
+static void ensure_capacity(unordered_set* set) 
 {
-    size_t index;
-    size_t hash_value;
-    unordered_set_entry* entry;
-    
-    if (!set) 
+    if (set->size < set->max_allowed_size) 
     {
-        return NULL;
+        return;
     }
     
-    hash_value = set->hash_function(key);
-    index      = hash_value & set->mask;
+    resize_table(set, 2 * set->table_capacity);
+}
+
+/*******************************************************************************
+* Halves the table once the set has become sparser than its low-water mark.    *
+*******************************************************************************/
+static void shrink_if_sparse(unordered_set* set)
+{
+    if (set->size >= set->min_allowed_size
+            || set->table_capacity <= MINIMUM_INITIAL_CAPACITY)
+    {
+        return;
+    }
+
+    resize_table(set, set->table_capacity / 2);
+}
+
+void unordered_set_t_set_low_water_mark(unordered_set* set, 
+                                        float low_water_mark)
+{
+    if (!set)
+    {
+        return;
+    }
+
+    /* The halved table must stay well below the load factor, or the next few
+       additions would grow it right back. */
+    if (low_water_mark < 0.0f)
+    {
+        low_water_mark = 0.0f;
+    }
+    else if (low_water_mark > set->load_factor / 4)
+    {
+        low_water_mark = set->load_factor / 4;
+    }
+
+    set->low_water_mark   = low_water_mark;
+    set->min_allowed_size = (size_t)(set->table_capacity * low_water_mark);
+}
+
+bool unordered_set_t_shrink_to_fit(unordered_set* set)
+{
+    size_t new_capacity = MINIMUM_INITIAL_CAPACITY;
+
+    if (!set)
+    {
+        return false;
+    }
+
+    if (set->size == 0)
+    {
+        free_slabs(set);
+    }
+
+    while ((size_t)(new_capacity * set->load_factor) < set->size)
+    {
+        new_capacity <<= 1;
+    }
+
+    if (new_capacity >= set->table_capacity)
+    {
+        return true;
+    }
+
+    return resize_table(set, new_capacity);
+}
+
+/*******************************************************************************
+* Makes sure that the newest slab has room for 'count' more entries. The rest  *
+* of a too small newest slab goes to the free list, since only the newest      *
+* slab is bumped. Returns false if out of memory.                              *
+*******************************************************************************/
+static bool reserve_entries(unordered_set* set, size_t count)
+{
+    unordered_set_slab* slab = set->slabs;
+
+    if (count == 0 || (slab && slab->capacity - slab->used >= count))
+    {
+        return true;
+    }
+
+    if (count > (SIZE_MAX - sizeof(*slab)) / sizeof(unordered_set_entry))
+    {
+        return false;
+    }
+
+    while (slab && slab->used < slab->capacity)
+    {
+        unordered_set_entry_release(set, &slab->entries[slab->used++]);
+    }
+
+    slab = malloc(sizeof(*slab) + count * sizeof(unordered_set_entry));
+
+    if (!slab)
+    {
+        return false;
+    }
+
+    slab->capacity = count;
+    slab->used     = 0;
+    slab->next     = set->slabs;
+    set->slabs     = slab;
+    return true;
+}
+
+bool unordered_set_t_reserve(unordered_set* set, size_t n)
+{
+    size_t new_capacity;
 
-    for (entry = set->table[index]; entry; entry = entry->chain_next)
+    if (!set)
     {
-        if (set->equals_function(entry->key, key))
+        return false;
+    }
+
+    new_capacity = set->table_capacity;
+
+    while ((size_t)(new_capacity * set->load_factor) < n)
+    {
+        /* No table can hold 'n' elements within the load factor. */
+        if (new_capacity > SIZE_MAX / 2)
         {
             return false;
         }
+
+        new_capacity <<= 1;
     }
 
-    ensure_capacity(set);
+    if (new_capacity > set->table_capacity 
+            && !resize_table(set, new_capacity))
+    {
+        return false;
+    }
+
+    return reserve_entries(set, n > set->size ? n - set->size : 0);
+}
+
+/*******************************************************************************
+* Returns true if 'key', whose hash value is 'hash_value', is in the set.      *
+*******************************************************************************/
+static bool contains_hashed(unordered_set* set, void* key, size_t hash_value)
+{
+    unordered_set_entry* entry;
+
+    for (entry = set->table[hash_value & set->mask]; 
+         entry; 
+         entry = entry->chain_next)
+    {
+        /* Compare the cached hash first, since equality may be costly. */
+        if (entry->hash == hash_value && set->equals_function(entry->key, key))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*******************************************************************************
+* Links a new entry into its bucket and to the tail of the iteration list.     *
+*******************************************************************************/
+static void link_entry(unordered_set* set, unordered_set_entry* entry)
+{
+    size_t index = entry->hash & set->mask;
 
-    /* Recompute the index since it is possibly changed by 'ensure_capacity' */
-    index             = hash_value & set->mask;
-    entry             = unordered_set_entry_t_alloc(key);
     entry->chain_next = set->table[index];
     set->table[index] = entry;
 
-    /* Link the new entry to the tail of the list. */
     if (!set->tail)
     {
         set->head = entry;
@@ -208,13 +455,104 @@ bool unordered_set_t_add(unordered_set* set, void* key)
 
     set->size++;
     set->mod_count++;
+}
+
+bool unordered_set_t_add(unordered_set* set, void* key)
+{
+    size_t hash_value;
+    unordered_set_entry* entry;
     
+    if (!set) 
+    {
+        return NULL;
+    }
+    
+    hash_value = set->hash_function(key);
+
+    if (contains_hashed(set, key, hash_value))
+    {
+        return false;
+    }
+
+    ensure_capacity(set);
+
+    entry = unordered_set_entry_t_alloc(set, key, hash_value);
+
+    if (!entry)
+    {
+        return false;
+    }
+
+    link_entry(set, entry);
+    return true;
+}
+
+bool unordered_set_t_add_all(unordered_set* set, void** elements, size_t n)
+{
+    size_t* hash_values;
+    size_t i;
+
+    if (!set || (n > 0 && !elements))
+    {
+        return false;
+    }
+
+    if (n == 0)
+    {
+        return true;
+    }
+
+    if (n > SIZE_MAX / sizeof(size_t) || n > SIZE_MAX - set->size)
+    {
+        return false;
+    }
+
+    hash_values = malloc(sizeof(size_t) * n);
+
+    if (!hash_values)
+    {
+        return false;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        hash_values[i] = set->hash_function(elements[i]);
+    }
+
+    /* Size the table and the entry storage for the worst case, where all the
+       elements are new. */
+    if (!unordered_set_t_reserve(set, set->size + n))
+    {
+        free(hash_values);
+        return false;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+#ifdef __GNUC__
+        if (i + PREFETCH_DISTANCE < n)
+        {
+            __builtin_prefetch(
+                    &set->table[hash_values[i + PREFETCH_DISTANCE] 
+                                & set->mask]);
+        }
+#endif
+        if (!contains_hashed(set, elements[i], hash_values[i]))
+        {
+            link_entry(set, unordered_set_entry_t_alloc(set, 
+                                                        elements[i], 
+                                                        hash_values[i]));
+        }
+    }
+
+    free(hash_values);
     return true;
 }
 
 bool unordered_set_t_contains(unordered_set* set, void* key)
 {
     size_t index;
+    size_t hash_value;
     unordered_set_entry* p_entry;
 
     if (!set) 
@@ -222,11 +560,13 @@ bool unordered_set_t_contains(unordered_set* set, void* key)
         return false;
     }
     
-    index = set->hash_function(key) & set->mask;
+    hash_value = set->hash_function(key);
+    index      = hash_value & set->mask;
 
     for (p_entry = set->table[index]; p_entry; p_entry = p_entry->chain_next) 
     {
-        if (set->equals_function(key, p_entry->key))
+        if (p_entry->hash == hash_value 
+                && set->equals_function(key, p_entry->key))
         {
             return true;
         }
@@ -238,6 +578,7 @@ bool unordered_set_t_contains(unordered_set* set, void* key)
 bool unordered_set_t_remove(unordered_set* set, void* key)
 {
     size_t index;
+    size_t hash_value;
     unordered_set_entry* prev_entry;
     unordered_set_entry* current_entry;
 
@@ -246,7 +587,8 @@ bool unordered_set_t_remove(unordered_set* set, void* key)
         return false;
     }
     
-    index = set->hash_function(key) & set->mask;
+    hash_value = set->hash_function(key);
+    index      = hash_value & set->mask;
 
     prev_entry = NULL;
 
@@ -254,7 +596,8 @@ bool unordered_set_t_remove(unordered_set* set, void* key)
          current_entry;
          current_entry = current_entry->chain_next)
     {
-        if (set->equals_function(key, current_entry->key)) 
+        if (current_entry->hash == hash_value 
+                && set->equals_function(key, current_entry->key)) 
         {
             if (prev_entry)
             {
@@ -287,7 +630,8 @@ bool unordered_set_t_remove(unordered_set* set, void* key)
             
             set->size--;
             set->mod_count++;
-            free(current_entry);
+            unordered_set_entry_release(set, current_entry);
+            shrink_if_sparse(set);
             return true;
         }
 
@@ -299,30 +643,27 @@ bool unordered_set_t_remove(unordered_set* set, void* key)
 
 void unordered_set_t_clear(unordered_set* set)
 {
-    unordered_set_entry* entry;
-    unordered_set_entry* next_entry;
-    size_t index;
-
     if (!set) 
     {
         return;
     }
     
-    entry = set->head;
-
-    while (entry)
-    {
-        index = set->hash_function(entry->key) & set->mask;
-        next_entry = entry->next;
-        free(entry);
-        entry = next_entry;
-        set->table[index] = NULL;
-    }
+    free_slabs(set);
 
     set->mod_count += set->size;
     set->size = 0;
     set->head = NULL;
     set->tail = NULL;
+
+    /* With a low-water mark, an emptied set also gives up its large table. */
+    if (set->low_water_mark == 0.0f
+            || set->table_capacity <= MINIMUM_INITIAL_CAPACITY
+            || !resize_table(set, MINIMUM_INITIAL_CAPACITY))
+    {
+        memset(set->table, 
+               0, 
+               set->table_capacity * sizeof(unordered_set_entry*));
+    }
 }
 
 size_t unordered_set_t_size(unordered_set* set)
@@ -330,6 +671,11 @@ size_t unordered_set_t_size(unordered_set* set)
     return set ? set->size : 0;
 }
 
+size_t unordered_set_t_bucket_count(unordered_set* set)
+{
+    return set ? set->table_capacity : 0;
+}
+
 bool unordered_set_t_is_healthy(unordered_set* set)
 {
     size_t counter;
@@ -363,7 +709,7 @@ void unordered_set_t_free(unordered_set* set)
         return;
     }
     
-    unordered_set_t_clear(set);
+    free_slabs(set);
     free(set->table);
     free(set);
 }
@@ -23,10 +23,28 @@ extern "C" {
 
     /***************************************************************************
     * Adds 'p_element' to the set if not already there. Returns true if the    *
-    * structure of the set changed.                                            * 
+    * structure of the set changed, and false if the element was already in    *
+    * the set or if out of memory.                                             *
     ***************************************************************************/ 
     bool  unordered_set_t_add (unordered_set* p_set, void* p_element);
 
+    /***************************************************************************
+    * Grows the table so that the set holds 'n' elements without further       *
+    * rehashing, and preallocates the entries for the missing ones. Returns    *
+    * false if out of memory.                                                  *
+    ***************************************************************************/
+    bool  unordered_set_t_reserve (unordered_set* p_set, size_t n);
+
+    /***************************************************************************
+    * Adds the 'n' elements starting from 'p_elements' to the set, like 'n'    *
+    * calls to 'unordered_set_t_add'. All the elements are hashed first, then  *
+    * the table is resized once and the new entries are taken from one block.  *
+    * Returns false, without changing the set, if out of memory.               *
+    ***************************************************************************/
+    bool  unordered_set_t_add_all (unordered_set* p_set, 
+                                   void** p_elements, 
+                                   size_t n);
+
     /***************************************************************************
     * Returns true if the set contains the element.                            *
     ***************************************************************************/
@@ -47,6 +65,29 @@ extern "C" {
     ***************************************************************************/ 
     size_t unordered_set_t_size (unordered_set* p_set);
 
+    /***************************************************************************
+    * Returns the number of buckets in the table of the set.                   *
+    ***************************************************************************/
+    size_t unordered_set_t_bucket_count (unordered_set* p_set);
+
+    /***************************************************************************
+    * Makes the set halve its table whenever a removal leaves fewer than       *
+    * 'low_water_mark' elements per bucket, down to 16 buckets, and makes      *
+    * 'unordered_set_t_clear' fall back to 16 buckets. The mark is capped at a *
+    * quarter of the load factor so that a halved table does not grow right    *
+    * back. With 0, the default, the table never shrinks by itself.            *
+    ***************************************************************************/
+    void   unordered_set_t_set_low_water_mark (unordered_set* p_set, 
+                                               float low_water_mark);
+
+    /***************************************************************************
+    * Shrinks the table to the smallest one that holds the current elements    *
+    * under the load factor. The entries themselves are not moved, but an      *
+    * empty set releases all of its entry storage. Returns false if out of     *
+    * memory.                                                                  *
+    ***************************************************************************/
+    bool   unordered_set_t_shrink_to_fit (unordered_set* p_set);
+
     /***************************************************************************
     * Checks that the set is in valid state.                                   *
     ***************************************************************************/  